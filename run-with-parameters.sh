@@ -10,7 +10,12 @@ set -x
 # exit 0
 
 
-if [[ "$(id -u -n )" == "sonic" ]]
+# With --print-parameters, the parameters are printed instead of starting the renderer
+# (button-menu.py sends them to the running renderer over the control socket)
+PRINT_PARAMETERS="$1"
+CONTROL_SOCKET="/tmp/sonic-sight-control.socket"
+
+if [[ "$(id -u -n )" == "sonic" ]] && [[ "$PRINT_PARAMETERS" != "--print-parameters" ]]
 then
 	cmd="${HOME}/sonic-sight/release_build/render-to-sound"
 	# cmd="${cmd} --save-depth-to=./data/frame "
@@ -43,6 +48,7 @@ parameters=(
 "--renderer-lower-amplitude=0.0" \
 "--renderer-interval-extra-time=0.01" \
 "--depth-rendering-mode=simple" \
+"--control-socket=${CONTROL_SOCKET}" \
 )
 # if lower max distance is unset, lower rendering is disabled
 # "--renderer-lower-frequency-doubling-length=20." \
@@ -97,6 +103,12 @@ case "$RANGE" in
 		;;
 esac
 
+if [[ "$PRINT_PARAMETERS" == "--print-parameters" ]]
+then
+	echo "${parameters[@]}"
+	exit 0
+fi
+
 ${cmd} \
 "${parameters[@]}"
 
@@ -7,6 +7,7 @@ import logging
 import sys
 import os
 import threading
+import socket
 
 logger = logging.getLogger()
 log_level = logging.INFO
@@ -23,6 +24,7 @@ import RPi.GPIO as GPIO
 
 # Configuration
 script="/home/sonic/sonic-sight/run-with-parameters.sh"
+control_socket="/tmp/sonic-sight-control.socket"
 sounds="/home/sonic/sonic-sight/scripts/sounds"
 bounce_time = 500
 shutdown_hold_time = 3
@@ -58,6 +60,29 @@ def set_variable( var_name, var_value ):
         + var_value + '''"/g' "''' + script + '''"'''
     subprocess.run(cmd, shell=True)
 
+def send_parameters():
+    """Sends the parameters of the current settings to the running renderer,
+    returns False if the renderer is not listening on the control socket"""
+    result = subprocess.run( [script, "--print-parameters"], stdout=subprocess.PIPE,
+                             stderr=subprocess.DEVNULL, universal_newlines=True )
+    parameters = result.stdout.strip()
+    logger.debug("Sending parameters : " + parameters)
+    try:
+        s = socket.socket( socket.AF_UNIX, socket.SOCK_DGRAM )
+        s.sendto( parameters.encode(), control_socket )
+        s.close()
+    except OSError as e:
+        logger.error("Could not send parameters to the renderer : " + str(e) )
+        return False
+    return True
+
+
+def apply_parameters():
+    # restart the service only if the renderer can not switch the parameters while running
+    if not send_parameters():
+        subprocess.call("systemctl --user restart sonic-sight.service", shell=True)
+
+
 play_process = None
 
 def play_message( message ):
@@ -148,7 +173,7 @@ def switch_distance():
     current_range=range_groups[(range_groups.index(current_range) + 1) % len(range_groups)]
     play_message("Changing distance to " + current_range )
     set_variable( range_variable, current_range )
-    subprocess.call("systemctl --user restart sonic-sight.service", shell=True)
+    apply_parameters()
 
 
 def switch_frequency_doubling():
@@ -157,7 +182,7 @@ def switch_frequency_doubling():
         (frequency_doubling_groups.index(current_frequency_doubling) + 1) % len(frequency_doubling_groups)]
     play_message("Changing frequency doubling to " + current_frequency_doubling )
     set_variable( frequency_doubling_variable, current_frequency_doubling )
-    subprocess.call("systemctl --user restart sonic-sight.service", shell=True)
+    apply_parameters()
 
 
 GPIO.setmode(GPIO.BOARD)
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+
+# Converts the HRIRs of a SOFA file (SimpleFreeFieldHRIR convention)
+# to the raw file read by --renderer-hrir of render-to-sound:
+# uint32 sample rate, number of directions and number of taps, then for each direction
+# float32 azimuth and elevation [deg], the taps of the L ear and the taps of the R ear (little endian).
+
+import argparse
+
+import h5py
+import numpy as np
+
+parser = argparse.ArgumentParser(
+    description="Script to convert the HRIRs of a SOFA file for the binaural depth rendering mode",
+    usage='use "%(prog)s --help" for more information',
+)
+
+parser.add_argument(
+    "--sample-rate",
+    type=int,
+    default=44100,
+    help="Sample rate of the rendered sound (--renderer-sample-rate), the HRIRs are resampled to it",
+)
+
+parser.add_argument(
+    "--max-taps",
+    type=int,
+    default=256,
+    help="HRIRs are truncated to this many taps",
+)
+
+parser.add_argument(
+    "input",
+    type=str,
+    help="SOFA file",
+)
+
+parser.add_argument(
+    "output",
+    type=str,
+    help="Output file",
+)
+
+args = parser.parse_args()
+
+with h5py.File(args.input, "r") as sofa:
+    hrirs = np.array(sofa["Data.IR"], dtype=np.float64)  # directions x ears x taps
+    sample_rate = int(np.array(sofa["Data.SamplingRate"]).flatten()[0])
+    positions = np.array(sofa["SourcePosition"], dtype=np.float64)  # azimuth, elevation, distance
+
+if sample_rate != args.sample_rate:
+    from scipy.signal import resample_poly
+    divisor = np.gcd(sample_rate, args.sample_rate)
+    hrirs = resample_poly(hrirs, args.sample_rate // divisor, sample_rate // divisor, axis=2)
+    print("Resampled from", sample_rate, "Hz to", args.sample_rate, "Hz")
+hrirs = hrirs[:, :, : args.max_taps]
+
+n_directions, n_ears, n_taps = hrirs.shape
+if n_ears != 2:
+    raise SystemExit("Expected the HRIRs of 2 ears, got " + str(n_ears))
+
+with open(args.output, "wb") as f:
+    f.write(np.array([args.sample_rate, n_directions, n_taps], dtype="<u4").tobytes())
+    for i in range(n_directions):
+        f.write(np.array(positions[i, 0:2], dtype="<f4").tobytes())
+        f.write(np.array(hrirs[i, 0, :], dtype="<f4").tobytes())
+        f.write(np.array(hrirs[i, 1, :], dtype="<f4").tobytes())
+print("Wrote", n_directions, "HRIRs of", n_taps, "taps to", args.output)
@@ -0,0 +1,151 @@
+/*
+ * ArchiveFrameSource.cpp
+ */
+
+#include "ArchiveFrameSource.h"
+#include <dirent.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+ArchiveFrameSource::ArchiveFrameSource(
+		const std::string & directory,
+		int camera_w,
+		int camera_h
+		)
+	:directory(directory),
+	 camera_w(camera_w),
+	 camera_h(camera_h),
+	 next_file(0)
+{
+	DIR * dir = opendir( directory.c_str() );
+	if( dir == NULL )
+		cerr << "Error opening the frame archive directory : " << directory << endl;
+	else
+	{
+		const std::string extension(".dat");
+		for( struct dirent * entry = readdir(dir); entry != NULL; entry = readdir(dir) )
+		{
+			const std::string name( entry->d_name );
+			if( name.length() > extension.length() &&
+					name.compare( name.length()-extension.length(), extension.length(), extension ) == 0 )
+				filenames.push_back( directory + "/" + name );
+		}
+		closedir( dir );
+	}
+	sort( filenames.begin(), filenames.end() );
+	cout << "Found " << filenames.size() << " frames in " << directory << endl;
+
+	// Without a readable frame the intrinsics of a 90 degree field of view are assumed
+	intrinsics.width = camera_w;
+	intrinsics.height = camera_h;
+	intrinsics.ppx = 0.5*camera_w;
+	intrinsics.ppy = 0.5*camera_h;
+	intrinsics.fx = 0.5*camera_w;
+	intrinsics.fy = 0.5*camera_w;
+	for( unsigned int i=0; i<filenames.size(); ++i )
+	{
+		if( ReadFrame( filenames[i], buffer ) )
+		{
+			intrinsics = EstimateIntrinsics( &(*buffer)[0], camera_w, camera_h );
+			break;
+		}
+	}
+	cout << "Archive camera intrinsics : ppx,ppy = " << intrinsics.ppx << "," << intrinsics.ppy;
+	cout << " fx,fy = " << intrinsics.fx << "," << intrinsics.fy << endl;
+}
+
+bool ArchiveFrameSource::ReadFrame( const std::string & filename, std::shared_ptr<std::vector<Vertex> > & vertices )
+{
+	const unsigned int n = camera_w*camera_h;
+	std::ifstream f( filename.c_str(), std::ios_base::binary | std::ios_base::ate );
+	if( f.is_open() == false )
+	{
+		cerr << "Error opening frame " << filename << endl;
+		return false;
+	}
+	if( (unsigned long)f.tellg() != n*sizeof(Vertex) )
+	{
+		cerr << "Skipping frame " << filename << ", its size does not match " <<
+				camera_w << "x" << camera_h << " vertices" << endl;
+		return false;
+	}
+	// a buffer still held by a previous frame is left to it
+	if( !vertices || vertices.use_count() > 1 )
+		vertices = std::make_shared<std::vector<Vertex> >( n );
+	f.seekg( 0 );
+	f.read( (char *)&(*vertices)[0], n*sizeof(Vertex) );
+	return (bool)f;
+}
+
+bool ArchiveFrameSource::WaitForFrame( Frame & frame )
+{
+	while( next_file < filenames.size() )
+	{
+		const std::string & filename = filenames[next_file];
+		const unsigned long long frame_number = next_file;
+		++next_file;
+		if( ReadFrame( filename, buffer ) == false )
+			continue;
+		cout << "Replaying frame " << filename << endl;
+		frame.vertices = &(*buffer)[0];
+		frame.n_vertices = buffer->size();
+		frame.frame_number = frame_number;
+		frame.time_of_arrival = Now();
+		frame.color.data = NULL;
+		frame.aligned_color.data = NULL;
+		frame.owner = buffer;
+		return true;
+	}
+	return false;
+}
+
+CameraIntrinsics ArchiveFrameSource::EstimateIntrinsics( const Vertex * vertices, int camera_w, int camera_h )
+{
+	// least squares fit of x/z = (u-ppx)/fx and y/z = (v-ppy)/fy
+	double n = 0., su = 0., sv = 0., suu = 0., svv = 0.;
+	double sa = 0., sb = 0., sua = 0., svb = 0.;
+	for( int v=0; v<camera_h; ++v )
+	{
+		for( int u=0; u<camera_w; ++u )
+		{
+			const Vertex & p = vertices[v*camera_w+u];
+			if( p.z <= 0.0001 )
+				continue;
+			const double a = p.x / p.z;
+			const double b = p.y / p.z;
+			n += 1.;
+			su += u;
+			sv += v;
+			suu += (double)u*u;
+			svv += (double)v*v;
+			sa += a;
+			sb += b;
+			sua += u*a;
+			svb += v*b;
+		}
+	}
+	CameraIntrinsics c;
+	c.width = camera_w;
+	c.height = camera_h;
+	const double du = n*suu - su*su;
+	const double dv = n*svv - sv*sv;
+	const double slope_u = du > 0. ? (n*sua - su*sa) / du : 0.;
+	const double slope_v = dv > 0. ? (n*svb - sv*sb) / dv : 0.;
+	if( slope_u <= 0. || slope_v <= 0. )
+	{
+		cerr << "Not enough points to estimate the camera intrinsics, assuming 90 degrees field of view" << endl;
+		c.ppx = 0.5*camera_w;
+		c.ppy = 0.5*camera_h;
+		c.fx = 0.5*camera_w;
+		c.fy = 0.5*camera_w;
+		return c;
+	}
+	c.fx = 1. / slope_u;
+	c.fy = 1. / slope_v;
+	c.ppx = ( su - sa*c.fx ) / n;
+	c.ppy = ( sv - sb*c.fy ) / n;
+	return c;
+}
@@ -0,0 +1,49 @@
+/*
+ * ArchiveFrameSource.h
+ */
+
+#ifndef SRC_ARCHIVEFRAMESOURCE_H_
+#define SRC_ARCHIVEFRAMESOURCE_H_
+
+#include "FrameSource.h"
+#include <string>
+#include <vector>
+
+/* This class replays the pointclouds saved with --save-depth-to,
+ * every .dat file in a directory is one frame, the files are read in alphabetical
+ * (which is also chronological) order.
+ * The files hold only the vertices, so the image size has to be given,
+ * and the camera intrinsics are estimated from the vertices of the first frame.
+ */
+class ArchiveFrameSource: public FrameSource
+{
+public:
+	ArchiveFrameSource(
+			const std::string & directory,
+			int camera_w, //!< image size the frames were saved with
+			int camera_h
+			);
+	virtual bool WaitForFrame( Frame & frame );
+	virtual bool is_live()const
+	{ return false; }
+	virtual CameraIntrinsics get_intrinsics()const
+	{ return intrinsics; }
+	unsigned int size()const
+	{ return filenames.size(); }
+	// Fits the pinhole model to the vertices, x/z and y/z are linear in the pixel coordinates
+	static CameraIntrinsics EstimateIntrinsics( const Vertex * vertices, int camera_w, int camera_h );
+private:
+	bool ReadFrame( const std::string & filename, std::shared_ptr<std::vector<Vertex> > & vertices );
+
+public:
+	const std::string directory;
+	const int camera_w;
+	const int camera_h;
+private:
+	std::vector<std::string> filenames;
+	unsigned int next_file;
+	CameraIntrinsics intrinsics;
+	std::shared_ptr<std::vector<Vertex> > buffer; //!< reused when no frame holds it any more
+};
+
+#endif /* SRC_ARCHIVEFRAMESOURCE_H_ */
@@ -0,0 +1,270 @@
+/*
+ * BallDepthRenderer.cpp
+ */
+
+#include "BallDepthRenderer.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+const float INF = std::numeric_limits<float>::max();
+const float layer_near_distance = 0.25; //!< nearest layer starts here [m], closer depths are added to it
+const float layer_ratio = 1.5; //!< ratio between far and near limits of each layer
+}
+
+BallDepthRenderer::BallDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float base_frequency_doubling_length,
+	float background_amplitude,
+	float stereo_distance,
+	float lower_distance,
+	float lower_frequency,
+	float lower_frequency_doubling_length,
+	float lower_amplitude,
+	bool save_loudness,
+	const CameraIntrinsics & intrinsics,
+	float ball_radius,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, base_frequency_doubling_length, background_amplitude,
+		stereo_distance,
+		lower_distance, lower_frequency, lower_frequency_doubling_length, lower_amplitude,
+		save_loudness, distance_mapping ),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 ball_radius(ball_radius),
+	 num_layers( max_distance > layer_near_distance ?
+		 (unsigned int)ceil( log(max_distance/layer_near_distance) / log(layer_ratio) ) : 1 ),
+	 max_rx( min( (unsigned int)(ball_radius*intrinsics.fx/layer_near_distance), camera_w ) ),
+	 max_ry( min( (unsigned int)(ball_radius*intrinsics.fy/layer_near_distance), camera_h ) )
+{
+	layer_near = new float [num_layers+1];
+	layer_rx = new unsigned int [num_layers];
+	layer_ry = new unsigned int [num_layers];
+	for( unsigned int k=0; k<=num_layers; ++k )
+		layer_near[k] = layer_near_distance * pow( layer_ratio, k );
+	layer_near[0] = 0.;
+	layer_near[num_layers] = max_distance;
+	for( unsigned int k=0; k<num_layers; ++k )
+	{
+		// ball size in pixels at the geometric middle of the layer
+		const float z_near = k == 0 ? layer_near_distance : layer_near[k];
+		const float z_mid = sqrt( z_near * max(layer_near[k+1],z_near) );
+		layer_rx[k] = min( (unsigned int)(ball_radius*intrinsics.fx/z_mid), max_rx );
+		layer_ry[k] = min( (unsigned int)(ball_radius*intrinsics.fy/z_mid), max_ry );
+		cout << "Ball layer " << k << " : " << layer_near[k] << "m - " << layer_near[k+1] << "m, ";
+		cout << "window " << (2*layer_rx[k]+1) << "x" << (2*layer_ry[k]+1) << endl;
+	}
+
+	ray_x = new float [camera_w];
+	ray_y = new float [camera_h];
+	for( unsigned int u=0; u<camera_w; ++u )
+		ray_x[u] = (u - intrinsics.ppx) / intrinsics.fx;
+	for( unsigned int v=0; v<camera_h; ++v )
+		ray_y[v] = (v - intrinsics.ppy) / intrinsics.fy;
+
+	const unsigned int n = camera_w*camera_h;
+	const unsigned int n_buffer = max( (camera_h+2*max_ry)*camera_w, camera_h*(camera_w+2*max_rx) );
+	depth = new float [n];
+	layer = new float [n];
+	filled = new float [n];
+	prefix_min = new float [n_buffer];
+	suffix_min = new float [n_buffer];
+	filled_vertices = new Vertex [n];
+}
+
+BallDepthRenderer::~BallDepthRenderer()
+{
+	delete [] layer_near;
+	delete [] layer_rx;
+	delete [] layer_ry;
+	delete [] ray_x;
+	delete [] ray_y;
+	delete [] depth;
+	delete [] layer;
+	delete [] filled;
+	delete [] prefix_min;
+	delete [] suffix_min;
+	delete [] filled_vertices;
+}
+
+void BallDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	if( n_vertices != camera_w*camera_h )
+	{
+		cerr << "Ball renderer expects " << camera_w*camera_h << " vertices, got " << n_vertices;
+		cerr << ", rendering without filling holes" << endl;
+		SimpleDepthRenderer::RenderPointcloudToSound( vertices, n_vertices, sound_out, sound_n );
+		return;
+	}
+	FillHoles( vertices, filled_vertices );
+	SimpleDepthRenderer::RenderPointcloudToSound( filled_vertices, n_vertices, sound_out, sound_n );
+}
+
+void BallDepthRenderer::FillHoles(
+	const Vertex * vertices,
+	Vertex * vertices_out )
+{
+	const int n = camera_w*camera_h;
+
+	// Points farther than the max distance are not rendered anyway, so they don't need to be eroded
+#pragma omp parallel for
+	for( int i=0; i<n; ++i )
+	{
+		const float z = vertices[i].z;
+		depth[i] = ( z > 0.0001 && z < max_distance ) ? z : INF;
+		filled[i] = INF;
+	}
+
+	for( unsigned int k=0; k<num_layers; ++k )
+	{
+		const float z0 = layer_near[k];
+		const float z1 = layer_near[k+1];
+		int layer_n = 0;
+#pragma omp parallel for reduction(+:layer_n)
+		for( int i=0; i<n; ++i )
+		{
+			const bool in_layer = depth[i] >= z0 && depth[i] < z1;
+			layer[i] = in_layer ? depth[i] : INF;
+			layer_n += in_layer;
+		}
+		if( layer_n == 0 )
+			continue;
+
+		ErodeImage( layer, layer, layer_rx[k], layer_ry[k] );
+
+#pragma omp parallel for
+		for( int i=0; i<n; ++i )
+			filled[i] = min( filled[i], layer[i] );
+	}
+
+	// Convert depth back to vertices along the ray through each pixel
+#pragma omp parallel for
+	for( int v=0; v<(int)camera_h; ++v )
+	{
+		const float * filled_row = &filled[v*camera_w];
+		Vertex * out_row = &vertices_out[v*camera_w];
+		const float ry = ray_y[v];
+		for( unsigned int u=0; u<camera_w; ++u )
+		{
+			const float z = filled_row[u] < INF ? filled_row[u] : 0.;
+			out_row[u].x = ray_x[u]*z;
+			out_row[u].y = ry*z;
+			out_row[u].z = z;
+		}
+	}
+}
+
+void BallDepthRenderer::ErodeImage( const float * in, float * out, unsigned int rx, unsigned int ry )
+{
+	const int w = camera_w;
+	const int h = camera_h;
+
+	// Horizontal pass: van Herk/Gil-Werman on each (INF padded) row,
+	// the prefix and suffix minima are computed in blocks of the window size
+	{
+		const int W = 2*rx+1;
+		const int n = w + 2*rx;
+#pragma omp parallel for
+		for( int y=0; y<h; ++y )
+		{
+			const float * row_in = &in[y*w];
+			float * g = &prefix_min[y*n];
+			float * s = &suffix_min[y*n];
+			for( int p=0; p<n; ++p )
+				g[p] = ( p >= (int)rx && p < w+(int)rx ) ? row_in[p-rx] : INF;
+			for( int b0=0; b0<n; b0+=W )
+			{
+				const int b1 = min( b0+W, n );
+				s[b1-1] = g[b1-1];
+				for( int p=b1-2; p>=b0; --p )
+					s[p] = min( s[p+1], g[p] );
+				for( int p=b0+1; p<b1; ++p )
+					g[p] = min( g[p-1], g[p] );
+			}
+			float * row_out = &out[y*w];
+			for( int x=0; x<w; ++x )
+				row_out[x] = min( s[x], g[x+2*rx] );
+		}
+	}
+
+	// Vertical pass: same algorithm along the columns, but whole rows are processed at once,
+	// so that the inner loops run over contiguous memory and can be vectorized
+	{
+		const int W = 2*ry+1;
+		const int n = h + 2*ry;
+		const int n_blocks = (n + W - 1) / W;
+#pragma omp parallel for
+		for( int b=0; b<n_blocks; ++b )
+		{
+			const int b0 = b*W;
+			const int b1 = min( b0+W, n );
+			for( int p=b0; p<b1; ++p )
+			{
+				float * g = &prefix_min[p*w];
+				const bool is_image_row = p >= (int)ry && p < h+(int)ry;
+				if( is_image_row )
+				{
+					const float * row = &out[(p-ry)*w];
+#pragma omp simd
+					for( int x=0; x<w; ++x )
+						g[x] = row[x];
+				}
+				else
+				{
+#pragma omp simd
+					for( int x=0; x<w; ++x )
+						g[x] = INF;
+				}
+			}
+			float * s_last = &suffix_min[(b1-1)*w];
+			const float * g_last = &prefix_min[(b1-1)*w];
+#pragma omp simd
+			for( int x=0; x<w; ++x )
+				s_last[x] = g_last[x];
+			for( int p=b1-2; p>=b0; --p )
+			{
+				float * s = &suffix_min[p*w];
+				const float * s_next = &suffix_min[(p+1)*w];
+				const float * g = &prefix_min[p*w];
+#pragma omp simd
+				for( int x=0; x<w; ++x )
+					s[x] = min( s_next[x], g[x] );
+			}
+			for( int p=b0+1; p<b1; ++p )
+			{
+				float * g = &prefix_min[p*w];
+				const float * g_prev = &prefix_min[(p-1)*w];
+#pragma omp simd
+				for( int x=0; x<w; ++x )
+					g[x] = min( g_prev[x], g[x] );
+			}
+		}
+#pragma omp parallel for
+		for( int y=0; y<h; ++y )
+		{
+			float * row_out = &out[y*w];
+			const float * s = &suffix_min[y*w];
+			const float * g = &prefix_min[(y+2*ry)*w];
+#pragma omp simd
+			for( int x=0; x<w; ++x )
+				row_out[x] = min( s[x], g[x] );
+		}
+	}
+}
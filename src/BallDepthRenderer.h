@@ -0,0 +1,75 @@
+/*
+ * BallDepthRenderer.h
+ */
+
+#ifndef SRC_BALLDEPTHRENDERER_H_
+#define SRC_BALLDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+
+/* This class fills the holes in the depth image before rendering:
+ * the scene is rendered as the positions that a ball with a given radius
+ * thrown from the coordinate origin could reach, so that fences and
+ * thin poles become audible.
+ *
+ * The depth image is split into a few depth layers, and each layer is eroded
+ * (min filtered) with a window equal to the size of the ball at that depth.
+ * The erosion uses the van Herk/Gil-Werman algorithm, so its cost is linear
+ * in the number of pixels regardless of the ball radius.
+ * The filled depth image is converted back to vertices and rendered with
+ * the SimpleDepthRenderer.
+ */
+class BallDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	BallDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float freq_doubling_length,
+		float background_amplitude,
+		float stereo_distance,
+		float lower_distance,
+		float lower_frequency,
+		float lower_frequency_increase,
+		float lower_amplitude,
+		bool save_loudness,
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		float ball_radius, //!< radius of the thrown ball [m]
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual ~BallDepthRenderer();
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+	// Fills the holes in the vertices, output has camera_w*camera_h vertices
+	void FillHoles(
+			const Vertex * vertices,
+			Vertex * vertices_out );
+private:
+	// Erodes the image with a (2*rx+1)x(2*ry+1) window, in and out can be the same array
+	void ErodeImage( const float * in, float * out, unsigned int rx, unsigned int ry );
+public:
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const float ball_radius;
+	const unsigned int num_layers;
+	const unsigned int max_rx; //!< max window half-width in pixels
+	const unsigned int max_ry; //!< max window half-height in pixels
+private:
+	float * layer_near; //!< near depth limit of each layer, size num_layers+1
+	unsigned int * layer_rx; //!< window half-width of each layer
+	unsigned int * layer_ry; //!< window half-height of each layer
+	float * ray_x; //!< x/z of the ray through each column
+	float * ray_y; //!< y/z of the ray through each row
+	float * depth; //!< input depth, INF where there is no depth
+	float * layer; //!< depth of one layer, INF elsewhere
+	float * filled; //!< result of the hole filling
+	float * prefix_min; //!< van Herk prefix buffer, (camera_h+2*max_ry)*camera_w
+	float * suffix_min; //!< van Herk suffix buffer, (camera_h+2*max_ry)*camera_w
+	Vertex * filled_vertices;
+};
+
+#endif /* SRC_BALLDEPTHRENDERER_H_ */
@@ -0,0 +1,247 @@
+/*
+ * BinauralDepthRenderer.cpp
+ */
+
+#include "BinauralDepthRenderer.h"
+#include "RenderPlan.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+// The signal of each cell is its amplitude in each distance bin times the carrier of the plan
+class CellSignals: public BlockSource
+{
+public:
+	CellSignals( const RenderPlan & plan, const float * amplitudes )
+		:plan(plan), amplitudes(amplitudes)
+	{}
+	virtual bool GetBlock( unsigned int cell, unsigned int start, unsigned int n, float values[] )const
+	{
+		const unsigned int * sample_edges = plan.get_sample_edges();
+		const float * carrier = plan.get_carrier();
+		const float * cell_amplitudes = &amplitudes[cell*plan.n_bins];
+		const unsigned int end = start + n;
+		// the bin in which the block starts
+		unsigned int bin = upper_bound( sample_edges, sample_edges + plan.n_bins + 1, start ) - sample_edges;
+		bin = bin > 0 ? bin-1 : 0;
+		bool silent = true;
+		unsigned int j = start;
+		for( ; bin<plan.n_bins && j<end; ++bin )
+		{
+			const unsigned int bin_end = min( sample_edges[bin+1], end );
+			const float amplitude = cell_amplitudes[bin];
+			if( amplitude == 0.f )
+			{
+				for( ; j<bin_end; ++j )
+					values[j-start] = 0.f;
+				continue;
+			}
+			silent = false;
+			for( ; j<bin_end; ++j )
+				values[j-start] = amplitude * carrier[j];
+		}
+		for( ; j<end; ++j )
+			values[j-start] = 0.f;
+		return silent == false;
+	}
+private:
+	const RenderPlan & plan;
+	const float * amplitudes;
+};
+}
+
+BinauralDepthRenderer::BinauralDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float base_frequency_doubling_length,
+	bool save_loudness,
+	const CameraIntrinsics & intrinsics,
+	unsigned int azimuth_cells,
+	unsigned int elevation_cells,
+	const HrirSet & hrirs,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, base_frequency_doubling_length, 0., // no background
+		0., // the HRIRs place the ears
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 azimuth_cells( max( azimuth_cells, 1u ) ),
+	 elevation_cells( max( elevation_cells, 1u ) ),
+	 n_cells( this->azimuth_cells * this->elevation_cells ),
+	 pixel_cell( camera_w*camera_h ),
+	 cell_amplitudes( n_cells*max_counter ),
+	 convolver( this->distance_mapping->sample_rate / 400 ) // partitions of about 3 ms
+{
+	// Directions of the pixels as in HrirSet, camera x points right and y down
+	std::vector<float> pixel_azimuth( camera_w*camera_h ), pixel_elevation( camera_w*camera_h );
+	float azimuth_min = 180., azimuth_max = -180., elevation_min = 90., elevation_max = -90.;
+	for( unsigned int v=0; v<camera_h; ++v )
+	{
+		for( unsigned int u=0; u<camera_w; ++u )
+		{
+			const float x = (u - intrinsics.ppx) / intrinsics.fx;
+			const float y = (v - intrinsics.ppy) / intrinsics.fy;
+			const unsigned int i = v*camera_w + u;
+			pixel_azimuth[i] = atan2( -x, 1.f ) * 180. / M_PI;
+			pixel_elevation[i] = atan2( -y, sqrt( 1.f + x*x ) ) * 180. / M_PI;
+			azimuth_min = min( azimuth_min, pixel_azimuth[i] );
+			azimuth_max = max( azimuth_max, pixel_azimuth[i] );
+			elevation_min = min( elevation_min, pixel_elevation[i] );
+			elevation_max = max( elevation_max, pixel_elevation[i] );
+		}
+	}
+	const float azimuth_step = max( azimuth_max - azimuth_min, 1e-3f ) / this->azimuth_cells;
+	const float elevation_step = max( elevation_max - elevation_min, 1e-3f ) / this->elevation_cells;
+	for( unsigned int i=0; i<camera_w*camera_h; ++i )
+	{
+		const unsigned int a = min( (unsigned int)( (pixel_azimuth[i] - azimuth_min) / azimuth_step ), this->azimuth_cells-1 );
+		const unsigned int e = min( (unsigned int)( (pixel_elevation[i] - elevation_min) / elevation_step ), this->elevation_cells-1 );
+		pixel_cell[i] = e*this->azimuth_cells + a;
+	}
+
+	// the HRIRs of the cell centres
+	std::vector<float> left, right;
+	for( unsigned int e=0; e<this->elevation_cells; ++e )
+	{
+		for( unsigned int a=0; a<this->azimuth_cells; ++a )
+		{
+			hrirs.GetHrir( azimuth_min + (a+0.5)*azimuth_step, elevation_min + (e+0.5)*elevation_step, left, right );
+			convolver.AddInput( left, right );
+		}
+	}
+	cout << "Binaural cells : " << this->azimuth_cells << " x " << this->elevation_cells << ", azimuth " <<
+			azimuth_min << " - " << azimuth_max << " deg, elevation " <<
+			elevation_min << " - " << elevation_max << " deg, " <<
+			(hrirs.is_measured() ? "measured HRIRs" : "spherical head") << ", " <<
+			left.size() << " taps in partitions of " << convolver.block_n << " samples" << endl;
+
+	const unsigned int n_per_thread = n_cells*max_counter;
+	cell_counters = new unsigned int * [num_counters];
+	cell_counters[0] = new unsigned int [num_counters*n_per_thread];
+	for( int i=1; i<num_counters; ++i )
+		cell_counters[i] = &cell_counters[0][n_per_thread*i];
+}
+
+BinauralDepthRenderer::~BinauralDepthRenderer()
+{
+	delete [] cell_counters[0];
+	delete [] cell_counters;
+}
+
+void BinauralDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	if( n_vertices != camera_w*camera_h )
+	{
+		cerr << "Binaural renderer expects " << camera_w*camera_h << " vertices, got " << n_vertices;
+		cerr << ", rendering without HRIRs" << endl;
+		SimpleDepthRenderer::RenderPointcloudToSound( vertices, n_vertices, sound_out, sound_n );
+		return;
+	}
+	UpdatePointWeights( vertices, n_vertices );
+	const std::vector<PointSpan> & spans = GetPointSpans( n_vertices );
+
+	const unsigned int n_per_thread = n_cells*max_counter;
+	int num_used_counters = 1;
+#pragma omp parallel default(shared)
+	{
+
+#if defined _OPENMP
+		unsigned int * my_counter = cell_counters[omp_get_thread_num()];
+#pragma omp single
+		{
+			num_used_counters = omp_get_num_threads();
+		}
+#else
+		unsigned int * my_counter = cell_counters[0];
+#endif
+
+		// DO NOT OMP PARALLELIZE
+		for( int i=0; i<n_per_thread; ++i )
+			my_counter[i] = 0;
+
+		// the distances are those from the centre of the head
+#pragma omp for
+		for( int s=0; s<(int)spans.size(); ++s )
+		{
+			for( unsigned int i=spans[s].begin; i<spans[s].end; ++i )
+			{
+				Vertex const & p = vertices[i];
+				if( p.z < 0.0001 )
+					continue;
+				const unsigned int i_bin = distance_mapping->BinOf( sqrt( p.x*p.x + p.y*p.y + p.z*p.z ) );
+				if( i_bin < max_counter )
+					my_counter[pixel_cell[i]*max_counter + i_bin] += point_weights != NULL ? point_weights[i] : 1;
+			}
+		}
+	} // end openMP parallel region
+
+	// move all counts to counter 0
+	for( int i=1; i<num_used_counters; ++i )
+	{
+#pragma omp parallel for default(shared)
+		for( int j=0; j<n_per_thread; ++j )
+		{
+			cell_counters[0][j] += cell_counters[i][j];
+			cell_counters[i][j] = 0;
+		}
+	}
+
+	// The cells are normalized as parts of one image, like the simple renderer
+	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
+	const RenderPlan & plan = GetRenderPlan( base_frequency, freq_doubling_length / speed_of_sound, sound_n );
+	const float * loudness_scale = distance_mapping->get_loudness_scale();
+	const float * loudness_correction = plan.get_loudness_correction();
+	for( unsigned int c=0; c<n_cells; ++c )
+	{
+		const unsigned int * counts = SmoothCounts( &cell_counters[0][c*max_counter] );
+		float * amplitudes = &cell_amplitudes[c*max_counter];
+		for( unsigned int i=0; i<max_counter; ++i )
+		{
+			const float amplitude = audio_A * loudness_correction[i] *
+					RenderPlan::AmplitudeOfLoudness( loudness_scale[i] * counts[i] / amp_div );
+			amplitudes[i] = min( amplitude, (float)audio_A );
+		}
+	}
+
+	if( synthesize )
+	{
+		if( mix_bus.size() != 2*sound_n )
+			mix_bus.assign( 2*sound_n, 0.f );
+		convolver.ConvolveAndMix( CellSignals( plan, &cell_amplitudes[0] ), &mix_bus[0], &mix_bus[sound_n], sound_n );
+		SoundRenderer::ConvertMixBusToSound( &mix_bus[0], &mix_bus[sound_n], sound_out, sound_n );
+	}
+
+	if( save_loudness )
+	{
+		// loudness of all cells together, the same for both ears
+#pragma omp parallel for
+		for( int i=0; i<loudness_n_per_channel; ++i )
+		{
+			unsigned int counts = 0;
+			float amplitude = 0.;
+			for( unsigned int c=0; c<n_cells; ++c )
+			{
+				counts += cell_counters[0][c*max_counter + i];
+				amplitude += cell_amplitudes[c*max_counter + i] / audio_A;
+			}
+			loudness_data[2*i] = loudness_data[2*i+1] = ((float)counts) / amp_div;
+			amplitudes_data[2*i] = amplitudes_data[2*i+1] = amplitude;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+/*
+ * BinauralDepthRenderer.h
+ */
+
+#ifndef SRC_BINAURALDEPTHRENDERER_H_
+#define SRC_BINAURALDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+#include "Convolution.h"
+#include "Hrir.h"
+
+/* This class renders the direction of the points with head related impulse responses (HRIRs)
+ * instead of two ears stereo_distance apart.
+ * The field of view is split into cells of equal azimuth and elevation angles,
+ * each point is binned into the distance histogram of its cell (distance from the head centre)
+ * in a single pass over the pointcloud, and each cell is rendered to a mono signal
+ * with the carrier of the simple renderer.
+ * The cell signals are convolved with the HRIR pairs of the cell centres and mixed
+ * by uniformly partitioned FFT convolution, the HRIR spectra are computed once by the constructor.
+ */
+class BinauralDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	BinauralDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float freq_doubling_length,
+		bool save_loudness,
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		unsigned int azimuth_cells, //!< number of cells across the image
+		unsigned int elevation_cells, //!< number of cells down the image
+		const HrirSet & hrirs,
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual ~BinauralDepthRenderer();
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+public:
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const unsigned int azimuth_cells;
+	const unsigned int elevation_cells;
+	const unsigned int n_cells;
+private:
+	std::vector<uint16_t> pixel_cell; //!< cell of each pixel
+	unsigned int **cell_counters; //!< [cell][bin] counts for each omp thread
+	std::vector<float> cell_amplitudes; //!< [cell][bin] amplitudes of the cell signals
+	UniformlyPartitionedConvolver convolver; //!< input i is cell i
+};
+
+#endif /* SRC_BINAURALDEPTHRENDERER_H_ */
@@ -0,0 +1,88 @@
+/*
+ * ControlSocket.cpp
+ */
+
+#include "ControlSocket.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <iostream>
+
+using namespace std;
+
+ControlSocket::ControlSocket( const std::string & path )
+	:path(path),
+	 fd(-1)
+{
+	struct sockaddr_un addr;
+	if( path.length() >= sizeof(addr.sun_path) )
+	{
+		cerr << "Control socket path is too long : " << path << endl;
+		return;
+	}
+	fd = socket( AF_UNIX, SOCK_DGRAM, 0 );
+	if( fd < 0 )
+	{
+		perror("Error creating control socket");
+		return;
+	}
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strncpy( addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1 );
+	unlink( path.c_str() ); // remove the socket file left by a previous run
+	if( bind( fd, (struct sockaddr *)&addr, sizeof(addr) ) != 0 )
+	{
+		perror("Error binding control socket");
+		close(fd);
+		fd = -1;
+		return;
+	}
+	cout << "Listening for control messages on " << path << endl;
+}
+
+ControlSocket::~ControlSocket()
+{
+	if( fd >= 0 )
+	{
+		close(fd);
+		unlink( path.c_str() );
+	}
+}
+
+bool ControlSocket::Receive( std::string & message, int timeout_ms )
+{
+	if( fd < 0 )
+		return false;
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if( poll( &pfd, 1, timeout_ms ) <= 0 || (pfd.revents & POLLIN) == 0 )
+		return false;
+	char buffer[max_message_length];
+	const ssize_t n = recv( fd, buffer, sizeof(buffer), 0 );
+	if( n < 0 )
+	{
+		if( errno != EINTR && errno != EAGAIN )
+			perror("Error receiving control message");
+		return false;
+	}
+	message.assign( buffer, n );
+	return true;
+}
+
+std::vector<std::string> ControlSocket::SplitMessage( const std::string & message )
+{
+	std::vector<std::string> parameters;
+	std::stringstream ss(message);
+	std::string parameter;
+	while( ss >> parameter )
+		parameters.push_back(parameter);
+	return parameters;
+}
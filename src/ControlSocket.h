@@ -0,0 +1,34 @@
+/*
+ * ControlSocket.h
+ */
+
+#ifndef SRC_CONTROLSOCKET_H_
+#define SRC_CONTROLSOCKET_H_
+
+#include <string>
+#include <vector>
+
+/* This class receives control messages on a UNIX domain datagram socket,
+ * one message per datagram, e.g.
+ * python3 -c 'import socket; s=socket.socket(socket.AF_UNIX,socket.SOCK_DGRAM); s.sendto(b"...","<path>")'
+ * A message is a list of command line parameters separated by whitespace.
+ */
+class ControlSocket
+{
+public:
+	ControlSocket( const std::string & path );
+	~ControlSocket();
+	bool is_open()const
+	{ return fd >= 0; }
+	// Waits up to timeout_ms for a message, returns false if none arrived
+	bool Receive( std::string & message, int timeout_ms );
+	// Splits a message into whitespace separated parameters
+	static std::vector<std::string> SplitMessage( const std::string & message );
+
+	const std::string path;
+	static const unsigned int max_message_length = 4096;
+private:
+	int fd;
+};
+
+#endif /* SRC_CONTROLSOCKET_H_ */
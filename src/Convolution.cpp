@@ -0,0 +1,287 @@
+/*
+ * Convolution.cpp
+ */
+
+#include "Convolution.h"
+#include <algorithm>
+#include <string.h>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+// FFT size for a filter: blocks of at least three filter lengths amortize the FFTs,
+// and 256 samples keep short filters from spending their time in loop overhead
+unsigned int OverlapAddSize( unsigned int filter_n )
+{
+	return FFT::SizeFor( max( 4*max( filter_n, 1u ), 256u ) );
+}
+}
+
+OverlapAddConvolver::OverlapAddConvolver(
+	const std::vector<float> & filter
+	)
+	:filter_n( max( (unsigned int)filter.size(), 1u ) ),
+	 block_n( OverlapAddSize(filter_n) - filter_n + 1 ),
+#if defined _OPENMP
+	 num_threads(omp_get_max_threads()),
+#else
+	 num_threads(1),
+#endif
+	 fft( OverlapAddSize(filter_n) ),
+	 filter_spectrum( fft.n, complex_t( 0.f, 0.f ) ),
+	 thread_values( num_threads, std::vector<complex_t>( fft.n ) )
+{
+	for( unsigned int i=0; i<filter.size(); ++i )
+		filter_spectrum[i] = complex_t( filter[i], 0.f );
+	fft.Forward( &filter_spectrum[0] );
+}
+
+void OverlapAddConvolver::ConvolvePair(
+	const float in_a[],
+	const float in_b[],
+	float out_a[],
+	float out_b[],
+	const unsigned int n
+	)const
+{
+	memset( out_a, 0, n*sizeof(float) );
+	memset( out_b, 0, n*sizeof(float) );
+	const int n_blocks = (n + block_n - 1) / block_n;
+
+	// The output of a block overlaps only the output of the next block (block_n >= filter_n),
+	// so the even and the odd blocks are each added in parallel without conflicts
+	for( int parity=0; parity<2; ++parity )
+	{
+#pragma omp parallel default(shared)
+		{
+#if defined _OPENMP
+			std::vector<complex_t> & values = thread_values[omp_get_thread_num()];
+#else
+			std::vector<complex_t> & values = thread_values[0];
+#endif
+#pragma omp for schedule(dynamic)
+			for( int k=parity; k<n_blocks; k+=2 )
+			{
+				const unsigned int start = k*block_n;
+				const unsigned int in_n = min( block_n, n - start );
+				bool silent = true;
+				for( unsigned int i=0; i<in_n && silent; ++i )
+					silent = in_a[start+i] == 0.f && in_b[start+i] == 0.f;
+				if( silent )
+					continue;
+
+				for( unsigned int i=0; i<in_n; ++i )
+					values[i] = complex_t( in_a[start+i], in_b[start+i] );
+				for( unsigned int i=in_n; i<fft.n; ++i )
+					values[i] = complex_t( 0.f, 0.f );
+				fft.Forward( &values[0] );
+				for( unsigned int i=0; i<fft.n; ++i )
+				{
+					const complex_t v = values[i];
+					const complex_t h = filter_spectrum[i];
+					values[i] = complex_t( v.real()*h.real() - v.imag()*h.imag(), v.real()*h.imag() + v.imag()*h.real() );
+				}
+				fft.Inverse( &values[0] );
+
+				const unsigned int out_n = min( in_n + filter_n - 1, n - start );
+				for( unsigned int i=0; i<out_n; ++i )
+				{
+					out_a[start+i] += values[i].real();
+					out_b[start+i] += values[i].imag();
+				}
+			}
+		} // end openMP parallel region
+	}
+}
+
+UniformlyPartitionedConvolver::UniformlyPartitionedConvolver(
+	unsigned int block_n
+	)
+	:block_n( FFT::SizeFor(block_n) ),
+#if defined _OPENMP
+	 num_threads(omp_get_max_threads()),
+#else
+	 num_threads(1),
+#endif
+	 fft( 2*this->block_n ),
+	 n_partitions(0),
+	 thread_scratch( num_threads )
+{
+	for( int t=0; t<num_threads; ++t )
+	{
+		thread_scratch[t].values.resize( fft.n );
+		thread_scratch[t].mix.resize( fft.n );
+	}
+}
+
+unsigned int UniformlyPartitionedConvolver::AddInput( const std::vector<float> & filter_a, const std::vector<float> & filter_b )
+{
+	const unsigned int filter_n = max( (unsigned int)max( filter_a.size(), filter_b.size() ), 1u );
+	const unsigned int partitions = (filter_n + block_n - 1) / block_n;
+	n_partitions = max( n_partitions, partitions );
+	// each partition is zero padded to two blocks, for the overlap-save of the input windows
+	std::vector<complex_t> spectra( partitions*fft.n, complex_t( 0.f, 0.f ) );
+	for( unsigned int k=0; k<partitions; ++k )
+	{
+		for( unsigned int t=0; t<block_n; ++t )
+		{
+			const unsigned int i = k*block_n + t;
+			spectra[k*fft.n + t] = complex_t( i < filter_a.size() ? filter_a[i] : 0.f, i < filter_b.size() ? filter_b[i] : 0.f );
+		}
+		fft.Forward( &spectra[k*fft.n] );
+	}
+	filter_spectra.push_back( spectra );
+
+	const unsigned int n_inputs = filter_spectra.size();
+	for( int t=0; t<num_threads; ++t )
+	{
+		ThreadScratch & s = thread_scratch[t];
+		s.windows.resize( n_inputs*fft.n );
+		s.current_silent.resize( n_inputs );
+		s.delay_line.resize( n_inputs*n_partitions*fft.n );
+		s.delay_line_silent.resize( n_inputs*n_partitions );
+		s.active_inputs.reserve( n_inputs );
+	}
+	return filter_spectra.size()-1;
+}
+
+void UniformlyPartitionedConvolver::ConvolveAndMix(
+	const BlockSource & source,
+	float out_a[],
+	float out_b[],
+	const unsigned int n
+	)const
+{
+	const unsigned int n_inputs = filter_spectra.size();
+	const int n_blocks = (n + block_n - 1) / block_n;
+	if( n_inputs == 0 )
+	{
+		memset( out_a, 0, n*sizeof(float) );
+		memset( out_b, 0, n*sizeof(float) );
+		return;
+	}
+#pragma omp parallel default(shared)
+	{
+#if defined _OPENMP
+		const int thread = omp_get_thread_num();
+		const int n_threads = omp_get_num_threads();
+#else
+		const int thread = 0;
+		const int n_threads = 1;
+#endif
+		// Each thread mixes consecutive blocks, its delay line is warmed up
+		// with the input blocks that still echo in its first block
+		const int blocks_per_thread = (n_blocks + n_threads - 1) / n_threads;
+		const int b_begin = min( n_blocks, thread*blocks_per_thread );
+		const int b_end = min( n_blocks, b_begin + blocks_per_thread );
+		const int b_first = max( 0, b_begin - (int)n_partitions + 1 );
+
+		ThreadScratch & s = thread_scratch[thread];
+		std::vector<float> & windows = s.windows;
+		std::vector<char> & current_silent = s.current_silent;
+		std::vector<complex_t> & delay_line = s.delay_line;
+		std::vector<char> & delay_line_silent = s.delay_line_silent;
+		std::vector<complex_t> & values = s.values;
+		std::vector<complex_t> & mix = s.mix;
+		std::vector<unsigned int> & active_inputs = s.active_inputs;
+		fill( windows.begin(), windows.end(), 0.f );
+		fill( current_silent.begin(), current_silent.end(), 1 );
+		fill( delay_line_silent.begin(), delay_line_silent.end(), 1 );
+
+		for( int b=(b_first > 0 ? b_first-1 : 0); b<b_end; ++b )
+		{
+			const unsigned int start = b*block_n;
+			const unsigned int in_n = min( block_n, n - start );
+			const unsigned int slot = b % n_partitions;
+			active_inputs.clear();
+			for( unsigned int i=0; i<n_inputs; ++i )
+			{
+				float * window = &windows[i*fft.n];
+				memcpy( window, window + block_n, block_n*sizeof(float) );
+				const bool previous_silent = current_silent[i];
+				current_silent[i] = source.GetBlock( i, start, in_n, window + block_n ) == false;
+				if( current_silent[i] )
+					memset( window + block_n, 0, block_n*sizeof(float) );
+				else
+					memset( window + block_n + in_n, 0, (block_n - in_n)*sizeof(float) );
+				delay_line_silent[i*n_partitions + slot] = previous_silent && current_silent[i];
+				if( delay_line_silent[i*n_partitions + slot] == false )
+					active_inputs.push_back( i );
+			}
+			if( b < b_first )
+				continue; // only the window of the block before the first one
+
+			// two real inputs share one FFT, their spectra are separated by their symmetry
+			for( unsigned int k=0; k<active_inputs.size(); k+=2 )
+			{
+				const unsigned int i = active_inputs[k];
+				const float * window_i = &windows[i*fft.n];
+				complex_t * spectrum_i = &delay_line[(i*n_partitions + slot)*fft.n];
+				if( k+1 == active_inputs.size() )
+				{
+					for( unsigned int t=0; t<fft.n; ++t )
+						spectrum_i[t] = complex_t( window_i[t], 0.f );
+					fft.Forward( spectrum_i );
+					continue;
+				}
+				const unsigned int j = active_inputs[k+1];
+				const float * window_j = &windows[j*fft.n];
+				complex_t * spectrum_j = &delay_line[(j*n_partitions + slot)*fft.n];
+				for( unsigned int t=0; t<fft.n; ++t )
+					values[t] = complex_t( window_i[t], window_j[t] );
+				fft.Forward( &values[0] );
+				for( unsigned int f=0; f<fft.n; ++f )
+				{
+					const complex_t z = values[f];
+					const complex_t z_mirror = conj( values[(fft.n - f) & (fft.n - 1)] );
+					const complex_t sum = z + z_mirror;
+					const complex_t difference = z - z_mirror;
+					spectrum_i[f] = complex_t( 0.5f*sum.real(), 0.5f*sum.imag() );
+					spectrum_j[f] = complex_t( 0.5f*difference.imag(), -0.5f*difference.real() );
+				}
+			}
+			if( b < b_begin )
+				continue;
+
+			bool silent = true;
+			for( unsigned int i=0; i<n_inputs; ++i )
+			{
+				const unsigned int partitions = filter_spectra[i].size() / fft.n;
+				for( unsigned int k=0; k<partitions && (int)k<=b; ++k )
+				{
+					const unsigned int delayed_slot = (b - k) % n_partitions;
+					if( delay_line_silent[i*n_partitions + delayed_slot] )
+						continue;
+					if( silent )
+					{
+						for( unsigned int f=0; f<fft.n; ++f )
+							mix[f] = complex_t( 0.f, 0.f );
+						silent = false;
+					}
+					const complex_t * x = &delay_line[(i*n_partitions + delayed_slot)*fft.n];
+					const complex_t * h = &filter_spectra[i][k*fft.n];
+					for( unsigned int f=0; f<fft.n; ++f )
+						mix[f] += complex_t( x[f].real()*h[f].real() - x[f].imag()*h[f].imag(),
+								x[f].real()*h[f].imag() + x[f].imag()*h[f].real() );
+				}
+			}
+			if( silent )
+			{
+				memset( &out_a[start], 0, in_n*sizeof(float) );
+				memset( &out_b[start], 0, in_n*sizeof(float) );
+				continue;
+			}
+			// the second half of the circular convolution is the linear one
+			fft.Inverse( &mix[0] );
+			for( unsigned int t=0; t<in_n; ++t )
+			{
+				out_a[start+t] = mix[block_n+t].real();
+				out_b[start+t] = mix[block_n+t].imag();
+			}
+		}
+	} // end openMP parallel region
+}
@@ -0,0 +1,103 @@
+/*
+ * Convolution.h
+ */
+
+#ifndef SRC_CONVOLUTION_H_
+#define SRC_CONVOLUTION_H_
+
+#include "FFT.h"
+#include <vector>
+
+/* This class convolves long signals with a short fixed filter by overlap-add FFT convolution.
+ * The spectrum of the filter is computed once by the constructor,
+ * each block of the input then costs one forward and one inverse FFT.
+ * Two real signals (e.g. the L and R channels) are convolved at once,
+ * as the real and imaginary parts of one complex signal, which works because the filter is real.
+ * Blocks in which both signals are silent are skipped.
+ */
+class OverlapAddConvolver
+{
+public:
+	OverlapAddConvolver(
+		const std::vector<float> & filter //!< impulse response, must not be empty
+			);
+	// Sets out_a and out_b to the convolutions of in_a and in_b with the filter, truncated to n samples
+	// (the outputs must not be the inputs)
+	void ConvolvePair(
+			const float in_a[],
+			const float in_b[],
+			float out_a[],
+			float out_b[],
+			const unsigned int n
+			)const;
+
+	const unsigned int filter_n;
+	const unsigned int block_n; //!< input samples per FFT
+	const int num_threads;
+private:
+	FFT fft;
+	std::vector<complex_t> filter_spectrum;
+	mutable std::vector< std::vector<complex_t> > thread_values; //!< scratch of each omp thread, fft.n values each
+};
+
+/* This class is the source of the inputs of a UniformlyPartitionedConvolver,
+ * which asks for the inputs block by block.
+ */
+class BlockSource
+{
+public:
+	virtual ~BlockSource() {}
+	// Sets values to the samples [start,start+n) of an input,
+	// returns false if they are all zero (values need not be set then)
+	virtual bool GetBlock( unsigned int input, unsigned int start, unsigned int n, float values[] )const = 0;
+};
+
+/* This class convolves several real inputs, each with its own pair of filters
+ * (e.g. the HRIRs of the L and R ears for the direction of the input),
+ * and mixes the results into two outputs, by uniformly partitioned FFT convolution.
+ * The filters are split into partitions of block_n samples whose spectra are cached,
+ * so each block of an input costs one FFT (two inputs share one FFT)
+ * and one complex multiply-add per partition, each block of the mix costs one inverse FFT.
+ * The two filters of a pair are convolved at once, as the real and imaginary parts of one complex filter.
+ * Blocks in which an input is silent are skipped.
+ */
+class UniformlyPartitionedConvolver
+{
+public:
+	UniformlyPartitionedConvolver(
+		unsigned int block_n //!< rounded up to a power of two
+			);
+	// Adds an input with its filters, returns the index of the input
+	unsigned int AddInput( const std::vector<float> & filter_a, const std::vector<float> & filter_b );
+	// Sets out_a and out_b to the mix of the first n samples of the inputs convolved with their filters
+	void ConvolveAndMix(
+			const BlockSource & source,
+			float out_a[],
+			float out_b[],
+			const unsigned int n
+			)const;
+
+	unsigned int get_n_inputs()const
+	{ return filter_spectra.size(); }
+
+	const unsigned int block_n;
+	const int num_threads;
+private:
+	// Buffers of an omp thread of ConvolveAndMix, sized by AddInput
+	struct ThreadScratch
+	{
+		std::vector<float> windows; //!< the previous and the current block of each input
+		std::vector<char> current_silent; //!< of each input
+		std::vector<complex_t> delay_line; //!< spectra of the windows of the last n_partitions blocks of each input, in a ring
+		std::vector<char> delay_line_silent;
+		std::vector<complex_t> values;
+		std::vector<complex_t> mix;
+		std::vector<unsigned int> active_inputs;
+	};
+	FFT fft; //!< of two blocks
+	unsigned int n_partitions; //!< of the longest filter
+	std::vector< std::vector<complex_t> > filter_spectra; //!< the partitions of each input, fft.n values each
+	mutable std::vector<ThreadScratch> thread_scratch;
+};
+
+#endif /* SRC_CONVOLUTION_H_ */
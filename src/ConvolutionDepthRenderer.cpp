@@ -0,0 +1,159 @@
+/*
+ * ConvolutionDepthRenderer.cpp
+ */
+
+#include "ConvolutionDepthRenderer.h"
+#include "RenderPlan.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+// Hann windowed pulse of the phase (in periods) at each sample
+template<typename Phase>
+std::vector<float> MakeWindowedPulse( unsigned int n, Phase phase )
+{
+	std::vector<float> pulse( n );
+	for( unsigned int j=0; j<n; ++j )
+	{
+		const double window = 0.5 - 0.5*cos( 2*M_PI*(j+0.5)/n );
+		pulse[j] = window * sin( 2*M_PI*phase(j) );
+	}
+	return pulse;
+}
+
+struct ConstantPhase
+{
+	double frequency_per_sample;
+	double operator()( unsigned int j )const
+	{ return frequency_per_sample*j; }
+};
+
+// the frequency doubles every half of the pulse
+struct SweepPhase
+{
+	double frequency_per_sample;
+	double rate; //!< [1/sample]
+	double operator()( unsigned int j )const
+	{ return frequency_per_sample / rate * ( exp( rate*j ) - 1. ); }
+};
+
+std::vector<float> LoadPulse( const std::string & filename )
+{
+	std::ifstream f( filename.c_str(), std::ios_base::binary | std::ios_base::ate );
+	if( f.is_open() == false )
+		return std::vector<float>();
+	const unsigned int n = (unsigned int)f.tellg() / sizeof(int16_t);
+	std::vector<int16_t> samples( n );
+	f.seekg( 0 );
+	if( n == 0 || f.read( (char *)&samples[0], n*sizeof(int16_t) ).good() == false )
+		return std::vector<float>();
+	std::vector<float> pulse( n );
+	float peak = 0.f;
+	for( unsigned int j=0; j<n; ++j )
+	{
+		pulse[j] = samples[j];
+		peak = max( peak, fabs( pulse[j] ) );
+	}
+	if( peak == 0.f )
+		return std::vector<float>();
+	for( unsigned int j=0; j<n; ++j )
+		pulse[j] /= peak;
+	return pulse;
+}
+}
+
+ConvolutionDepthRenderer::ConvolutionDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float stereo_distance,
+	bool save_loudness,
+	const std::vector<float> & pulse,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, -1., 0., // neither chirped carrier nor background
+		stereo_distance,
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 convolver( pulse )
+{
+	cout << "Echo pulse : " << pulse.size() << " samples, FFT blocks of " << convolver.block_n << " samples" << endl;
+}
+
+std::vector<float> ConvolutionDepthRenderer::MakePulse(
+	const std::string & name,
+	float frequency,
+	float duration,
+	unsigned int sample_rate
+	)
+{
+	const unsigned int n = max( (unsigned int)( duration * sample_rate + 0.5 ), 1u );
+	if( name == "chirp" )
+	{
+		const SweepPhase phase = { (double)frequency / sample_rate, 2.*log(2.) / n };
+		return MakeWindowedPulse( n, phase );
+	}
+	if( name != "click" )
+	{
+		const std::vector<float> pulse = LoadPulse( name );
+		if( pulse.empty() == false )
+			return pulse;
+		cerr << "Could not read the echo pulse " << name << ", using a click" << endl;
+	}
+	const ConstantPhase phase = { (double)frequency / sample_rate };
+	return MakeWindowedPulse( n, phase );
+}
+
+void ConvolutionDepthRenderer::RenderCountsToSound(
+	const unsigned int counts[],
+	const unsigned int amp_div,
+	audio_t sound_out[],
+	unsigned int sound_n,
+	int channel,
+	float frequency,
+	audio_t max_amplitude,
+	bool set_not_add,
+	float frequency_doubling_length,
+	float background_amplitude,
+	float * amplitude_values
+	)
+{
+	counts = SmoothCounts( counts );
+	if( mix_bus.size() != 2*sound_n )
+		mix_bus.assign( 2*sound_n, 0.f );
+	float * impulses = &mix_bus[channel*sound_n];
+	if( set_not_add )
+		memset( impulses, 0, sound_n*sizeof(float) );
+
+	// the loudness of a bin is that of the sine renderers, without the equal loudness correction
+	const unsigned int * sample_edges = distance_mapping->get_sample_edges();
+	const float * loudness_scale = distance_mapping->get_loudness_scale();
+	const float inv_max_expected = 1.f / amp_div;
+	for( unsigned int i=0; i<max_counter; ++i )
+	{
+		const float loudness = loudness_scale[i] * counts[i] * inv_max_expected;
+		const float amplitude = min( max_amplitude * RenderPlan::AmplitudeOfLoudness( loudness ), (float)max_amplitude );
+		if( amplitude_values != NULL )
+			amplitude_values[2*i+channel] = amplitude / max_amplitude;
+		const unsigned int j = (sample_edges[i] + sample_edges[i+1]) / 2;
+		if( amplitude > 0.f && j < sound_n )
+			impulses[j] += amplitude;
+	}
+}
+
+void ConvolutionDepthRenderer::MixBusToSound( audio_t sound_out[], unsigned int sound_n )
+{
+	if( synthesize == false || mix_bus.size() != 2*sound_n )
+		return;
+	echoes.resize( 2*sound_n );
+	convolver.ConvolvePair( &mix_bus[0], &mix_bus[sound_n], &echoes[0], &echoes[sound_n], sound_n );
+	SoundRenderer::ConvertMixBusToSound( &echoes[0], &echoes[sound_n], sound_out, sound_n );
+}
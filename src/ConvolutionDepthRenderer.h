@@ -0,0 +1,67 @@
+/*
+ * ConvolutionDepthRenderer.h
+ */
+
+#ifndef SRC_CONVOLUTIONDEPTHRENDERER_H_
+#define SRC_CONVOLUTIONDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+#include "Convolution.h"
+#include <string>
+#include <vector>
+
+/* This class renders the echoes of an emitted pulse instead of a carrier.
+ * The distance histogram of each ear is turned into an impulse response,
+ * one impulse in the middle of each distance bin with the amplitude of the bin,
+ * and the impulse responses are convolved with the pulse (a click, a chirp
+ * or a recorded click) by overlap-add FFT convolution, both ears at once.
+ * The spectrum of the pulse is computed once, when the renderer is constructed.
+ */
+class ConvolutionDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	ConvolutionDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float stereo_distance,
+		bool save_loudness,
+		const std::vector<float> & pulse, //!< emitted pulse at the sample rate of the distance mapping, peak amplitude 1
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+
+	// Pulse named by --renderer-echo-pulse: "click" (a Hann windowed sine at the frequency),
+	// "chirp" (an exponential sweep from the frequency over two octaves)
+	// or the file name of a recorded pulse (raw 16 bit mono samples at the sample rate).
+	// A pulse that cannot be read is replaced by the click
+	static std::vector<float> MakePulse(
+			const std::string & name,
+			float frequency, //!< [Hz]
+			float duration, //!< of the click and the chirp [s]
+			unsigned int sample_rate //!< [Hz]
+			);
+protected:
+	// Sets the impulses of the counts in one channel of the mix bus
+	virtual void RenderCountsToSound(
+			const unsigned int counts[],
+			const unsigned int amp_div,
+			audio_t sound_out[],
+			unsigned int sound_n,
+			int channel,
+			float frequency,
+			audio_t max_amplitude,
+			bool set_not_add,
+			float frequency_doubling_length,
+			float background_amplitude,
+			float * amplitude_values
+			);
+	// Convolves the impulse responses in the mix bus with the pulse
+	virtual void MixBusToSound( audio_t sound_out[], unsigned int sound_n );
+public:
+	const OverlapAddConvolver convolver;
+private:
+	std::vector<float> echoes; //!< the convolved mix bus, same layout
+};
+
+#endif /* SRC_CONVOLUTIONDEPTHRENDERER_H_ */
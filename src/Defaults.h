@@ -10,7 +10,7 @@
 #include <string>
 
 // Audio sample rate
-const int SAMPLE_RATE = 44100; //!< audio sample rate
+const int SAMPLE_RATE = 44100; //!< default audio sample rate (--renderer-sample-rate)
 typedef int16_t audio_t; //!< audio sample data type
 const audio_t audio_A = 32767; //!< amplitude for audio samples
 
@@ -0,0 +1,219 @@
+/*
+ * DistanceMapping.cpp
+ */
+
+#include "DistanceMapping.h"
+#include "Defaults.h"
+#include <cmath>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+DistanceMapping::DistanceMapping(
+	DistanceMappingType type,
+	float max_distance,
+	float step_distance,
+	float max_time,
+	float min_step_distance,
+	float mapping_length,
+	const std::vector<float> & knot_distances_in,
+	const std::vector<float> & knot_times_in,
+	unsigned int sample_rate
+	)
+	:type(type),
+	 max_distance(max_distance),
+	 step_distance(step_distance),
+	 max_time(max_time),
+	 mapping_length(mapping_length),
+	 sample_rate(sample_rate),
+	 knot_distances(MakeKnots(knot_distances_in, knot_times_in, max_distance, true)),
+	 knot_times(MakeKnots(knot_distances_in, knot_times_in, max_distance, false)),
+	 is_uniform(type == DistanceMappingLinear && min_step_distance <= step_distance),
+	 bin_edges(MakeBinEdges(min_step_distance)),
+	 inv_step_distance(1.f/step_distance),
+	 inv_slot_width(0.f),
+	 n_slots(0),
+	 n_bins(bin_edges.size()-1)
+{
+	if( is_uniform )
+	{
+		// Same sample ranges as with a constant step distance
+		for( unsigned int i=0; i<=n_bins; ++i )
+			sample_edges.push_back( (unsigned int)( i * sample_rate * ((double)max_time) / n_bins ) );
+	}
+	else
+	{
+		for( unsigned int i=0; i<=n_bins; ++i )
+			sample_edges.push_back( (unsigned int)( ((double)TimeOfDistance(bin_edges[i])) * sample_rate + 0.5 ) );
+
+		// Lookup slots are as wide as the narrowest bin, so each slot overlaps at most 2 bins
+		float min_width = max_distance;
+		for( unsigned int i=0; i<n_bins; ++i )
+			min_width = min( min_width, bin_edges[i+1]-bin_edges[i] );
+		inv_slot_width = 1.f / max( min_width, 1e-4f );
+		n_slots = (unsigned int)( max_distance * inv_slot_width ) + 1;
+		slot_bins.resize(n_slots);
+		unsigned int bin = 0;
+		for( unsigned int s=0; s<n_slots; ++s )
+		{
+			const float slot_start = s / inv_slot_width;
+			while( bin+1 < n_bins && bin_edges[bin+1] <= slot_start )
+				bin++;
+			slot_bins[s] = bin;
+		}
+	}
+
+	const float nominal_width = max_distance / (unsigned int)(max_distance/step_distance);
+	for( unsigned int i=0; i<n_bins; ++i )
+		loudness_scale.push_back( is_uniform ? 1.f : nominal_width / (bin_edges[i+1]-bin_edges[i]) );
+	for( unsigned int i=0; i<n_bins; ++i )
+		loudness_scale_q15.push_back( (uint32_t)( loudness_scale[i]*(1 << 15) + 0.5f ) );
+
+	if( is_uniform == false )
+	{
+		cout << "Distance mapping has " << n_bins << " bins, first bin is " << bin_edges[1] <<
+				" m wide, last bin is " << (bin_edges[n_bins]-bin_edges[n_bins-1]) << " m wide" << endl;
+	}
+}
+
+std::vector<float> DistanceMapping::MakeKnots(
+		const std::vector<float> & knot_distances_in, const std::vector<float> & knot_times_in,
+		float max_distance, bool return_distances )
+{
+	std::vector<float> distances(1,0.f), times(1,0.f);
+	for( unsigned int i=0; i<knot_distances_in.size() && i<knot_times_in.size(); ++i )
+	{
+		if( knot_distances_in[i] <= distances.back() || knot_distances_in[i] >= max_distance ||
+				knot_times_in[i] <= times.back() || knot_times_in[i] >= 1.f )
+		{
+			if( return_distances )
+				cerr << "Ignoring non-increasing distance mapping knot " << knot_distances_in[i] <<
+						":" << knot_times_in[i] << endl;
+			continue;
+		}
+		distances.push_back(knot_distances_in[i]);
+		times.push_back(knot_times_in[i]);
+	}
+	distances.push_back(max_distance);
+	times.push_back(1.f);
+	return return_distances ? distances : times;
+}
+
+std::vector<float> DistanceMapping::MakeBinEdges( float min_step_distance )const
+{
+	const unsigned int n_steps = max_distance/step_distance;
+	std::vector<float> edges(1,0.f);
+	if( is_uniform )
+	{
+		// Same bins as with a constant step distance
+		for( unsigned int i=1; i<=n_steps; ++i )
+			edges.push_back( i*step_distance );
+		return edges;
+	}
+	// Equal durations in the mapped time, bins narrower than min_step_distance are merged
+	for( unsigned int i=1; i<=n_steps; ++i )
+	{
+		const float distance = i == n_steps ? max_distance : DistanceOfTime( ((double)i) * max_time / n_steps );
+		if( distance - edges.back() < min_step_distance )
+		{
+			if( i < n_steps )
+				continue;
+			if( edges.size() > 1 ) // last bin is too narrow, merge it with the previous one
+				edges.pop_back();
+		}
+		edges.push_back( distance );
+	}
+	return edges;
+}
+
+float DistanceMapping::TimeOfDistance( float distance )const
+{
+	const double D = max_distance;
+	const double L = mapping_length;
+	double fraction;
+	switch( type )
+	{
+	case DistanceMappingExponential:
+		fraction = log( 1. + distance/L ) / log( 1. + D/L );
+		break;
+	case DistanceMappingLogarithmic:
+		fraction = ( exp( distance/L ) - 1. ) / ( exp( D/L ) - 1. );
+		break;
+	case DistanceMappingPiecewise:
+	{
+		unsigned int k = 1;
+		while( k+1 < knot_distances.size() && knot_distances[k] < distance )
+			k++;
+		const double k_d = ( distance - knot_distances[k-1] ) / ( knot_distances[k] - knot_distances[k-1] );
+		fraction = knot_times[k-1] + k_d * ( knot_times[k] - knot_times[k-1] );
+		break;
+	}
+	default:
+		fraction = distance / D;
+	}
+	return fraction * max_time;
+}
+
+float DistanceMapping::DistanceOfTime( float time )const
+{
+	const double D = max_distance;
+	const double L = mapping_length;
+	const double fraction = time / max_time;
+	switch( type )
+	{
+	case DistanceMappingExponential:
+		return L * ( exp( fraction * log( 1. + D/L ) ) - 1. );
+	case DistanceMappingLogarithmic:
+		return L * log( 1. + fraction * ( exp( D/L ) - 1. ) );
+	case DistanceMappingPiecewise:
+	{
+		unsigned int k = 1;
+		while( k+1 < knot_times.size() && knot_times[k] < fraction )
+			k++;
+		const double k_t = ( fraction - knot_times[k-1] ) / ( knot_times[k] - knot_times[k-1] );
+		return knot_distances[k-1] + k_t * ( knot_distances[k] - knot_distances[k-1] );
+	}
+	default:
+		return fraction * D;
+	}
+}
+
+bool DistanceMapping::ParseKnots( const std::string & knots,
+		std::vector<float> & knot_distances, std::vector<float> & knot_times )
+{
+	knot_distances.clear();
+	knot_times.clear();
+	std::stringstream ss(knots);
+	std::string knot;
+	while( std::getline( ss, knot, ',' ) )
+	{
+		float d, t;
+		char separator;
+		std::stringstream ss_knot(knot);
+		if( !( ss_knot >> d >> separator >> t ) || separator != ':' )
+		{
+			cerr << "Could not parse distance mapping knot \"" << knot << "\"" << endl;
+			return false;
+		}
+		knot_distances.push_back(d);
+		knot_times.push_back(t);
+	}
+	return true;
+}
+
+DistanceMappingType DistanceMapping::ParseType( const std::string & name, bool & ok )
+{
+	ok = true;
+	if( name == "linear" )
+		return DistanceMappingLinear;
+	if( name == "exponential" )
+		return DistanceMappingExponential;
+	if( name == "logarithmic" )
+		return DistanceMappingLogarithmic;
+	if( name == "piecewise" )
+		return DistanceMappingPiecewise;
+	ok = false;
+	return DistanceMappingLinear;
+}
@@ -0,0 +1,99 @@
+/*
+ * DistanceMapping.h
+ */
+
+#ifndef SRC_DISTANCEMAPPING_H_
+#define SRC_DISTANCEMAPPING_H_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "Defaults.h"
+
+enum DistanceMappingType {
+	DistanceMappingLinear = 0, //!< time is proportional to distance (constant speed of sound)
+	DistanceMappingExponential = 1, //!< speed of sound grows exponentially with time, near distances last longer
+	DistanceMappingLogarithmic = 2, //!< distance grows logarithmically with time, far distances last longer
+	DistanceMappingPiecewise = 3 //!< piecewise linear between (distance, time fraction) knots
+};
+
+/* This class maps distances to times in the rendered sound
+ * and divides the distances into bins with variable widths.
+ *
+ * The bins have equal durations in the mapped time,
+ * except that bins narrower than min_step_distance are merged,
+ * so the near field gets finer resolution without increasing the number of bins.
+ * Bin edges, sample ranges and a lookup table for binning are precomputed.
+ */
+class DistanceMapping
+{
+public:
+	DistanceMapping(
+		DistanceMappingType type,
+		float max_distance, //!< [m]
+		float step_distance, //!< nominal bin width, there are max_distance/step_distance time steps [m]
+		float max_time, //!< duration of the rendered echo [s]
+		float min_step_distance = 0.f, //!< narrower bins are merged [m]
+		float mapping_length = 1.f, //!< characteristic length of exponential and logarithmic mappings [m]
+		const std::vector<float> & knot_distances = std::vector<float>(), //!< piecewise mapping knots [m]
+		const std::vector<float> & knot_times = std::vector<float>(), //!< piecewise mapping knots [fraction of max_time]
+		unsigned int sample_rate = SAMPLE_RATE //!< of the sample ranges [Hz]
+			);
+	// Parses knots given as "<distance>:<time fraction>,<distance>:<time fraction>,..."
+	static bool ParseKnots( const std::string & knots,
+			std::vector<float> & knot_distances, std::vector<float> & knot_times );
+	static DistanceMappingType ParseType( const std::string & name, bool & ok );
+
+	float TimeOfDistance( float distance )const; //!< [s]
+	float DistanceOfTime( float time )const; //!< [m]
+
+	// Bin of the distance, n_bins if the distance is out of range
+	inline unsigned int BinOf( float distance )const
+	{
+		if( is_uniform )
+			return (unsigned int)(distance * inv_step_distance);
+		const unsigned int slot = (unsigned int)(distance * inv_slot_width);
+		if( slot >= n_slots )
+			return n_bins;
+		const unsigned int bin = slot_bins[slot];
+		return distance < bin_edges[bin+1] ? bin : bin+1;
+	}
+
+	const float * get_bin_edges()const //!< n_bins+1 distances [m]
+	{ return &bin_edges[0]; }
+	const unsigned int * get_sample_edges()const //!< bin i is rendered from sample [i] to sample [i+1]
+	{ return &sample_edges[0]; }
+	const float * get_loudness_scale()const //!< step_distance / bin width, normalizes counts to point density
+	{ return &loudness_scale[0]; }
+	const uint32_t * get_loudness_scale_q15()const //!< loudness scale in Q15, for the fixed point rendering
+	{ return &loudness_scale_q15[0]; }
+
+	const DistanceMappingType type;
+	const float max_distance;
+	const float step_distance;
+	const float max_time;
+	const float mapping_length;
+	const unsigned int sample_rate; //!< [Hz]
+private:
+	// Validated piecewise knots, starting with (0,0) and ending with (max_distance,1)
+	static std::vector<float> MakeKnots(
+			const std::vector<float> & knot_distances, const std::vector<float> & knot_times,
+			float max_distance, bool return_distances );
+	std::vector<float> MakeBinEdges( float min_step_distance )const;
+
+	std::vector<float> knot_distances;
+	std::vector<float> knot_times;
+	const bool is_uniform;
+	std::vector<float> bin_edges;
+	std::vector<unsigned int> sample_edges;
+	std::vector<float> loudness_scale;
+	std::vector<uint32_t> loudness_scale_q15;
+	std::vector<unsigned int> slot_bins; //!< first bin of each lookup slot
+	float inv_step_distance;
+	float inv_slot_width;
+	unsigned int n_slots;
+public:
+	const unsigned int n_bins;
+};
+
+#endif /* SRC_DISTANCEMAPPING_H_ */
@@ -0,0 +1,167 @@
+/*
+ * EchoImage.cpp
+ */
+
+#include "EchoImage.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+EchoImage::EchoImage(
+	const DistanceMapping & distance_mapping,
+	const CameraIntrinsics & intrinsics,
+	unsigned int num_bands
+	)
+	:distance_mapping(distance_mapping),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 num_bands( max( 1u, min( num_bands, (unsigned int)intrinsics.width ) ) ),
+	 n_bins(distance_mapping.n_bins),
+#if defined _OPENMP
+	 num_counters(omp_get_max_threads()),
+#else
+	 num_counters(1),
+#endif
+	 column_band(camera_w),
+	 band_columns(this->num_bands, 0),
+	 band_azimuth(this->num_bands)
+{
+	for( unsigned int u=0; u<camera_w; ++u )
+	{
+		column_band[u] = u * this->num_bands / camera_w;
+		band_columns[column_band[u]]++;
+	}
+	unsigned int first_column = 0;
+	for( unsigned int k=0; k<this->num_bands; ++k )
+	{
+		const float centre = first_column + 0.5*(band_columns[k]-1);
+		band_azimuth[k] = atan( (centre - intrinsics.ppx) / intrinsics.fx );
+		first_column += band_columns[k];
+	}
+
+	counters = NULL;
+}
+
+EchoImage::~EchoImage()
+{
+	if( counters != NULL )
+		delete [] counters[0];
+	delete [] counters;
+}
+
+void EchoImage::Compute(
+	const Vertex * vertices,
+	const uint16_t * point_weights,
+	const std::vector<PointSpan> & spans
+	)
+{
+	const unsigned int n_per_thread = num_bands*n_bins;
+	if( counters == NULL )
+	{
+		counters = new unsigned int * [num_counters];
+		counters[0] = new unsigned int [num_counters*n_per_thread];
+		for( int i=1; i<num_counters; ++i )
+			counters[i] = &counters[0][n_per_thread*i];
+	}
+	int num_used_counters = 1;
+#pragma omp parallel default(shared)
+	{
+
+#if defined _OPENMP
+		unsigned int * my_counter = counters[omp_get_thread_num()];
+#pragma omp single
+		{
+			num_used_counters = omp_get_num_threads();
+		}
+#else
+		unsigned int * my_counter = counters[0];
+#endif
+
+		// DO NOT OMP PARALLELIZE
+		for( int i=0; i<n_per_thread; ++i )
+			my_counter[i] = 0;
+
+#pragma omp for
+		for( int s=0; s<(int)spans.size(); ++s )
+		{
+			// column u of the span is at point row_begin+u
+			const unsigned int row_begin = spans[s].begin - spans[s].begin % camera_w;
+			for( unsigned int i=spans[s].begin; i<spans[s].end; ++i )
+			{
+				Vertex const & p = vertices[i];
+				if( p.z < 0.0001 )
+					continue;
+				const unsigned int i_bin = distance_mapping.BinOf( sqrt( p.x*p.x + p.y*p.y + p.z*p.z ) );
+				if( i_bin < n_bins )
+					my_counter[column_band[i-row_begin]*n_bins + i_bin] += point_weights != NULL ? point_weights[i] : 1;
+			}
+		}
+	} // end openMP parallel region
+
+	// move all counts to counter 0
+	for( int i=1; i<num_used_counters; ++i )
+	{
+#pragma omp parallel for default(shared)
+		for( int j=0; j<n_per_thread; ++j )
+		{
+			counters[0][j] += counters[i][j];
+			counters[i][j] = 0;
+		}
+	}
+}
+
+void EchoImage::SetDestination( EchoBinMap & map, unsigned int band, unsigned int bin, float distance )const
+{
+	if( map.bins.size() != num_bands*n_bins )
+	{
+		map.bins.assign( num_bands*n_bins, n_bins );
+		map.upper_weights.assign( num_bands*n_bins, 0 );
+	}
+	const unsigned int j = band*n_bins + bin;
+	const unsigned int i_bin = distance >= 0. ? distance_mapping.BinOf( distance ) : n_bins;
+	map.bins[j] = n_bins;
+	map.upper_weights[j] = 0;
+	if( i_bin >= n_bins )
+		return;
+	const float * bin_edges = distance_mapping.get_bin_edges();
+	const float centre = 0.5 * (bin_edges[i_bin] + bin_edges[i_bin+1]);
+	unsigned int lower = i_bin;
+	float lower_centre = centre;
+	float upper_centre = centre;
+	if( distance >= centre )
+	{
+		// past the last bin, the next centre is as far as the last one
+		upper_centre = i_bin+1 < n_bins ? 0.5 * (bin_edges[i_bin+1] + bin_edges[i_bin+2]) :
+				centre + (bin_edges[i_bin+1] - bin_edges[i_bin]);
+	}
+	else if( i_bin > 0 )
+	{
+		lower = i_bin-1;
+		lower_centre = 0.5 * (bin_edges[i_bin-1] + bin_edges[i_bin]);
+	}
+	map.bins[j] = lower;
+	if( upper_centre > lower_centre )
+		map.upper_weights[j] = (uint16_t)min( 65535.f, 65536.f * (distance - lower_centre) / (upper_centre - lower_centre) + 0.5f );
+}
+
+void EchoImage::Fold( const EchoBinMap & map, unsigned int counts_out[] )const
+{
+	for( unsigned int i=0; i<n_bins; ++i )
+		counts_out[i] = 0;
+	const unsigned int * counts = counters[0];
+	for( unsigned int j=0; j<num_bands*n_bins; ++j )
+	{
+		const unsigned int lower = map.bins[j];
+		if( counts[j] == 0 || lower >= n_bins )
+			continue;
+		const unsigned int upper_counts = ( (uint64_t)counts[j] * map.upper_weights[j] + 32768 ) >> 16;
+		counts_out[lower] += counts[j] - upper_counts;
+		if( lower+1 < n_bins )
+			counts_out[lower+1] += upper_counts;
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * EchoImage.h
+ */
+
+#ifndef SRC_ECHOIMAGE_H_
+#define SRC_ECHOIMAGE_H_
+
+#include "DistanceMapping.h"
+#include "PointCloud.h"
+#include "WeightMap.h"
+#include <stdint.h>
+#include <vector>
+
+// Destinations of the bins of each band of an echo image in a histogram of the same distance bins:
+// the counts of a bin are split between two neighbouring bins, so that a distance that falls
+// between the centres of two bins moves the counts by a fraction of a bin
+struct EchoBinMap
+{
+	std::vector<unsigned int> bins; //!< [band][bin] lower destination bin, n_bins if the counts are dropped
+	std::vector<uint16_t> upper_weights; //!< [band][bin] part of the counts that goes to the next bin [1/65536]
+};
+
+/* This class bins a pointcloud into a 2D histogram of distance (from the camera)
+ * by azimuth, the image columns being split into bands of equal width.
+ * The counts are stored band after band, so that the histogram of a band is contiguous.
+ * The renderers derive their output from the image instead of binning the points again:
+ * the histogram of an ear or of a delayed channel is the sum of the band histograms,
+ * each bin being moved to the distance given by a map of the bands (see Fold),
+ * so a new output costs a pass over the bins rather than a pass over the points.
+ */
+class EchoImage
+{
+public:
+	EchoImage(
+		const DistanceMapping & distance_mapping, //!< not owned, must outlive the image
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		unsigned int num_bands //!< number of column bands, at most the image width
+			);
+	~EchoImage();
+	// True if the pointcloud has the layout of the image
+	bool Fits( const unsigned int n_vertices )const
+	{ return n_vertices == camera_w*camera_h; }
+	// Bins the points of the spans, which must not cross rows, in one pass
+	void Compute(
+			const Vertex * vertices,
+			const uint16_t * point_weights, //!< counts of each point, NULL to count each point once
+			const std::vector<PointSpan> & spans
+			);
+	// Sets the destination of bin i of band k of the map to a distance [m],
+	// the counts are interpolated between the centres of the bins, negative distances are dropped
+	void SetDestination( EchoBinMap & map, unsigned int band, unsigned int bin, float distance )const;
+	// Sets counts_out (n_bins long) to the sum of the bands, each bin being moved as the map sets
+	void Fold( const EchoBinMap & map, unsigned int counts_out[] )const;
+
+	const unsigned int * get_band_counts( unsigned int band )const //!< n_bins long, valid after Compute
+	{ return &counters[0][band*n_bins]; }
+	unsigned int get_band_columns( unsigned int band )const
+	{ return band_columns[band]; }
+	float get_band_azimuth( unsigned int band )const //!< angle of the band centre to the optical axis, positive right [rad]
+	{ return band_azimuth[band]; }
+
+	const DistanceMapping & distance_mapping;
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const unsigned int num_bands;
+	const unsigned int n_bins;
+	const int num_counters;
+private:
+	std::vector<unsigned int> column_band; //!< band of each image column
+	std::vector<unsigned int> band_columns; //!< number of columns of each band
+	std::vector<float> band_azimuth;
+	unsigned int **counters; //!< [band][bin] counts for each omp thread, allocated by the first Compute
+};
+
+#endif /* SRC_ECHOIMAGE_H_ */
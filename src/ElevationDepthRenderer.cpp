@@ -0,0 +1,199 @@
+/*
+ * ElevationDepthRenderer.cpp
+ */
+
+#include "ElevationDepthRenderer.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+ElevationDepthRenderer::ElevationDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float base_frequency_doubling_length,
+	float background_amplitude,
+	float stereo_distance,
+	bool save_loudness,
+	const CameraIntrinsics & intrinsics,
+	unsigned int num_bands,
+	float band_frequency_ratio,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, base_frequency_doubling_length, background_amplitude,
+		stereo_distance,
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 num_bands( max( num_bands, 1u ) ),
+	 band_frequency_ratio(band_frequency_ratio)
+{
+	// Rows see the scene at a constant elevation (y/z is constant along a row),
+	// camera y points down, so the top row has the highest elevation
+	const float elevation_top = atan( intrinsics.ppy / intrinsics.fy );
+	const float elevation_bottom = atan( (intrinsics.ppy - (camera_h-1)) / intrinsics.fy );
+	const float band_angle = (elevation_top - elevation_bottom) / this->num_bands;
+	row_band = new unsigned int [camera_h];
+	for( unsigned int v=0; v<camera_h; ++v )
+	{
+		const float elevation = atan( (intrinsics.ppy - v) / intrinsics.fy );
+		row_band[v] = min( (unsigned int)( (elevation - elevation_bottom) / band_angle ), this->num_bands-1 );
+	}
+
+	band_frequency = new float [this->num_bands];
+	for( unsigned int k=0; k<this->num_bands; ++k )
+	{
+		band_frequency[k] = base_frequency * pow( band_frequency_ratio, k );
+		cout << "Elevation band " << k << " : " <<
+				(elevation_bottom + k*band_angle)*180./M_PI << " - " <<
+				(elevation_bottom + (k+1)*band_angle)*180./M_PI << " deg, " <<
+				band_frequency[k] << " Hz" << endl;
+	}
+
+	const unsigned int n_per_thread = 2*this->num_bands*max_counter;
+	band_counters = new unsigned int * [num_counters];
+	band_counters[0] = new unsigned int [num_counters*n_per_thread];
+	for( int i=1; i<num_counters; ++i )
+		band_counters[i] = &band_counters[0][n_per_thread*i];
+	band_amplitudes = new float [2*loudness_n_per_channel];
+}
+
+ElevationDepthRenderer::~ElevationDepthRenderer()
+{
+	delete [] row_band;
+	delete [] band_frequency;
+	delete [] band_counters[0];
+	delete [] band_counters;
+	delete [] band_amplitudes;
+}
+
+void ElevationDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	if( n_vertices != camera_w*camera_h )
+	{
+		cerr << "Elevation renderer expects " << camera_w*camera_h << " vertices, got " << n_vertices;
+		cerr << ", rendering without elevation bands" << endl;
+		SimpleDepthRenderer::RenderPointcloudToSound( vertices, n_vertices, sound_out, sound_n );
+		return;
+	}
+	UpdatePointWeights( vertices, n_vertices );
+
+	const unsigned int n_per_ear = num_bands*max_counter;
+	const unsigned int n_per_thread = 2*n_per_ear;
+	const float ear_x = stereo_distance/2;
+	int num_used_counters = 1;
+#pragma omp parallel default(shared)
+	{
+
+#if defined _OPENMP
+		unsigned int * my_counter = band_counters[omp_get_thread_num()];
+#pragma omp single
+		{
+			num_used_counters = omp_get_num_threads();
+		}
+#else
+		unsigned int * my_counter = band_counters[0];
+#endif
+
+		// DO NOT OMP PARALLELIZE
+		for( int i=0; i<n_per_thread; ++i )
+			my_counter[i] = 0;
+
+		// One pass over the rows: both ears and all bands are binned at once
+#pragma omp for
+		for( int v=0; v<(int)camera_h; ++v )
+		{
+			unsigned int * band_left = &my_counter[row_band[v]*max_counter];
+			unsigned int * band_right = band_left + n_per_ear;
+			const Vertex * row = &vertices[v*camera_w];
+			const uint16_t * row_weights = point_weights != NULL ? &point_weights[v*camera_w] : NULL;
+			for( unsigned int u=0; u<camera_w; ++u )
+			{
+				Vertex const & p = row[u];
+				if( p.z < 0.0001 )
+					continue;
+				const float yz2 = p.y*p.y + p.z*p.z;
+				const float dx_left = p.x + ear_x;
+				const float dx_right = p.x - ear_x;
+				const unsigned int counts = row_weights != NULL ? row_weights[u] : 1;
+				const unsigned int i_bin_left = distance_mapping->BinOf( sqrt( dx_left*dx_left + yz2 ) );
+				if( i_bin_left < max_counter )
+					band_left[i_bin_left] += counts;
+				const unsigned int i_bin_right = distance_mapping->BinOf( sqrt( dx_right*dx_right + yz2 ) );
+				if( i_bin_right < max_counter )
+					band_right[i_bin_right] += counts;
+			}
+		}
+	} // end openMP parallel region
+
+	// move all counts to counter 0
+	for( int i=1; i<num_used_counters; ++i )
+	{
+#pragma omp parallel for default(shared)
+		for( int j=0; j<n_per_thread; ++j )
+		{
+			band_counters[0][j] += band_counters[i][j];
+			band_counters[i][j] = 0;
+		}
+	}
+
+	// Each band is normalized as if it was an image of its own
+	const unsigned int amp_div = max( 1u, (unsigned int)(
+			(n_vertices / num_bands / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint() ) );
+	const audio_t band_max_amplitude = audio_A / num_bands;
+	if( save_loudness )
+	{
+		for( int i=0; i<2*loudness_n_per_channel; ++i )
+			amplitudes_data[i] = 0.;
+	}
+	for( int channel=0; channel<2; ++channel )
+	{
+		for( unsigned int k=0; k<num_bands; ++k )
+		{
+			RenderCountsToSound(
+					&band_counters[0][channel*n_per_ear + k*max_counter], amp_div,
+					sound_out, sound_n, channel, band_frequency[k],
+					band_max_amplitude,
+					k == 0, // the first band sets the sound, the others are mixed in
+					freq_doubling_length,
+					k == 0 ? background_amplitude : 0.,
+					save_loudness ? band_amplitudes : NULL
+					);
+			if( save_loudness )
+			{
+				// band amplitudes are fractions of the band max amplitude
+				for( int i=0; i<loudness_n_per_channel; ++i )
+					amplitudes_data[2*i+channel] += band_amplitudes[2*i+channel] / num_bands;
+			}
+		}
+	}
+	MixBusToSound( sound_out, sound_n );
+
+	if( save_loudness )
+	{
+		// loudness of all bands together
+#pragma omp parallel for
+		for( int i=0; i<loudness_n_per_channel; ++i )
+		{
+			for( int channel=0; channel<2; ++channel )
+			{
+				unsigned int counts = 0;
+				for( unsigned int k=0; k<num_bands; ++k )
+					counts += band_counters[0][channel*n_per_ear + k*max_counter + i];
+				loudness_data[2*i+channel] = ((float)counts) / amp_div;
+			}
+		}
+	}
+}
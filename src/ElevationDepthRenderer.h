@@ -0,0 +1,55 @@
+/*
+ * ElevationDepthRenderer.h
+ */
+
+#ifndef SRC_ELEVATIONDEPTHRENDERER_H_
+#define SRC_ELEVATIONDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+
+/* This class renders different heights of the image at different frequencies.
+ * The vertical field of view is split into elevation bands of equal angle,
+ * and each point is binned into a 2D histogram of distance by elevation band
+ * for both ears in a single pass over the pointcloud.
+ * Each band is then rendered with its own carrier frequency
+ * (the lowest band at the base frequency, each higher band at a multiple of it)
+ * and the bands are mixed.
+ * Each band is limited to audio_A/num_bands, so that the mix never overflows.
+ */
+class ElevationDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	ElevationDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float freq_doubling_length,
+		float background_amplitude,
+		float stereo_distance,
+		bool save_loudness,
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		unsigned int num_bands, //!< number of elevation bands
+		float band_frequency_ratio, //!< frequency ratio between neighbouring bands
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual ~ElevationDepthRenderer();
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+	float get_band_frequency( unsigned int band )const
+	{ return band_frequency[band]; }
+public:
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const unsigned int num_bands;
+	const float band_frequency_ratio;
+private:
+	unsigned int * row_band; //!< elevation band of each image row
+	float * band_frequency; //!< carrier frequency of each band
+	unsigned int **band_counters; //!< [ear][band][bin] counts for each omp thread
+	float * band_amplitudes; //!< amplitudes of one band, interleaved as amplitudes_data
+};
+
+#endif /* SRC_ELEVATIONDEPTHRENDERER_H_ */
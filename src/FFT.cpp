@@ -0,0 +1,79 @@
+/*
+ * FFT.cpp
+ */
+
+#include "FFT.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+FFT::FFT( unsigned int n )
+	:n( SizeFor(n) ),
+	 twiddles( this->n/2 ),
+	 bit_reversed( this->n )
+{
+	for( unsigned int k=0; k<twiddles.size(); ++k )
+	{
+		const double angle = -2.*M_PI*k / this->n;
+		twiddles[k] = complex_t( cos(angle), sin(angle) );
+	}
+	unsigned int bits = 0;
+	while( (1u << bits) < this->n )
+		++bits;
+	for( unsigned int i=0; i<this->n; ++i )
+	{
+		unsigned int r = 0;
+		for( unsigned int b=0; b<bits; ++b )
+			r |= ( (i >> b) & 1 ) << (bits-1-b);
+		bit_reversed[i] = r;
+	}
+}
+
+unsigned int FFT::SizeFor( unsigned int n )
+{
+	unsigned int size = 1;
+	while( size < n )
+		size <<= 1;
+	return size;
+}
+
+void FFT::Forward( complex_t values[] )const
+{
+	Transform( values, false );
+}
+
+void FFT::Inverse( complex_t values[] )const
+{
+	Transform( values, true );
+	const float scale = 1.f / n;
+	for( unsigned int i=0; i<n; ++i )
+		values[i] *= scale;
+}
+
+void FFT::Transform( complex_t values[], bool inverse )const
+{
+	for( unsigned int i=0; i<n; ++i )
+		if( i < bit_reversed[i] )
+			swap( values[i], values[bit_reversed[i]] );
+
+	// iterative Cooley-Tukey butterflies, the inverse uses the conjugate twiddles
+	for( unsigned int half=1; half<n; half <<= 1 )
+	{
+		const unsigned int twiddle_step = n / (2*half);
+		for( unsigned int start=0; start<n; start += 2*half )
+		{
+			for( unsigned int k=0; k<half; ++k )
+			{
+				const complex_t w = twiddles[k*twiddle_step];
+				const float w_imag = inverse ? -w.imag() : w.imag();
+				const complex_t a = values[start+k];
+				const complex_t c = values[start+k+half];
+				// written out, the std::complex product checks for infinities
+				const complex_t b( c.real()*w.real() - c.imag()*w_imag, c.real()*w_imag + c.imag()*w.real() );
+				values[start+k] = a + b;
+				values[start+k+half] = a - b;
+			}
+		}
+	}
+}
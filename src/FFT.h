@@ -0,0 +1,35 @@
+/*
+ * FFT.h
+ */
+
+#ifndef SRC_FFT_H_
+#define SRC_FFT_H_
+
+#include <complex>
+#include <vector>
+
+typedef std::complex<float> complex_t;
+
+/* This class computes in-place radix-2 fast Fourier transforms of one size.
+ * The twiddle factors and the bit reversal permutation are precomputed,
+ * the transforms do not modify the object, so one FFT can be shared by omp threads.
+ */
+class FFT
+{
+public:
+	FFT( unsigned int n ); //!< n is rounded up to a power of two
+	// Smallest power of two that is not less than n
+	static unsigned int SizeFor( unsigned int n );
+
+	void Forward( complex_t values[] )const; //!< n values
+	void Inverse( complex_t values[] )const; //!< n values, scaled by 1/n so that Inverse(Forward(x)) = x
+
+	const unsigned int n;
+private:
+	void Transform( complex_t values[], bool inverse )const;
+
+	std::vector<complex_t> twiddles; //!< exp(-2 pi i k/n), k < n/2
+	std::vector<unsigned int> bit_reversed; //!< index of each value after the permutation
+};
+
+#endif /* SRC_FFT_H_ */
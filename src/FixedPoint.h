@@ -0,0 +1,50 @@
+/*
+ * FixedPoint.h
+ */
+
+#ifndef SRC_FIXEDPOINT_H_
+#define SRC_FIXEDPOINT_H_
+
+#include "Defaults.h"
+#include <stdint.h>
+
+/* Q15 arithmetic for the fixed point rendering (make FIXEDPOINT=1),
+ * for boards with slow floating point.
+ * A Q15 value x stands for x/32768, so 1.0 is q15_one.
+ * Phases are unsigned 32 bit fractions of a period, wrapping around at 2^32.
+ */
+const int32_t q15_one = 1 << 15;
+const unsigned int q15_sin_bits = 10; //!< the sine table has 2^q15_sin_bits entries per period
+const unsigned int q15_loudness_bits = 8; //!< the loudness table has 2^q15_loudness_bits segments in [0,1]
+// The fixed point samples differ from the floating point ones by at most this much [LSB],
+// for pings whose frequency doubles slower than every 2 s.
+// Faster chirps drift further, mostly through the float phase of the floating point rendering.
+const int q15_max_error = 8;
+
+inline int32_t ToQ15( float x )
+{
+	return (int32_t)( x * q15_one + (x >= 0.f ? 0.5f : -0.5f) );
+}
+
+inline audio_t SaturateAudio( int32_t x )
+{
+	return x > INT16_MAX ? INT16_MAX : ( x < INT16_MIN ? INT16_MIN : (audio_t)x );
+}
+
+// Sine of the phase in Q15, interpolated linearly in a table of 2^q15_sin_bits+1 values
+inline int32_t SinQ15( const int16_t * sin_table, uint32_t phase )
+{
+	const uint32_t i = phase >> (32 - q15_sin_bits);
+	const int32_t frac = (phase >> (17 - q15_sin_bits)) & (q15_one - 1);
+	return sin_table[i] + ( ( (sin_table[i+1] - sin_table[i]) * frac ) >> 15 );
+}
+
+// Value of the loudness table at a Q15 loudness in [0,1], interpolated linearly
+inline int32_t LookupQ15( const int16_t * table, int32_t x_q15 )
+{
+	const int32_t i = x_q15 >> (15 - q15_loudness_bits);
+	const int32_t frac = x_q15 & ( (1 << (15 - q15_loudness_bits)) - 1 );
+	return table[i] + ( ( (table[i+1] - table[i]) * frac ) >> (15 - q15_loudness_bits) );
+}
+
+#endif /* SRC_FIXEDPOINT_H_ */
@@ -0,0 +1,168 @@
+/*
+ * FloorDepthRenderer.cpp
+ */
+
+#include "FloorDepthRenderer.h"
+#include <cmath>
+#include <iostream>
+#if defined _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+FloorDepthRenderer::FloorDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float base_frequency_doubling_length,
+	float background_amplitude,
+	float stereo_distance,
+	bool save_loudness,
+	float floor_frequency,
+	float floor_frequency_doubling_length,
+	float floor_amplitude,
+	float floor_inlier_distance,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, base_frequency_doubling_length, background_amplitude,
+		stereo_distance,
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 floor_frequency(floor_frequency),
+	 floor_freq_doubling_length(floor_frequency_doubling_length),
+	 floor_amplitude(floor_amplitude),
+	 floor_tracker(max_distance, floor_inlier_distance)
+{
+	floor_counters = new unsigned int * [num_counters];
+	floor_counters[0] = new unsigned int [num_counters*max_counter];
+	for( int i=1; i<num_counters; ++i )
+		floor_counters[i] = &floor_counters[0][max_counter*i];
+}
+
+FloorDepthRenderer::~FloorDepthRenderer()
+{
+	delete [] floor_counters[0];
+	delete [] floor_counters;
+}
+
+void FloorDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	UpdatePointWeights( vertices, n_vertices );
+	floor_tracker.Update( vertices, n_vertices );
+	this->RenderDistanceToSoundWithFloor(
+		-stereo_distance/2, 0, 0,
+		vertices, n_vertices, 0,
+		sound_out, sound_n );
+	this->RenderDistanceToSoundWithFloor(
+		+stereo_distance/2, 0, 0,
+		vertices, n_vertices, 1,
+		sound_out, sound_n );
+	MixBusToSound( sound_out, sound_n );
+}
+
+void FloorDepthRenderer::RenderDistanceToSoundWithFloor(
+	float x, float y, float z,
+	const Vertex * vertices, const unsigned int n_vertices,
+	int channel,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	// without a floor plane, all points are obstacles
+	const float floor_distance = floor_tracker.is_valid() ? floor_tracker.inlier_distance : -1.;
+	const std::vector<PointSpan> & spans = GetPointSpans( n_vertices );
+	int num_used_counters = 1;
+#pragma omp parallel default(shared)
+	{
+
+#if defined _OPENMP
+		unsigned int * my_counter = counters[omp_get_thread_num()];
+		unsigned int * my_floor_counter = floor_counters[omp_get_thread_num()];
+#pragma omp single
+		{
+			num_used_counters = omp_get_num_threads();
+		}
+#else
+		unsigned int * my_counter = counters[0];
+		unsigned int * my_floor_counter = floor_counters[0];
+#endif
+
+		// DO NOT OMP PARALLELIZE
+		for( int i=0; i<max_counter; ++i )
+		{
+			my_counter[i] = 0;
+			my_floor_counter[i] = 0;
+		}
+
+		float dx, dy, dz, dd;
+#pragma omp for
+		for( int s=0; s < (int)spans.size(); ++s )
+		{
+			for( unsigned int i=spans[s].begin; i < spans[s].end; ++i )
+			{
+				Vertex const & v = vertices[i];
+				if( v.z < 0.0001 )
+					continue;
+				dx = v.x - x;
+				dy = v.y - y;
+				dz = v.z - z;
+				dd = sqrt(dx*dx+dy*dy+dz*dz);
+				const unsigned int i_bin = distance_mapping->BinOf(dd);
+				if(i_bin>=max_counter)
+					continue;
+				const unsigned int counts = point_weights != NULL ? point_weights[i] : 1;
+				if( fabs( floor_tracker.DistanceAbove(v) ) < floor_distance )
+					my_floor_counter[i_bin] += counts;
+				else
+					my_counter[i_bin] += counts;
+			}
+		}
+	} // end openMP parallel region
+
+	// move all counts to counter 0
+	for( int i=1; i<num_used_counters; ++i )
+	{
+#pragma omp parallel for default(shared)
+		for( int j=0; j<max_counter; ++j )
+		{
+			counters[0][j] += counters[i][j];
+			counters[i][j] = 0;
+			floor_counters[0][j] += floor_counters[i][j];
+			floor_counters[i][j] = 0;
+		}
+	}
+
+	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
+	const audio_t floor_max_amplitude = audio_A * floor_amplitude;
+	RenderCountsToSound(
+			counters[0], amp_div,
+			sound_out, sound_n, channel, base_frequency,
+			audio_A - floor_max_amplitude, // max amplitude
+			true,
+			freq_doubling_length,
+			background_amplitude,
+			save_loudness ? amplitudes_data : NULL
+			);
+	RenderCountsToSound(
+			floor_counters[0], amp_div,
+			sound_out, sound_n, channel, floor_frequency,
+			floor_max_amplitude, // max amplitude
+			false,
+			floor_freq_doubling_length,
+			0.,
+			NULL
+			);
+
+	if( save_loudness )
+	{
+#pragma omp parallel for
+		for( int i=0; i<loudness_n_per_channel; ++i )
+			loudness_data[2*i+channel] = ((float)counters[0][i]/amp_div) ;
+	}
+}
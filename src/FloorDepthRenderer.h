@@ -0,0 +1,56 @@
+/*
+ * FloorDepthRenderer.h
+ */
+
+#ifndef SRC_FLOORDEPTHRENDERER_H_
+#define SRC_FLOORDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+#include "FloorPlane.h"
+
+/* This class renders the floor in a separate rendering pass,
+ * so that the floor does not dominate every ping.
+ * Points closer than the inlier distance to the tracked floor plane are
+ * binned into the floor histogram, all other points into the obstacle histogram.
+ * Each histogram is rendered with its own frequency and amplitude.
+ */
+class FloorDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	FloorDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float freq_doubling_length,
+		float background_amplitude,
+		float stereo_distance,
+		bool save_loudness,
+		float floor_frequency, //!< base frequency of the floor echoes [Hz]
+		float floor_frequency_doubling_length, //!< [m], negative for constant frequency
+		float floor_amplitude, //!< max amplitude of the floor echoes (fraction of max amplitude)
+		float floor_inlier_distance, //!< max distance of floor points from the floor plane [m]
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual ~FloorDepthRenderer();
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+private:
+	void RenderDistanceToSoundWithFloor(
+			float x, float y, float z,
+			const Vertex * vertices, const unsigned int n_vertices,
+			int channel,
+			audio_t sound_out[],
+			unsigned int sound_n );
+public:
+	const float floor_frequency;
+	const float floor_freq_doubling_length;
+	const float floor_amplitude;
+	FloorPlaneTracker floor_tracker;
+private:
+	unsigned int **floor_counters; //!< an array of floor counts for each omp thread
+};
+
+#endif /* SRC_FLOORDEPTHRENDERER_H_ */
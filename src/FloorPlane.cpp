@@ -0,0 +1,181 @@
+/*
+ * FloorPlane.cpp
+ */
+
+#include "FloorPlane.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+FloorPlaneTracker::FloorPlaneTracker(
+	float max_distance,
+	float inlier_distance,
+	unsigned int subsample_step,
+	unsigned int ransac_iterations
+	)
+	:max_distance(max_distance),
+	 inlier_distance(inlier_distance),
+	 subsample_step(subsample_step),
+	 ransac_iterations(ransac_iterations),
+	 d(0.),
+	 valid(false),
+	 n_samples(0),
+	 samples_capacity(0),
+	 samples(NULL),
+	 random_state(2463534242u)
+{
+	normal[0] = 0.;
+	normal[1] = -1.;
+	normal[2] = 0.;
+}
+
+FloorPlaneTracker::~FloorPlaneTracker()
+{
+	delete [] samples;
+}
+
+uint32_t FloorPlaneTracker::Random()
+{
+	// xorshift32, deterministic so that replays give the same planes
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+void FloorPlaneTracker::CollectSamples( const Vertex * vertices, const unsigned int n_vertices )
+{
+	const unsigned int capacity = n_vertices / subsample_step + 1;
+	if( capacity > samples_capacity )
+	{
+		delete [] samples;
+		samples = new float [3*capacity];
+		samples_capacity = capacity;
+	}
+	const float max_distance_2 = max_distance*max_distance;
+	n_samples = 0;
+	for( unsigned int i=0; i<n_vertices; i+=subsample_step )
+	{
+		const Vertex & v = vertices[i];
+		if( v.z < 0.0001 || v.x*v.x+v.y*v.y+v.z*v.z > max_distance_2 )
+			continue;
+		samples[3*n_samples+0] = v.x;
+		samples[3*n_samples+1] = v.y;
+		samples[3*n_samples+2] = v.z;
+		n_samples++;
+	}
+}
+
+unsigned int FloorPlaneTracker::CountInliers( const float n[3], float d, float max_plane_distance )const
+{
+	unsigned int count = 0;
+#pragma omp parallel for reduction(+:count)
+	for( int i=0; i<(int)n_samples; ++i )
+	{
+		const float * p = &samples[3*i];
+		count += fabs( n[0]*p[0] + n[1]*p[1] + n[2]*p[2] + d ) < max_plane_distance;
+	}
+	return count;
+}
+
+bool FloorPlaneTracker::IsAcceptable( const float n[3], float d )const
+{
+	return ( -n[1] > min_normal_up ) && ( d > min_camera_height ) && ( d < max_camera_height );
+}
+
+bool FloorPlaneTracker::RefinePlane( float n[3], float & d, float max_plane_distance )const
+{
+	// The floor is never vertical in camera coordinates (see min_normal_up), so it can be
+	// fitted as y = a*x + b*z + c by solving 3x3 normal equations
+	double sxx=0, sxz=0, szz=0, sx=0, sz=0, s1=0, sxy=0, szy=0, sy=0;
+	for( unsigned int i=0; i<n_samples; ++i )
+	{
+		const float * p = &samples[3*i];
+		if( fabs( n[0]*p[0] + n[1]*p[1] + n[2]*p[2] + d ) >= max_plane_distance )
+			continue;
+		sxx += p[0]*p[0]; sxz += p[0]*p[2]; szz += p[2]*p[2];
+		sx += p[0]; sz += p[2]; s1 += 1.;
+		sxy += p[0]*p[1]; szy += p[2]*p[1]; sy += p[1];
+	}
+	if( s1 < 3. )
+		return false;
+	// Cramer's rule for [sxx sxz sx; sxz szz sz; sx sz s1] * [a b c]' = [sxy szy sy]'
+	const double det = sxx*(szz*s1-sz*sz) - sxz*(sxz*s1-sz*sx) + sx*(sxz*sz-szz*sx);
+	if( fabs(det) < 1e-12 )
+		return false;
+	const double a = ( sxy*(szz*s1-sz*sz) - sxz*(szy*s1-sz*sy) + sx*(szy*sz-szz*sy) ) / det;
+	const double b = ( sxx*(szy*s1-sy*sz) - sxy*(sxz*s1-sz*sx) + sx*(sxz*sy-szy*sx) ) / det;
+	const double c = ( sxx*(szz*sy-sz*szy) - sxz*(sxz*sy-szy*sx) + sxy*(sxz*sz-szz*sx) ) / det;
+	// a*x - y + b*z + c = 0, normal (a,-1,b) points up
+	const double norm = sqrt( a*a + 1. + b*b );
+	n[0] = a/norm;
+	n[1] = -1./norm;
+	n[2] = b/norm;
+	d = c/norm;
+	return IsAcceptable( n, d );
+}
+
+bool FloorPlaneTracker::FitRansac( float n_best[3], float & d_best )
+{
+	if( n_samples < 3 )
+		return false;
+	unsigned int count_best = 0;
+	for( unsigned int it=0; it<ransac_iterations; ++it )
+	{
+		const float * p0 = &samples[3*(Random()%n_samples)];
+		const float * p1 = &samples[3*(Random()%n_samples)];
+		const float * p2 = &samples[3*(Random()%n_samples)];
+		const float u[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+		const float v[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+		float n[3] = { u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0] };
+		const float norm = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+		if( norm < 1e-6 )
+			continue;
+		// orient the normal up, camera's y axis points down
+		const float k = n[1] < 0. ? 1./norm : -1./norm;
+		n[0] *= k; n[1] *= k; n[2] *= k;
+		const float d = -( n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2] );
+		if( IsAcceptable( n, d ) == false )
+			continue;
+		const unsigned int count = CountInliers( n, d, inlier_distance );
+		if( count > count_best )
+		{
+			count_best = count;
+			n_best[0] = n[0]; n_best[1] = n[1]; n_best[2] = n[2];
+			d_best = d;
+		}
+	}
+	return count_best >= min_inlier_fraction * n_samples;
+}
+
+bool FloorPlaneTracker::Update( const Vertex * vertices, const unsigned int n_vertices )
+{
+	CollectSamples( vertices, n_vertices );
+
+	// Tracking: refine the previous plane, the search band is wider to follow the camera motion
+	if( valid )
+	{
+		float n[3] = { normal[0], normal[1], normal[2] };
+		float d_new = d;
+		if( RefinePlane( n, d_new, 2*inlier_distance ) &&
+			CountInliers( n, d_new, inlier_distance ) >= min_inlier_fraction * n_samples )
+		{
+			normal[0] = n[0]; normal[1] = n[1]; normal[2] = n[2];
+			d = d_new;
+			return true;
+		}
+		cout << "Floor plane lost, searching for a new one" << endl;
+	}
+
+	float n[3];
+	float d_new;
+	valid = FitRansac( n, d_new ) && RefinePlane( n, d_new, inlier_distance );
+	if( valid )
+	{
+		normal[0] = n[0]; normal[1] = n[1]; normal[2] = n[2];
+		d = d_new;
+		cout << "Floor plane found, camera height is " << d << " m" << endl;
+	}
+	return valid;
+}
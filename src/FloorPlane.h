@@ -0,0 +1,68 @@
+/*
+ * FloorPlane.h
+ */
+
+#ifndef SRC_FLOORPLANE_H_
+#define SRC_FLOORPLANE_H_
+
+#include <stdint.h>
+#include "PointCloud.h"
+
+/* This class detects the floor plane in a pointcloud and tracks it between frames.
+ * The plane is fitted with RANSAC on a subsampled point set. On the following frames
+ * the previous plane is only refined with a least squares fit on its inliers,
+ * and RANSAC is run again only when the refined plane loses its support.
+ *
+ * Plane is n*p + d = 0, n points up (towards the camera), d is the camera height.
+ */
+class FloorPlaneTracker
+{
+public:
+	FloorPlaneTracker(
+		float max_distance, //!< points further away are not used for fitting [m]
+		float inlier_distance = 0.05, //!< max distance of a floor point from the plane [m]
+		unsigned int subsample_step = 31, //!< every n-th point is used for fitting
+		unsigned int ransac_iterations = 64
+			);
+	~FloorPlaneTracker();
+	// Detects or tracks the floor plane, returns true if a floor plane is known
+	bool Update( const Vertex * vertices, const unsigned int n_vertices );
+	// Signed distance of a point above the floor plane
+	inline float DistanceAbove( const Vertex & v )const
+	{ return normal[0]*v.x + normal[1]*v.y + normal[2]*v.z + d; }
+	bool is_valid()const
+	{ return valid; }
+	const float * get_normal()const
+	{ return normal; }
+	float get_camera_height()const
+	{ return d; }
+
+	const float max_distance;
+	const float inlier_distance;
+	const unsigned int subsample_step;
+	const unsigned int ransac_iterations;
+	// Constraints on acceptable floor planes
+	const float min_normal_up = 0.5; //!< min cosine between plane normal and camera's up direction
+	const float min_camera_height = 0.2; //!< [m]
+	const float max_camera_height = 3.0; //!< [m]
+	const float min_inlier_fraction = 0.1; //!< of the subsampled points
+private:
+	void CollectSamples( const Vertex * vertices, const unsigned int n_vertices );
+	// Counts points closer than max_plane_distance to the plane
+	unsigned int CountInliers( const float n[3], float d, float max_plane_distance )const;
+	// Least squares fit to the inliers of the given plane, returns false if the fit is unusable
+	bool RefinePlane( float n[3], float & d, float max_plane_distance )const;
+	bool FitRansac( float n[3], float & d );
+	bool IsAcceptable( const float n[3], float d )const;
+	uint32_t Random();
+
+	float normal[3];
+	float d;
+	bool valid;
+	unsigned int n_samples;
+	unsigned int samples_capacity;
+	float * samples; //!< x, y, z of subsampled points
+	uint32_t random_state;
+};
+
+#endif /* SRC_FLOORPLANE_H_ */
@@ -0,0 +1,13 @@
+/*
+ * FrameSource.cpp
+ */
+
+#include "FrameSource.h"
+#include <chrono>
+
+double FrameSource::Now()
+{
+	// librealsense reports the time of arrival in ms of the system clock
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch() ).count() / 1000.;
+}
@@ -0,0 +1,57 @@
+/*
+ * FrameSource.h
+ */
+
+#ifndef SRC_FRAMESOURCE_H_
+#define SRC_FRAMESOURCE_H_
+
+#include "PointCloud.h"
+#include <memory>
+
+// Color image delivered with a frame, data is NULL if the source has no color stream
+struct ColorImage
+{
+	const void * data;
+	int width;
+	int height;
+	int bytes_per_pixel;
+	int stride_in_bytes;
+};
+
+/* One depth frame converted to vertices.
+ * The vertices and color images are not copied out of the source,
+ * they stay valid as long as the frame (or a copy of its owner) exists.
+ */
+struct Frame
+{
+	const Vertex * vertices; //!< camera_w*camera_h vertices, row by row
+	unsigned int n_vertices;
+	unsigned long long frame_number;
+	double time_of_arrival; //!< [ms] system clock time when the frame arrived, same clock as FrameSource::Now()
+	ColorImage color; //!< raw color image
+	ColorImage aligned_color; //!< color image aligned to the depth image
+	std::shared_ptr<const void> owner; //!< keeps the memory of the frame alive
+};
+
+/* Interface of the depth frame sources: a live camera, a recording or a generator.
+ * Live sources deliver frames in real time and frames can be dropped between pings,
+ * the other sources deliver every frame that should be rendered, as fast as they are asked for.
+ */
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+	// Waits for the next frame, returns false when there are no more frames
+	virtual bool WaitForFrame( Frame & frame ) = 0;
+	// True if WaitForFrame returned false on an error rather than at the end of the frames
+	virtual bool has_failed()const
+	{ return false; }
+	// Drops the frames that arrived since the last call, so that the next frame is fresh
+	virtual void DiscardFrames() {}
+	virtual bool is_live()const = 0;
+	virtual CameraIntrinsics get_intrinsics()const = 0;
+	// Current system clock time [ms], as used for Frame::time_of_arrival
+	static double Now();
+};
+
+#endif /* SRC_FRAMESOURCE_H_ */
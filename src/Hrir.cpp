@@ -0,0 +1,156 @@
+/*
+ * Hrir.cpp
+ */
+
+#include "Hrir.h"
+#include "FFT.h"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdint.h>
+
+using namespace std;
+
+namespace
+{
+const float speed_of_sound_in_air = 343.; //!< [m/s]
+
+// Unit vector of a direction, x to the front, y to the left, z up
+void DirectionVector( float azimuth, float elevation, float v[3] )
+{
+	const float a = azimuth * M_PI / 180.;
+	const float e = elevation * M_PI / 180.;
+	v[0] = cos(e) * cos(a);
+	v[1] = cos(e) * sin(a);
+	v[2] = sin(e);
+}
+
+// HRIR of the ear on the left (ear_side 1) or right (ear_side -1) of a spherical head,
+// designed in the frequency domain (Brown and Duda, A structural model for binaural sound synthesis, 1998)
+std::vector<float> SphericalHeadEar( const float direction[3], float ear_side, unsigned int sample_rate )
+{
+	const float radius = HrirSet::head_radius;
+	const FFT fft( sample_rate / 400 ); // about 3 ms
+	const unsigned int n = fft.n;
+	// angle between the direction and the ear
+	const float theta = acos( max( -1.f, min( 1.f, ear_side*direction[1] ) ) );
+	// head shadow: a one-pole one-zero filter whose zero moves with the angle
+	const float alpha_min = 0.1;
+	const float theta_min = 150. * M_PI / 180.;
+	const float alpha = (1. + alpha_min/2.) + (1. - alpha_min/2.) * cos( theta / theta_min * M_PI );
+	const float omega_0 = speed_of_sound_in_air / radius;
+	// Woodworth's delay around the sphere, after a latency that keeps the earliest ear causal
+	const float delay_around_head = theta < M_PI/2. ? -radius/speed_of_sound_in_air * cos(theta) :
+			radius/speed_of_sound_in_air * (theta - M_PI/2.);
+	const float delay = 2.*radius/speed_of_sound_in_air + delay_around_head;
+
+	std::vector<complex_t> values( n );
+	for( unsigned int k=0; k<=n/2; ++k )
+	{
+		const float omega = 2.*M_PI * k * sample_rate / n;
+		const complex_t shadow = complex_t( 1.f, alpha*omega/(2.f*omega_0) ) / complex_t( 1.f, omega/(2.f*omega_0) );
+		values[k] = shadow * complex_t( cos( omega*delay ), -sin( omega*delay ) );
+		if( k > 0 && k < n/2 )
+			values[n-k] = conj( values[k] );
+	}
+	values[n/2] = complex_t( values[n/2].real(), 0.f );
+	fft.Inverse( &values[0] );
+	std::vector<float> hrir( n );
+	for( unsigned int j=0; j<n; ++j )
+		hrir[j] = values[j].real();
+	return hrir;
+}
+}
+
+const float HrirSet::head_radius = 0.0875;
+
+HrirSet::HrirSet( unsigned int sample_rate )
+	:sample_rate(sample_rate),
+	 n_taps(0)
+{
+}
+
+bool HrirSet::Load( const std::string & filename )
+{
+	std::ifstream f( filename.c_str(), std::ios_base::binary );
+	uint32_t header[3] = { 0, 0, 0 };
+	if( f.is_open() == false || f.read( (char *)header, sizeof(header) ).good() == false ||
+			header[1] == 0 || header[2] == 0 )
+	{
+		cerr << "Could not read the HRIRs of " << filename << ", using a spherical head" << endl;
+		return false;
+	}
+	if( header[0] != sample_rate )
+	{
+		cerr << "The HRIRs of " << filename << " are sampled at " << header[0] << " Hz instead of " <<
+				sample_rate << " Hz, using a spherical head" << endl;
+		return false;
+	}
+	const unsigned int n_directions = header[1];
+	std::vector<float> record( 2 + 2*header[2] );
+	std::vector<float> new_azimuths, new_elevations, new_hrirs;
+	for( unsigned int i=0; i<n_directions; ++i )
+	{
+		if( f.read( (char *)&record[0], record.size()*sizeof(float) ).good() == false )
+		{
+			cerr << "The HRIRs of " << filename << " end after " << i << " directions, using a spherical head" << endl;
+			return false;
+		}
+		new_azimuths.push_back( record[0] );
+		new_elevations.push_back( record[1] );
+		new_hrirs.insert( new_hrirs.end(), record.begin()+2, record.end() );
+	}
+	n_taps = header[2];
+	azimuths.swap( new_azimuths );
+	elevations.swap( new_elevations );
+	hrirs.swap( new_hrirs );
+	cout << "Read " << n_directions << " HRIRs of " << n_taps << " taps from " << filename << endl;
+	return true;
+}
+
+void HrirSet::GetHrir(
+	float azimuth,
+	float elevation,
+	std::vector<float> & left,
+	std::vector<float> & right
+	)const
+{
+	if( is_measured() == false )
+	{
+		SphericalHeadHrir( azimuth, elevation, sample_rate, left, right );
+		return;
+	}
+	// the nearest direction has the largest cosine
+	float direction[3], measured[3];
+	DirectionVector( azimuth, elevation, direction );
+	unsigned int nearest = 0;
+	float nearest_cosine = -2.;
+	for( unsigned int i=0; i<azimuths.size(); ++i )
+	{
+		DirectionVector( azimuths[i], elevations[i], measured );
+		const float cosine = direction[0]*measured[0] + direction[1]*measured[1] + direction[2]*measured[2];
+		if( cosine > nearest_cosine )
+		{
+			nearest = i;
+			nearest_cosine = cosine;
+		}
+	}
+	const float * taps = &hrirs[2*n_taps*nearest];
+	left.assign( taps, taps + n_taps );
+	right.assign( taps + n_taps, taps + 2*n_taps );
+}
+
+void HrirSet::SphericalHeadHrir(
+	float azimuth,
+	float elevation,
+	unsigned int sample_rate,
+	std::vector<float> & left,
+	std::vector<float> & right
+	)
+{
+	float direction[3];
+	DirectionVector( azimuth, elevation, direction );
+	left = SphericalHeadEar( direction, 1., sample_rate );
+	right = SphericalHeadEar( direction, -1., sample_rate );
+}
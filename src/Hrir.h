@@ -0,0 +1,55 @@
+/*
+ * Hrir.h
+ */
+
+#ifndef SRC_HRIR_H_
+#define SRC_HRIR_H_
+
+#include <vector>
+#include <string>
+
+/* This class holds head related impulse responses (HRIRs),
+ * the impulse responses of the L and R ears to a sound coming from a direction.
+ * The HRIRs are either measured ones read from a file (see scripts/sofa-to-hrir.py),
+ * of which the one of the nearest direction is used,
+ * or those of the spherical head model of Brown and Duda (interaural time difference and head shadow),
+ * which are computed for any direction but have neither elevation nor front-back cues.
+ * Directions are those of SOFA files: the azimuth goes counterclockwise from the front
+ * (+90 deg is on the left) and the elevation up from the horizontal plane.
+ */
+class HrirSet
+{
+public:
+	HrirSet( unsigned int sample_rate ); //!< [Hz], the set starts with the spherical head model
+	// Reads the measured HRIRs of a file written by scripts/sofa-to-hrir.py:
+	// little endian uint32 sample rate, number of directions and number of taps, then for each direction
+	// float32 azimuth and elevation [deg], the taps of the L ear and the taps of the R ear.
+	// Returns false and keeps the previous HRIRs if the file cannot be read or has another sample rate
+	bool Load( const std::string & filename );
+	void GetHrir(
+			float azimuth, //!< [deg]
+			float elevation, //!< [deg]
+			std::vector<float> & left,
+			std::vector<float> & right
+			)const;
+	// HRIRs of a rigid sphere of head_radius, delayed by a little more than the sound takes across the head
+	static void SphericalHeadHrir(
+			float azimuth, //!< [deg]
+			float elevation, //!< [deg]
+			unsigned int sample_rate, //!< [Hz]
+			std::vector<float> & left,
+			std::vector<float> & right
+			);
+	bool is_measured()const
+	{ return azimuths.empty() == false; }
+
+	const unsigned int sample_rate;
+	static const float head_radius; //!< [m]
+private:
+	unsigned int n_taps; //!< of the measured HRIRs
+	std::vector<float> azimuths; //!< of the measured HRIRs [deg]
+	std::vector<float> elevations;
+	std::vector<float> hrirs; //!< the L and R taps of each direction after each other
+};
+
+#endif /* SRC_HRIR_H_ */
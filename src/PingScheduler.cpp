@@ -0,0 +1,112 @@
+/*
+ * PingScheduler.cpp
+ */
+
+#include "PingScheduler.h"
+#include <cmath>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+PingScheduler::PingScheduler(
+	const CameraIntrinsics & intrinsics,
+	const std::vector<WeightTerm> & weight_terms
+	)
+	:intrinsics(intrinsics),
+	 weight_terms(weight_terms),
+	 i_current(0),
+	 i_next(0)
+{
+}
+
+PingScheduler::~PingScheduler()
+{
+	for( unsigned int i=0; i<entries.size(); ++i )
+	{
+		delete entries[i].renderer;
+		delete entries[i].roi_map;
+	}
+}
+
+void PingScheduler::AddRenderer(
+	SimpleDepthRenderer * renderer,
+	float roi_top,
+	float roi_bottom
+	)
+{
+	const unsigned int camera_h = intrinsics.height;
+	const unsigned int row_begin = min( (unsigned int)( max( roi_top, 0.f ) * camera_h + 0.5 ), camera_h );
+	const unsigned int row_end = min( (unsigned int)( max( roi_bottom, 0.f ) * camera_h + 0.5 ), camera_h );
+	cout << "Ping " << entries.size() << " renders rows " << row_begin << " - " << row_end <<
+			" at " << renderer->base_frequency << " Hz" << endl;
+	Entry e;
+	e.renderer = renderer;
+	e.roi_map = NULL;
+	if( row_begin > 0 || row_end < camera_h )
+	{
+		std::vector<WeightTerm> terms( weight_terms );
+		WeightTerm rows = { WeightRows, 0., 0., roi_top, roi_bottom };
+		terms.push_back( rows );
+		e.roi_map = new WeightMap( terms, intrinsics );
+		renderer->SetWeightMap( e.roi_map );
+	}
+	entries.push_back(e);
+}
+
+void PingScheduler::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	if( entries.empty() )
+		return;
+	i_current = i_next;
+	i_next = (i_next + 1) % entries.size();
+	const Entry & e = entries[i_current];
+
+	// the rows outside the region of interest are skipped by the renderer (see AddRenderer)
+	e.renderer->RenderPointcloudToSound(
+			vertices, n_vertices, sound_out, sound_n );
+}
+
+std::vector<std::string> PingScheduler::SplitList( const std::string & list )
+{
+	std::vector<std::string> items;
+	std::stringstream ss(list);
+	std::string item;
+	while( std::getline( ss, item, ',' ) )
+		items.push_back(item);
+	return items;
+}
+
+bool PingScheduler::ParseRoi( const std::string & roi, float & roi_top, float & roi_bottom )
+{
+	if( roi == "full" || roi.empty() )
+	{
+		roi_top = 0.;
+		roi_bottom = 1.;
+		return true;
+	}
+	if( roi == "top" )
+	{
+		roi_top = 0.;
+		roi_bottom = 0.5;
+		return true;
+	}
+	if( roi == "bottom" )
+	{
+		roi_top = 0.5;
+		roi_bottom = 1.;
+		return true;
+	}
+	char separator;
+	std::stringstream ss(roi);
+	if( !( ss >> roi_top >> separator >> roi_bottom ) || separator != '-' || roi_top >= roi_bottom )
+	{
+		cerr << "Could not parse region of interest \"" << roi << "\"" << endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * PingScheduler.h
+ */
+
+#ifndef SRC_PINGSCHEDULER_H_
+#define SRC_PINGSCHEDULER_H_
+
+#include "SoundRenderer.h"
+#include "WeightMap.h"
+#include <vector>
+#include <string>
+
+/* This class renders consecutive pings with different renderers,
+ * e.g. the full scene on one ping and the bottom half of the image
+ * at another frequency on the next one.
+ * All renderers are constructed before the session starts and each one
+ * keeps its own state (carriers, distance tables, weights),
+ * the region of interest of each renderer is a range of image rows,
+ * precomputed as a weight map that the renderer skips the other rows with.
+ * Switching between the renderers allocates and copies nothing.
+ */
+class PingScheduler
+{
+public:
+	PingScheduler(
+		const CameraIntrinsics & intrinsics,
+		const std::vector<WeightTerm> & weight_terms = std::vector<WeightTerm>() //!< the terms of the weight map
+			// of the renderers, the weight maps of the regions of interest include them
+			);
+	~PingScheduler();
+	// Adds a renderer to the rotation, the scheduler takes ownership of the renderer,
+	// a renderer with a region of interest gets its weight map (which replaces the one it has)
+	void AddRenderer(
+		SimpleDepthRenderer * renderer,
+		float roi_top = 0., //!< first rendered row (fraction of image height)
+		float roi_bottom = 1. //!< end of the rendered rows (fraction of image height)
+		);
+	// Renders the next ping with the next renderer in the rotation
+	void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+	// Renderer that rendered the last ping
+	SimpleDepthRenderer * get_current_renderer()const
+	{ return entries[i_current].renderer; }
+	unsigned int size()const
+	{ return entries.size(); }
+
+	// Splits a comma separated list
+	static std::vector<std::string> SplitList( const std::string & list );
+	// Parses a region of interest: "full", "top", "bottom" or "<top>-<bottom>" (fractions of image height)
+	static bool ParseRoi( const std::string & roi, float & roi_top, float & roi_bottom );
+
+	const CameraIntrinsics intrinsics;
+	const std::vector<WeightTerm> weight_terms;
+private:
+	struct Entry
+	{
+		SimpleDepthRenderer * renderer;
+		WeightMap * roi_map; //!< NULL if the renderer renders all rows
+	};
+	std::vector<Entry> entries;
+	unsigned int i_current; //!< entry of the last ping
+	unsigned int i_next; //!< entry of the next ping
+};
+
+#endif /* SRC_PINGSCHEDULER_H_ */
@@ -0,0 +1,29 @@
+/*
+ * PointCloud.h
+ */
+
+#ifndef SRC_POINTCLOUD_H_
+#define SRC_POINTCLOUD_H_
+
+/* Point and camera types of the rendering library,
+ * so that the renderers do not depend on the camera SDK.
+ * Vertex has the same memory layout as rs2::vertex,
+ * the conversions from librealsense types are in RealSenseAdapter.h.
+ */
+struct Vertex
+{
+	float x, y, z; //!< [m], z is the depth, zero if there is no depth
+};
+
+// Pinhole camera model of the depth camera, vertices are organized in width x height images
+struct CameraIntrinsics
+{
+	int width;
+	int height;
+	float ppx; //!< principal point [pixels]
+	float ppy;
+	float fx; //!< focal length [pixels]
+	float fy;
+};
+
+#endif /* SRC_POINTCLOUD_H_ */
@@ -0,0 +1,33 @@
+/*
+ * RealSenseAdapter.h
+ */
+
+#ifndef SRC_REALSENSEADAPTER_H_
+#define SRC_REALSENSEADAPTER_H_
+
+#include "PointCloud.h"
+#include <librealsense2/rs.hpp>
+
+// Conversions from librealsense types to the types of the rendering library,
+// only the applications that talk to the camera include this header
+
+static_assert( sizeof(Vertex) == sizeof(rs2::vertex), "Vertex must have the same layout as rs2::vertex" );
+
+inline const Vertex * ToVertices( const rs2::vertex * vertices )
+{
+	return reinterpret_cast<const Vertex *>( vertices );
+}
+
+inline CameraIntrinsics ToCameraIntrinsics( const rs2_intrinsics & intrinsics )
+{
+	CameraIntrinsics c;
+	c.width = intrinsics.width;
+	c.height = intrinsics.height;
+	c.ppx = intrinsics.ppx;
+	c.ppy = intrinsics.ppy;
+	c.fx = intrinsics.fx;
+	c.fy = intrinsics.fy;
+	return c;
+}
+
+#endif /* SRC_REALSENSEADAPTER_H_ */
@@ -0,0 +1,178 @@
+/*
+ * RealSenseFrameSource.cpp
+ */
+
+#include "RealSenseFrameSource.h"
+#include "RealSenseAdapter.h"
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+// librealsense frames referenced by a Frame
+struct RealSenseFrames
+{
+	rs2::frameset data;
+	rs2::points points;
+	rs2::frameset aligned;
+};
+
+ColorImage ToColorImage( const rs2::video_frame & vf )
+{
+	ColorImage c;
+	c.data = vf ? vf.get_data() : NULL;
+	c.width = vf ? vf.get_width() : 0;
+	c.height = vf ? vf.get_height() : 0;
+	c.bytes_per_pixel = vf ? vf.get_bytes_per_pixel() : 0;
+	c.stride_in_bytes = vf ? vf.get_stride_in_bytes() : 0;
+	return c;
+}
+}
+
+RealSenseFrameSource::RealSenseFrameSource( bool align_color )
+	:align_color(align_color),
+	 align( RS2_STREAM_DEPTH ),
+	 failed( false )
+{
+}
+
+RealSenseFrameSource::~RealSenseFrameSource()
+{
+	try
+	{
+		pipe.stop();
+	}
+	catch( const rs2::error & e )
+	{
+		cerr << "Error stopping the camera pipeline : " << e.what() << endl;
+	}
+}
+
+void RealSenseFrameSource::Start( rs2::config & cfg )
+{
+	profile = pipe.start( cfg );
+}
+
+CameraIntrinsics RealSenseFrameSource::get_intrinsics()const
+{
+	return ToCameraIntrinsics( profile.get_stream(RS2_STREAM_DEPTH)
+			.as<rs2::video_stream_profile>().get_intrinsics() );
+}
+
+bool RealSenseFrameSource::ToFrame( const rs2::frameset & data, Frame & frame )
+{
+	rs2::depth_frame depth_frame = data.get_depth_frame();
+	if( !depth_frame )
+	{
+		failed = true;
+		return false;
+	}
+	std::shared_ptr<RealSenseFrames> frames = std::make_shared<RealSenseFrames>();
+	frames->data = data;
+	// Apply any spatial filters here and swap the depth_frame for the processed depth frame
+
+	// TODO: make openMP parallelization of
+	// librealsense/src/proc/pointcloud.cpp deproject_depth
+	// Even better: parse the depth frame directly, as the deprojection seems to be nothing more than
+	// some linear multiplication (TODO as part of optimizations and speedups, if necessary)
+	// See librealsense/include/librealsense2/rsutil.h deproject_pixel_to_point
+	frames->points = pc.calculate( depth_frame );
+	frame.vertices = ToVertices( frames->points.get_vertices() );
+	frame.n_vertices = frames->points.size();
+	frame.frame_number = depth_frame.get_frame_number();
+	// Time examples : line 195 of librealsense/wrappers/opencv/latency-tool/latency-detector.h
+	// The frame timestamp is device clock that can not be related to CPU clock,
+	// so instead we measure latency from the time the frame was released from the driver
+	frame.time_of_arrival = depth_frame.get_frame_metadata( RS2_FRAME_METADATA_TIME_OF_ARRIVAL );
+	frame.color = ToColorImage( data.get_color_frame() );
+	frame.aligned_color.data = NULL;
+	if( align_color && frame.color.data != NULL )
+	{
+		// Align the color frame to depth frame
+		frames->aligned = align.process( data );
+		frame.aligned_color = ToColorImage( frames->aligned.get_color_frame() );
+	}
+	frame.owner = frames;
+	return true;
+}
+
+RealSenseCameraSource::RealSenseCameraSource(
+		int camera_w,
+		int camera_h,
+		int fps,
+		bool enable_color,
+		bool align_color,
+		const std::string & record_filename
+		)
+	:RealSenseFrameSource( align_color )
+{
+	rs2::config cfg;
+	cout << "Configuring camera stream with parameters w,h = " << camera_w << "," << camera_h;
+	cout << "     streaming at " << fps << " frames per second" << endl;
+	cfg.enable_stream( RS2_STREAM_DEPTH, camera_w, camera_h, RS2_FORMAT_Z16, fps );
+	if( enable_color )
+		cfg.enable_stream( RS2_STREAM_COLOR, camera_w, camera_h, RS2_FORMAT_RGB8, fps );
+	if( record_filename.length() > 0 )
+		cfg.enable_record_to_file( record_filename );
+	Start( cfg );
+}
+
+bool RealSenseCameraSource::WaitForFrame( Frame & frame )
+{
+	// TODO: possibly migrate realsense code to a "Asynchronous method"
+	rs2::frameset data = pipe.wait_for_frames();
+	if( ToFrame( data, frame ) == false )
+	{
+		cerr << "Camera delivered a frameset without a depth frame" << endl;
+		return false; // This should not happen, as we have to get depth frames in all cases
+	}
+	return true;
+}
+
+void RealSenseCameraSource::DiscardFrames()
+{
+	rs2::frameset data;
+	while( pipe.poll_for_frames( &data ) )
+		;
+}
+
+RealSenseBagSource::RealSenseBagSource(
+		const std::string & filename,
+		int frame_multiplier,
+		std::chrono::nanoseconds end_margin,
+		bool align_color
+		)
+	:RealSenseFrameSource( align_color ),
+	 frame_multiplier( frame_multiplier > 0 ? frame_multiplier : 1 ),
+	 end_margin( end_margin ),
+	 at_end( false )
+{
+	rs2::config cfg;
+	cout << "Replaying camera frames from " << filename << endl;
+	cfg.enable_device_from_file( filename, false );
+	Start( cfg );
+	// Pause the replay when the code is executing in order to deterministically get the same frames on every run
+	get_playback().pause();
+	recording_duration = get_playback().get_duration();
+}
+
+bool RealSenseBagSource::WaitForFrame( Frame & frame )
+{
+	while( at_end == false )
+	{
+		get_playback().resume();
+		rs2::frameset data = pipe.wait_for_frames();
+		// use get_duration and get_position to check if there will be no more frames
+		const std::chrono::nanoseconds current_recording_time( get_playback().get_position() );
+		if( recording_duration - current_recording_time < end_margin )
+			at_end = true;
+		const unsigned long long frame_num = data.get_depth_frame().get_frame_number();
+		if( (frame_num == 0) || (frame_num % frame_multiplier != 0) )
+			continue;
+		// pause playback in order not to skip any frames
+		get_playback().pause();
+		return ToFrame( data, frame );
+	}
+	return false;
+}
@@ -0,0 +1,85 @@
+/*
+ * RealSenseFrameSource.h
+ */
+
+#ifndef SRC_REALSENSEFRAMESOURCE_H_
+#define SRC_REALSENSEFRAMESOURCE_H_
+
+#include "FrameSource.h"
+#include <librealsense2/rs.hpp>
+#include <chrono>
+#include <string>
+
+/* Frame sources that read the frames with librealsense,
+ * they are not part of the rendering library.
+ * The pointcloud is calculated from the depth frame, and the frames
+ * keep the librealsense frames alive instead of copying them.
+ */
+class RealSenseFrameSource: public FrameSource
+{
+public:
+	virtual ~RealSenseFrameSource();
+	virtual CameraIntrinsics get_intrinsics()const;
+	virtual bool has_failed()const
+	{ return failed; }
+protected:
+	RealSenseFrameSource(
+			bool align_color //!< deliver the color image aligned to depth as well
+			);
+	void Start( rs2::config & cfg );
+	// Calculates the pointcloud of a frameset, returns false (and fails) if there is no depth frame
+	bool ToFrame( const rs2::frameset & data, Frame & frame );
+
+	const bool align_color;
+	rs2::pipeline pipe;
+	rs2::pipeline_profile profile;
+	rs2::pointcloud pc;
+	rs2::align align;
+	bool failed; //!< a frameset had no depth frame
+};
+
+// Live frames from the camera, optionally recorded to a bag file
+class RealSenseCameraSource: public RealSenseFrameSource
+{
+public:
+	RealSenseCameraSource(
+			int camera_w,
+			int camera_h,
+			int fps,
+			bool enable_color,
+			bool align_color,
+			const std::string & record_filename //!< empty for not recording
+			);
+	virtual bool WaitForFrame( Frame & frame );
+	virtual void DiscardFrames();
+	virtual bool is_live()const
+	{ return true; }
+};
+
+/* Frames played from a bag file.
+ * The playback is paused while rendering and only every frame_multiplier-th frame is delivered,
+ * so that every run renders the same frames.
+ */
+class RealSenseBagSource: public RealSenseFrameSource
+{
+public:
+	RealSenseBagSource(
+			const std::string & filename,
+			int frame_multiplier, //!< frames per rendered ping
+			std::chrono::nanoseconds end_margin, //!< playback ends this long before the end of the recording
+			bool align_color
+			);
+	virtual bool WaitForFrame( Frame & frame );
+	virtual bool is_live()const
+	{ return false; }
+
+	const int frame_multiplier;
+	const std::chrono::nanoseconds end_margin;
+private:
+	rs2::playback get_playback()
+	{ return pipe.get_active_profile().get_device().as<rs2::playback>(); }
+	std::chrono::nanoseconds recording_duration;
+	bool at_end;
+};
+
+#endif /* SRC_REALSENSEFRAMESOURCE_H_ */
@@ -0,0 +1,68 @@
+/*
+ * RenderPlan.cpp
+ */
+
+#include "RenderPlan.h"
+#include "SoundRenderer.h"
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+// Correction for exponential perception of loudness (see SoundRenderer.cpp)
+std::vector<float> MakeAmplitudeTable( unsigned int steps, unsigned int n )
+{
+	const double kL = log(10.) / (2.*log(2.));
+	std::vector<float> table( n+1 );
+	for( unsigned int i=0; i<=n; ++i )
+		table[i] = pow( (double)i/steps, kL );
+	return table;
+}
+}
+
+const std::vector<float> RenderPlan::amplitude_table = MakeAmplitudeTable( amplitude_table_steps, amplitude_table_n );
+
+RenderPlan::RenderPlan(
+	const DistanceMapping & mapping,
+	float base_frequency,
+	float frequency_doubling_time,
+	unsigned int sound_n_samples
+	)
+	:base_frequency(base_frequency),
+	 frequency_doubling_time(frequency_doubling_time),
+	 sound_n_samples(sound_n_samples),
+	 n_bins(mapping.n_bins),
+	 sample_edges(n_bins+1),
+	 loudness_correction(n_bins,1.f),
+	 step_amplitudes(n_bins),
+	 span_starts(n_bins+1)
+{
+	const bool is_chirp = frequency_doubling_time > 0.;
+	const double chirp_rate = is_chirp ? log(2.) / frequency_doubling_time : 0.;
+	const double chirp_cycles = is_chirp ? base_frequency / chirp_rate : 0.;
+	const unsigned int * mapping_edges = mapping.get_sample_edges();
+
+	for( unsigned int i=0; i<=n_bins; ++i )
+		sample_edges[i] = mapping_edges[i] < sound_n_samples ? mapping_edges[i] : sound_n_samples;
+
+	// the correction is that of the frequency in the middle of the bin
+	if( is_chirp )
+	{
+		for( unsigned int i=0; i<n_bins; ++i )
+		{
+			const float avg_t = 0.5 * (mapping_edges[i] + mapping_edges[i+1]) / mapping.sample_rate;
+			loudness_correction[i] = SoundRenderer::EqualLoudnessCorrection( base_frequency * exp( chirp_rate * avg_t ) );
+		}
+	}
+
+	// same phase as SoundRenderer::RenderAmplitudesToFrequencyWithTimeTable
+	carrier.resize( sample_edges[n_bins] );
+#pragma omp parallel for
+	for( unsigned int j=0; j<carrier.size(); ++j )
+	{
+		const float t = j / (float)mapping.sample_rate;
+		const float phase = is_chirp ? chirp_cycles * ( exp( chirp_rate * t ) - 1. ) : base_frequency * t;
+		carrier[j] = sin( 2*M_PI*phase );
+	}
+}
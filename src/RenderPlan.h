@@ -0,0 +1,74 @@
+/*
+ * RenderPlan.h
+ */
+
+#ifndef SRC_RENDERPLAN_H_
+#define SRC_RENDERPLAN_H_
+
+#include "Defaults.h"
+#include "DistanceMapping.h"
+#include <vector>
+
+/* This class holds everything of a ping that does not depend on the counts:
+ * the sample range and the equal loudness correction of each bin
+ * and the carrier waveform, for one frequency, frequency doubling time and sound length.
+ * A renderer builds its plans once, each ping then only needs table lookups
+ * (see SoundRenderer::RenderAmplitudesWithPlan).
+ * The plan also holds the scratch buffers of the synthesis, sized once,
+ * so a plan must not render two channels at the same time.
+ */
+class RenderPlan
+{
+public:
+	RenderPlan(
+		const DistanceMapping & mapping,
+		float base_frequency, //!< [Hz]
+		float frequency_doubling_time, //!< [s], constant frequency if not positive
+		unsigned int sound_n_samples //!< samples per channel of the rendered sound
+			);
+
+	bool Matches( float base_frequency, float frequency_doubling_time, unsigned int sound_n_samples )const
+	{
+		return base_frequency == this->base_frequency && sound_n_samples == this->sound_n_samples &&
+				( frequency_doubling_time == this->frequency_doubling_time ||
+				( frequency_doubling_time <= 0.f && this->frequency_doubling_time <= 0.f ) );
+	}
+
+	// Amplitude (fraction of the max amplitude, may exceed 1) of a loudness, interpolated in a table
+	static inline float AmplitudeOfLoudness( float loudness )
+	{
+		const float x = loudness > 0.f ? loudness * amplitude_table_steps : 0.f;
+		if( x >= amplitude_table_n )
+			return amplitude_table[amplitude_table_n]; // loud enough to saturate after any correction
+		const unsigned int i = (unsigned int)x;
+		return amplitude_table[i] + (x - i) * (amplitude_table[i+1] - amplitude_table[i]);
+	}
+
+	const unsigned int * get_sample_edges()const //!< bin i is rendered from sample [i] to sample [i+1], clamped to the sound
+	{ return &sample_edges[0]; }
+	const float * get_loudness_correction()const //!< equal loudness correction of the amplitude of each bin
+	{ return &loudness_correction[0]; }
+	const float * get_carrier()const //!< sine of the carrier phase at each rendered sample
+	{ return &carrier[0]; }
+	float * get_step_amplitudes()const //!< scratch, n_bins long
+	{ return &step_amplitudes[0]; }
+	unsigned int * get_span_starts()const //!< scratch, n_bins+1 long
+	{ return &span_starts[0]; }
+
+	const float base_frequency;
+	const float frequency_doubling_time;
+	const unsigned int sound_n_samples;
+	const unsigned int n_bins;
+private:
+	static const unsigned int amplitude_table_steps = 1024; //!< table entries per unit of loudness
+	static const unsigned int amplitude_table_n = 2*amplitude_table_steps; //!< the table covers loudness 0 to 2
+	static const std::vector<float> amplitude_table;
+
+	std::vector<unsigned int> sample_edges;
+	std::vector<float> loudness_correction;
+	std::vector<float> carrier;
+	mutable std::vector<float> step_amplitudes;
+	mutable std::vector<unsigned int> span_starts;
+};
+
+#endif /* SRC_RENDERPLAN_H_ */
@@ -0,0 +1,381 @@
+/*
+ * RendererParameters.cpp
+ */
+
+#include "RendererParameters.h"
+#include "RendererRegistry.h"
+#include "PingScheduler.h"
+#include "argh.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+namespace
+{
+template<typename T>
+T get_value( argh::parser & cmdl, std::string parameter, T default_value )
+{
+	T t_tmp;
+	cmdl( parameter, default_value ) >> t_tmp;
+	return t_tmp;
+}
+}
+
+void AddRendererParameters( argh::parser & cmdl )
+{
+	cmdl.add_params(
+			{
+				"--renderer-max-distance",
+				"--renderer-step-distance",
+				"--renderer-speed-of-sound",
+				"--renderer-stereo-distance",
+				"--renderer-max-delay",
+				"--renderer-elevation-delay",
+				"--renderer-base-frequency",
+				"--renderer-freq-doubling-length",
+				"--renderer-base-amplitude",
+				"--renderer-start-frequency",
+				"--renderer-start-duration",
+				"--renderer-start-amplitude",
+				"--renderer-interval-extra-time",
+				"--renderer-lower-distance",
+				"--renderer-lower-frequency",
+				"--renderer-lower-frequency-doubling-length",
+				"--renderer-lower-amplitude",
+				"--renderer-ball-radius",
+				"--renderer-scattering-vertical-gain",
+				"--renderer-scattering-horizontal-gain",
+				"--renderer-weight-map",
+				"--renderer-floor-frequency",
+				"--renderer-floor-frequency-doubling-length",
+				"--renderer-floor-amplitude",
+				"--renderer-floor-inlier-distance",
+				"--renderer-elevation-bands",
+				"--renderer-elevation-frequency-ratio",
+				"--renderer-distance-mapping",
+				"--renderer-distance-mapping-length",
+				"--renderer-distance-mapping-knots",
+				"--renderer-min-step-distance",
+				"--renderer-smoothing-sigma",
+				"--renderer-azimuth-bands",
+				"--renderer-sample-rate",
+				"--renderer-echo-pulse",
+				"--renderer-echo-pulse-duration",
+				"--renderer-binaural-azimuth-cells",
+				"--renderer-binaural-elevation-cells",
+				"--renderer-hrir",
+				"--renderer-sweep-columns",
+				"--renderer-sweep-octaves",
+				"--renderer-spectral-frame",
+				"--renderer-spectral-octaves",
+				"--renderer-spectral-phase",
+				"--renderer-spectral-frames",
+				"--depth-rendering-mode",
+				"--renderer-schedule-rois",
+				"--renderer-schedule-frequencies"
+			});
+}
+
+void PrintRendererParametersHelp()
+{
+	using namespace std;
+	cout << "[depth rendering]" << endl;
+	cout << "--renderer-max-distance=<max distance=4.0> : " << endl;
+	cout << "\t max distance for depth renderer" << endl;
+	cout << "--renderer-step-distance=<step distance=0.005> : " << endl;
+	cout << "\t step in distance for depth renderer (depth resolution)" << endl;
+	cout << "--renderer-speed-of-sound=<speed of sound=1.0> : " << endl;
+	cout << "\t speed of sound for depth renderer [m/s]" << endl;
+	cout << "--renderer-stereo-distance=<stereo distance=0.2> : " << endl;
+	cout << "\t distance between the depth renderer's \"ears\" [m]" << endl;
+	cout << "--renderer-max-delay=<max delay=0.3> : " << endl;
+	cout << "\t delay between the L and R channels of the points at the image edge" << endl;
+	cout << "\t in the delay_is_angle depth rendering mode, it follows the sine of the azimuth of the points [m]" << endl;
+	cout << "\t (together with the elevation delay, it must be less than 0.4 = twice the camera minimal range)" << endl;
+	cout << "--renderer-elevation-delay=<elevation delay=0.0> : " << endl;
+	cout << "\t delay of both channels of the points at the top or bottom image edge" << endl;
+	cout << "\t in the delay_is_angle depth rendering mode, the points above the optical axis are later [m]" << endl;
+	cout << "\t (if left unset, the elevation is not rendered)" << endl;
+	cout << "--renderer-base-frequency=<frequency=1000.0> : " << endl;
+	cout << "\t base frequency for depth renderer [Hz=1/s]" << endl;
+	cout << "--renderer-freq-doubling-length=<frequency doubling=-1.> : " << endl;
+	cout << "\t length at which the frequency doubles [m]" << endl;
+	cout << "\t (if left unset, the frequency remains constant)" << endl;
+	cout << "--renderer-base-amplitude=<amplitude=0.0> : " << endl;
+	cout << "\t base amplitude (added to signal) [%]" << endl;
+	cout << "--renderer-start-frequency=<frequency=1000.0> : " << endl;
+	cout << "\t start signal frequency for depth renderer [Hz=1/s]" << endl;
+	cout << "--renderer-start-duration=<duration=-1.> : " << endl;
+	cout << "\t start signal duration [s]" << endl;
+	cout << "\t (if left unset, the start signal is not played)" << endl;
+	cout << "--renderer-start-amplitude=<amplitude=50.0> : " << endl;
+	cout << "\t start signal amplitude [% of max]" << endl;
+	cout << "--renderer-interval-extra-time=<extre time=0.1> : " << endl;
+	cout << "\t extra time to wait between sound renders [s]" << endl;
+	cout << "\t (time between renders is this time + <max distance> / <speed of sound>" << endl;
+
+	cout << "--renderer-lower-distance=<lower distance=-1.> : " << endl;
+	cout << "\t the lower renderer is this far below the main renderer [m]" << endl;
+	cout << "\t if left unset, a negative value is set to signal that the lower channel should not be used" << endl;
+	cout << "--renderer-lower-frequency=<lower frequency=500> : " << endl;
+	cout << "\t base frequency of the lower renderer [Hz]" << endl;
+	cout << "--renderer-lower-frequency-doubling-length=<lower freq. doubling=-1.> : " << endl;
+	cout << "\t length at which the lower signal's frequency doubles [m]" << endl;
+	cout << "\t (if left unset, the frequency remains constant)" << endl;
+	cout << "--renderer-lower-amplitude=<amplitude=0.0> : " << endl;
+	cout << "\t lower signal base amplitude (added to signal) [%]" << endl;
+
+	cout << "--renderer-ball-radius=<radius=0.15> : " << endl;
+	cout << "\t radius of the ball used to fill the holes in the ball depth rendering mode [m]" << endl;
+
+	cout << "--renderer-scattering : " << endl;
+	cout << "\t if set, echoes from surfaces facing the listener are louder than echoes from tilted surfaces" << endl;
+	cout << "--renderer-scattering-vertical-gain=<gain=1.0> : " << endl;
+	cout << "\t scattering gain of vertical surfaces (walls, obstacles)" << endl;
+	cout << "--renderer-scattering-horizontal-gain=<gain=1.0> : " << endl;
+	cout << "\t scattering gain of horizontal surfaces (floor, ceiling)" << endl;
+	cout << "--renderer-weight-map=<term1+term2+...> : " << endl;
+	cout << "\t the points are weighted by the product of the terms, the points of zero weight are not rendered:" << endl;
+	cout << "\t cone:<half angle>[:<edge>] : the points within the half angle of the optical axis [deg]," << endl;
+	cout << "\t \t fading out over the edge angle [deg]" << endl;
+	cout << "\t top, bottom : the points of the top or bottom half of the image" << endl;
+	cout << "\t solid-angle : the points are weighted by the solid angle of their pixel," << endl;
+	cout << "\t \t so that the edges of the image do not count more than the centre" << endl;
+	cout << "\t (if left unset, all points count the same)" << endl;
+
+	cout << "--renderer-floor-frequency=<frequency=1000.0> : " << endl;
+	cout << "\t base frequency of the floor echoes in the floor depth rendering mode [Hz]" << endl;
+	cout << "--renderer-floor-frequency-doubling-length=<floor freq. doubling=-1.> : " << endl;
+	cout << "\t length at which the floor signal's frequency doubles [m]" << endl;
+	cout << "\t (if left unset, the frequency remains constant)" << endl;
+	cout << "--renderer-floor-amplitude=<amplitude=25.0> : " << endl;
+	cout << "\t max amplitude of the floor echoes [% of max]" << endl;
+	cout << "--renderer-floor-inlier-distance=<distance=0.05> : " << endl;
+	cout << "\t points closer than this to the detected floor plane belong to the floor [m]" << endl;
+
+	cout << "--renderer-elevation-bands=<bands=4> : " << endl;
+	cout << "\t number of elevation bands in the elevation depth rendering mode" << endl;
+	cout << "--renderer-elevation-frequency-ratio=<ratio=1.5> : " << endl;
+	cout << "\t frequency ratio between neighbouring elevation bands," << endl;
+	cout << "\t the lowest band is rendered at the base frequency" << endl;
+
+	cout << "--renderer-distance-mapping={linear,exponential,logarithmic,piecewise} : " << endl;
+	cout << "\t how distances are mapped to times in the rendered sound:" << endl;
+	cout << "\t linear : time is <distance> / <speed of sound>" << endl;
+	cout << "\t exponential : speed of sound increases exponentially with time," << endl;
+	cout << "\t \t near distances get more time (finer resolution) than far distances" << endl;
+	cout << "\t logarithmic : distance increases logarithmically with time," << endl;
+	cout << "\t \t far distances get more time than near distances" << endl;
+	cout << "\t piecewise : piecewise linear mapping through the specified knots" << endl;
+	cout << "\t (the echo of max distance always arrives at <max distance> / <speed of sound>)" << endl;
+	cout << "--renderer-distance-mapping-length=<length=1.0> : " << endl;
+	cout << "\t characteristic length of the exponential and logarithmic mappings [m]" << endl;
+	cout << "--renderer-distance-mapping-knots=<d1:t1,d2:t2,...> : " << endl;
+	cout << "\t knots of the piecewise mapping, distance [m] : time [fraction of max time]" << endl;
+	cout << "--renderer-min-step-distance=<min step=0.005> : " << endl;
+	cout << "\t narrower distance steps of non-linear mappings are merged [m]" << endl;
+	cout << "--renderer-smoothing-sigma=<sigma=0.0> : " << endl;
+	cout << "\t the distance histograms are smoothed with a Gaussian of this sigma [distance steps]" << endl;
+	cout << "\t before they are rendered, which reduces the flicker of low camera resolutions" << endl;
+	cout << "\t (if left unset or below 0.5, the histograms are not smoothed)" << endl;
+	cout << "--renderer-azimuth-bands=<bands=64> : " << endl;
+	cout << "\t the points are binned once by distance and column band, and the histograms of both ears" << endl;
+	cout << "\t are derived from the distance and the azimuth of the bands (simple, delay_is_angle, ball," << endl;
+	cout << "\t convolution and spectral depth rendering modes), more bands are more precise" << endl;
+	cout << "\t (if 0, the points are binned for each ear)" << endl;
+	cout << "--renderer-sample-rate=<rate=" << SAMPLE_RATE << "> : " << endl;
+	cout << "\t sample rate of the rendered sound, e.g. 16000, 22050, 44100 or 48000 [Hz]" << endl;
+	cout << "\t (lower rates render faster, the carriers must stay below half of the rate)" << endl;
+	cout << "--renderer-echo-pulse={click,chirp,<file>} : " << endl;
+	cout << "\t pulse emitted in the convolution depth rendering mode:" << endl;
+	cout << "\t click : a short tone burst at the base frequency" << endl;
+	cout << "\t chirp : a sweep from the base frequency over two octaves" << endl;
+	cout << "\t <file> : a recorded click, raw 16 bit mono samples at the sample rate" << endl;
+	cout << "--renderer-echo-pulse-duration=<duration=0.003> : " << endl;
+	cout << "\t duration of the click and of the chirp [s]" << endl;
+	cout << "--renderer-binaural-azimuth-cells=<cells=8> : " << endl;
+	cout << "--renderer-binaural-elevation-cells=<cells=3> : " << endl;
+	cout << "\t number of directions across and down the image in the binaural depth rendering mode" << endl;
+	cout << "--renderer-hrir=<file> : " << endl;
+	cout << "\t HRIRs of the binaural depth rendering mode, converted from a SOFA file" << endl;
+	cout << "\t by scripts/sofa-to-hrir.py at the sample rate" << endl;
+	cout << "\t (if left unset, the HRIRs of a spherical head are used)" << endl;
+	cout << "--renderer-sweep-columns=<bands=16> : " << endl;
+	cout << "\t number of column bands that the sweep depth rendering mode plays from left to right" << endl;
+	cout << "--renderer-sweep-octaves=<octaves=2.0> : " << endl;
+	cout << "\t the pitch of the sweep rises by this many octaves from max distance to the camera," << endl;
+	cout << "\t max distance is played at the base frequency" << endl;
+	cout << "--renderer-spectral-frame=<duration=0.05> : " << endl;
+	cout << "\t duration of a frame of the spectral depth rendering mode, rounded to a power of two samples [s]" << endl;
+	cout << "--renderer-spectral-octaves=<octaves=3.0> : " << endl;
+	cout << "\t the frequency of the spectral depth rendering mode rises by this many octaves" << endl;
+	cout << "\t from max distance to the camera, max distance is rendered at the base frequency" << endl;
+	cout << "--renderer-spectral-phase={random,coherent} : " << endl;
+	cout << "\t random : the frequencies of a spectral frame have random phases, a short noise" << endl;
+	cout << "\t coherent : the frequencies of a spectral frame peak at once, a click" << endl;
+	cout << "--renderer-spectral-frames=<frames=1> : " << endl;
+	cout << "\t number of spectral frames of each ping, overlapped by half of a frame" << endl;
+
+	const RendererRegistry & registry = RendererRegistry::Instance();
+	cout << "--depth-rendering-mode={";
+	for( unsigned int i=0; i<registry.get_names().size(); ++i )
+		cout << (i > 0 ? "," : "") << registry.get_names()[i];
+	cout << "} : " << endl;
+	cout << "\t Depth rendering mode or the way that the depth is converted into amplitudes. " << endl;
+	cout << "\t The following modes are possible: " << endl;
+	for( unsigned int i=0; i<registry.get_names().size(); ++i )
+	{
+		cout << "\t " << registry.get_names()[i] << ": " << endl;
+		std::stringstream ss( registry.get_description( registry.get_names()[i] ) );
+		std::string line;
+		while( std::getline( ss, line ) )
+			cout << "\t \t " << line << endl;
+	}
+	cout << "\t A comma separated list of modes renders consecutive pings with each mode in turn." << endl;
+	cout << "--renderer-schedule-rois=<roi1,roi2,...> : " << endl;
+	cout << "\t region of interest of each mode in --depth-rendering-mode," << endl;
+	cout << "\t full, top, bottom or <top>-<bottom> rows (fractions of image height, e.g. 0.5-1.0)" << endl;
+	cout << "--renderer-schedule-frequencies=<f1,f2,...> : " << endl;
+	cout << "\t base frequency of each mode in --depth-rendering-mode [Hz]" << endl;
+	cout << "\t (if left unset or negative, --renderer-base-frequency is used)" << endl;
+}
+
+// Reads the renderer parameters, returns false if some of them are invalid
+bool ParseRendererParameters( argh::parser & cmdl, RendererParameters & p )
+{
+	const std::vector<std::string> depth_rendering_mode_names =
+			PingScheduler::SplitList( cmdl("--depth-rendering-mode").str() );
+	const std::vector<std::string> schedule_roi_names =
+			PingScheduler::SplitList( cmdl("--renderer-schedule-rois").str() );
+	const std::vector<std::string> schedule_frequency_names =
+			PingScheduler::SplitList( cmdl("--renderer-schedule-frequencies").str() );
+	bool schedule_ok = depth_rendering_mode_names.size() > 0 &&
+			schedule_roi_names.size() <= depth_rendering_mode_names.size() &&
+			schedule_frequency_names.size() <= depth_rendering_mode_names.size();
+	p.depth_rendering_modes.clear();
+	p.schedule_roi_top.clear();
+	p.schedule_roi_bottom.clear();
+	p.schedule_frequencies.clear();
+	for( unsigned int i=0; i<depth_rendering_mode_names.size(); ++i )
+	{
+		p.depth_rendering_modes.push_back( depth_rendering_mode_names[i] );
+		if( RendererRegistry::Instance().Has( depth_rendering_mode_names[i] ) == false )
+		{
+			std::cerr << "Unknown depth rendering mode : " << depth_rendering_mode_names[i] << std::endl;
+			schedule_ok = false;
+		}
+		float roi_top = 0., roi_bottom = 1.;
+		if( i < schedule_roi_names.size() )
+			schedule_ok = schedule_ok && PingScheduler::ParseRoi( schedule_roi_names[i], roi_top, roi_bottom );
+		p.schedule_roi_top.push_back( roi_top );
+		p.schedule_roi_bottom.push_back( roi_bottom );
+		// a negative frequency means the base frequency
+		p.schedule_frequencies.push_back( i < schedule_frequency_names.size() ?
+				atof( schedule_frequency_names[i].c_str() ) : -1. );
+	}
+
+	const bool weight_map_ok = WeightMap::ParseTerms(
+			get_value<std::string>( cmdl, "--renderer-weight-map", "" ), p.weight_terms );
+
+	bool distance_mapping_ok;
+	p.distance_mapping_type = DistanceMapping::ParseType(
+			get_value<std::string>( cmdl, "--renderer-distance-mapping", "linear" ), distance_mapping_ok );
+	distance_mapping_ok = distance_mapping_ok && DistanceMapping::ParseKnots(
+			get_value<std::string>( cmdl, "--renderer-distance-mapping-knots", "" ),
+			p.distance_mapping_knot_distances, p.distance_mapping_knot_times );
+
+	p.max_distance = get_value(cmdl, "--renderer-max-distance", 4.0);
+	p.step_distance = get_value(cmdl, "--renderer-step-distance", 0.005);
+	p.speed_of_sound = get_value(cmdl, "--renderer-speed-of-sound", 1.0);
+	p.stereo_distance = get_value(cmdl, "--renderer-stereo-distance", 0.2);
+	p.max_delay = get_value(cmdl, "--renderer-max-delay", 0.3);
+	p.elevation_delay = get_value(cmdl, "--renderer-elevation-delay", 0.0);
+	p.base_frequency = get_value(cmdl,"--renderer-base-frequency",1000.0);
+	p.freq_doubling_length = get_value(cmdl,"--renderer-freq-doubling-length",
+			-1.0 );
+	p.base_amplitude = get_value(cmdl,"--renderer-base-amplitude",0.0) / 100.0;
+
+	p.start_frequency = get_value(cmdl,"--renderer-start-frequency",1000.0);
+	p.start_duration = get_value(cmdl,"--renderer-start-duration",
+			-1.0 );
+	p.start_amplitude = get_value(cmdl,"--renderer-start-amplitude", 50.0 ) / 100.0;
+	p.interval_extra_time = get_value(cmdl,"--renderer-interval-extra-time",0.1);
+
+	p.lower_distance = get_value(cmdl,"--renderer-lower-distance",
+			-1.0 );
+	p.lower_frequency = get_value(cmdl,"--renderer-lower-frequency",500.);
+	p.lower_frequency_doubling_length = get_value(cmdl,
+		"--renderer-lower-frequency-doubling-length",
+		-1.0 );
+	p.lower_amplitude = get_value(cmdl,
+		"--renderer-lower-amplitude",0.0)/100.;
+	p.ball_radius = get_value(cmdl,"--renderer-ball-radius",0.15);
+	p.scattering = cmdl["--renderer-scattering"];
+	p.scattering_vertical_gain = get_value(cmdl,"--renderer-scattering-vertical-gain",1.0);
+	p.scattering_horizontal_gain = get_value(cmdl,"--renderer-scattering-horizontal-gain",1.0);
+	p.floor_frequency = get_value(cmdl,"--renderer-floor-frequency",1000.0);
+	p.floor_frequency_doubling_length = get_value(cmdl,
+		"--renderer-floor-frequency-doubling-length", -1.0 );
+	p.floor_amplitude = get_value(cmdl,"--renderer-floor-amplitude",25.0)/100.;
+	p.floor_inlier_distance = get_value(cmdl,"--renderer-floor-inlier-distance",0.05);
+	p.elevation_bands = get_value(cmdl,"--renderer-elevation-bands",4);
+	p.elevation_frequency_ratio = get_value(cmdl,"--renderer-elevation-frequency-ratio",1.5);
+	p.distance_mapping_length = get_value(cmdl,"--renderer-distance-mapping-length",1.0);
+	p.min_step_distance = get_value(cmdl,"--renderer-min-step-distance",0.005);
+	p.smoothing_sigma = get_value(cmdl,"--renderer-smoothing-sigma",0.0);
+	p.azimuth_bands = get_value(cmdl,"--renderer-azimuth-bands",64);
+	p.sample_rate = get_value(cmdl,"--renderer-sample-rate",SAMPLE_RATE);
+	p.echo_pulse = get_value<std::string>(cmdl,"--renderer-echo-pulse","click");
+	p.echo_pulse_duration = get_value(cmdl,"--renderer-echo-pulse-duration",0.003);
+	p.binaural_azimuth_cells = get_value(cmdl,"--renderer-binaural-azimuth-cells",8);
+	p.binaural_elevation_cells = get_value(cmdl,"--renderer-binaural-elevation-cells",3);
+	p.hrir_file = get_value<std::string>(cmdl,"--renderer-hrir","");
+	p.sweep_columns = get_value(cmdl,"--renderer-sweep-columns",16);
+	p.sweep_octaves = get_value(cmdl,"--renderer-sweep-octaves",2.0);
+	p.spectral_frame_duration = get_value(cmdl,"--renderer-spectral-frame",0.05);
+	p.spectral_octaves = get_value(cmdl,"--renderer-spectral-octaves",3.0);
+	const std::string spectral_phase = get_value<std::string>(cmdl,"--renderer-spectral-phase","random");
+	p.spectral_coherent_phase = spectral_phase == "coherent";
+	p.spectral_frames = get_value(cmdl,"--renderer-spectral-frames",1);
+
+	p.interval_max_render_time = p.max_distance / p.speed_of_sound;
+	p.interval_total_time = p.interval_extra_time +
+			p.interval_max_render_time;
+
+	const bool values_ok = p.max_distance > 0. && p.step_distance > 0. && p.speed_of_sound > 0. &&
+			p.step_distance < p.max_distance;
+	if( values_ok == false )
+		std::cerr << "Max distance, step distance and speed of sound must be positive" << std::endl;
+	const bool echo_pulse_ok = p.echo_pulse_duration > 0. && p.echo_pulse_duration <= 1.;
+	if( echo_pulse_ok == false )
+		std::cerr << "Echo pulse duration must be between 0 and 1 s" << std::endl;
+	const bool binaural_ok = p.binaural_azimuth_cells > 0 && p.binaural_elevation_cells > 0 &&
+			p.binaural_azimuth_cells * p.binaural_elevation_cells <= 1024;
+	if( binaural_ok == false )
+		std::cerr << "There must be 1 to 1024 binaural cells" << std::endl;
+	// the delays must not move the points of the camera minimal range (20cm) past the camera
+	const bool delay_ok = p.max_delay >= 0. && p.elevation_delay >= 0. && p.max_delay + p.elevation_delay < 0.4;
+	if( delay_ok == false )
+		std::cerr << "The max and elevation delays must not be negative and their sum must be less than 0.4" << std::endl;
+
+	const bool azimuth_bands_ok = p.azimuth_bands <= 1024;
+	if( azimuth_bands_ok == false )
+		std::cerr << "There must be 0 to 1024 azimuth bands" << std::endl;
+
+	const bool sweep_ok = p.sweep_columns > 0 && p.sweep_columns <= 1024 &&
+			p.sweep_octaves >= 0. && p.sweep_octaves <= 4.;
+	if( sweep_ok == false )
+		std::cerr << "There must be 1 to 1024 sweep columns and 0 to 4 octaves" << std::endl;
+	const bool spectral_ok = p.spectral_frame_duration >= 0.005 && p.spectral_frame_duration <= 1. &&
+			p.spectral_octaves >= 0. && p.spectral_octaves <= 6. &&
+			(spectral_phase == "random" || spectral_phase == "coherent") &&
+			p.spectral_frames > 0 && p.spectral_frames <= 100;
+	if( spectral_ok == false )
+		std::cerr << "Spectral frames must last 0.005 to 1 s, rise 0 to 6 octaves, have a random or coherent phase"
+				" and there must be 1 to 100 of them" << std::endl;
+	const bool sample_rate_ok = p.sample_rate >= 8000 && p.sample_rate <= 96000;
+	if( sample_rate_ok == false )
+		std::cerr << "Sample rate must be between 8000 and 96000 Hz" << std::endl;
+
+	return schedule_ok && distance_mapping_ok && weight_map_ok && delay_ok && azimuth_bands_ok && values_ok && sample_rate_ok && echo_pulse_ok && binaural_ok && sweep_ok && spectral_ok;
+}
@@ -0,0 +1,83 @@
+/*
+ * RendererParameters.h
+ */
+
+#ifndef SRC_RENDERERPARAMETERS_H_
+#define SRC_RENDERERPARAMETERS_H_
+
+#include "DistanceMapping.h"
+#include "WeightMap.h"
+#include <vector>
+#include <string>
+
+namespace argh
+{
+class parser;
+}
+
+// Parameters of the sound rendering, these can be changed while the camera is running
+struct RendererParameters
+{
+	float max_distance;
+	float step_distance;
+	float speed_of_sound;
+	float stereo_distance;
+	float max_delay; //!< of the delay_is_angle mode at the image edge [m]
+	float elevation_delay; //!< of the delay_is_angle mode at the top or bottom image edge [m]
+	float base_frequency;
+	float freq_doubling_length;
+	float base_amplitude;
+	float start_frequency;
+	float start_duration;
+	float start_amplitude;
+	float interval_extra_time;
+	float lower_distance;
+	float lower_frequency;
+	float lower_frequency_doubling_length;
+	float lower_amplitude;
+	float ball_radius;
+	bool scattering;
+	float scattering_vertical_gain;
+	float scattering_horizontal_gain;
+	std::vector<WeightTerm> weight_terms; //!< no weight map if empty
+	float floor_frequency;
+	float floor_frequency_doubling_length;
+	float floor_amplitude;
+	float floor_inlier_distance;
+	unsigned int elevation_bands;
+	float elevation_frequency_ratio;
+	DistanceMappingType distance_mapping_type;
+	float distance_mapping_length;
+	std::vector<float> distance_mapping_knot_distances;
+	std::vector<float> distance_mapping_knot_times;
+	float min_step_distance;
+	float smoothing_sigma; //!< [distance bins]
+	unsigned int azimuth_bands; //!< of the echo image, 0 to bin the points for each channel
+	unsigned int sample_rate; //!< of the rendered sound [Hz]
+	std::string echo_pulse; //!< click, chirp or the file of a recorded pulse
+	float echo_pulse_duration; //!< [s]
+	unsigned int binaural_azimuth_cells;
+	unsigned int binaural_elevation_cells;
+	std::string hrir_file; //!< measured HRIRs, empty for a spherical head
+	unsigned int sweep_columns;
+	float sweep_octaves;
+	float spectral_frame_duration; //!< [s]
+	float spectral_octaves;
+	bool spectral_coherent_phase;
+	unsigned int spectral_frames;
+	// Consecutive pings are rendered with the listed modes in rotation
+	std::vector<std::string> depth_rendering_modes; //!< names of renderers in the RendererRegistry
+	std::vector<float> schedule_roi_top;
+	std::vector<float> schedule_roi_bottom;
+	std::vector<float> schedule_frequencies; //!< negative for the base frequency
+	float interval_max_render_time;
+	float interval_total_time;
+};
+
+// Registers the --renderer-* parameters that take a value
+void AddRendererParameters( argh::parser & cmdl );
+void PrintRendererParametersHelp();
+// Reads the renderer parameters, returns false if some of them are invalid
+bool ParseRendererParameters( argh::parser & cmdl, RendererParameters & p );
+
+#endif /* SRC_RENDERERPARAMETERS_H_ */
@@ -0,0 +1,266 @@
+/*
+ * RendererRegistry.cpp
+ */
+
+#include "RendererRegistry.h"
+#include "BallDepthRenderer.h"
+#include "FloorDepthRenderer.h"
+#include "ElevationDepthRenderer.h"
+#include "ConvolutionDepthRenderer.h"
+#include "BinauralDepthRenderer.h"
+#include "SweepDepthRenderer.h"
+#include "SpectralDepthRenderer.h"
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+
+SimpleDepthRenderer * CreateSimple( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	SimpleDepthRenderer * renderer = new SimpleDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			p.base_amplitude,
+			p.stereo_distance,
+			p.lower_distance,
+			p.lower_frequency,
+			p.lower_frequency_doubling_length,
+			p.lower_amplitude,
+			save_loudness,
+			distance_mapping
+				);
+	// only the modes that render through SimpleDepthRenderer::RenderEchoImageToSound have an echo image
+	// (simple, delay_is_angle, ball, convolution and spectral)
+	renderer->SetEchoBands( intrinsics, p.azimuth_bands );
+	return renderer;
+}
+
+SimpleDepthRenderer * CreateDelayIsAngle( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	SimpleDepthRenderer * renderer = new DelayIsAngleDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			p.base_amplitude,
+			save_loudness,
+			intrinsics,
+			p.max_delay,
+			p.elevation_delay,
+			distance_mapping
+				);
+	renderer->SetEchoBands( intrinsics, p.azimuth_bands );
+	return renderer;
+}
+
+SimpleDepthRenderer * CreateBall( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	SimpleDepthRenderer * renderer = new BallDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			p.base_amplitude,
+			p.stereo_distance,
+			p.lower_distance,
+			p.lower_frequency,
+			p.lower_frequency_doubling_length,
+			p.lower_amplitude,
+			save_loudness,
+			intrinsics,
+			p.ball_radius,
+			distance_mapping
+				);
+	renderer->SetEchoBands( intrinsics, p.azimuth_bands );
+	return renderer;
+}
+
+SimpleDepthRenderer * CreateFloor( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	return new FloorDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			p.base_amplitude,
+			p.stereo_distance,
+			save_loudness,
+			p.floor_frequency,
+			p.floor_frequency_doubling_length,
+			p.floor_amplitude,
+			p.floor_inlier_distance,
+			distance_mapping
+				);
+}
+
+SimpleDepthRenderer * CreateElevation( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	return new ElevationDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			p.base_amplitude,
+			p.stereo_distance,
+			save_loudness,
+			intrinsics,
+			p.elevation_bands,
+			p.elevation_frequency_ratio,
+			distance_mapping
+				);
+}
+
+SimpleDepthRenderer * CreateConvolution( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	SimpleDepthRenderer * renderer = new ConvolutionDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency,
+			p.stereo_distance,
+			save_loudness,
+			ConvolutionDepthRenderer::MakePulse( p.echo_pulse, base_frequency, p.echo_pulse_duration, p.sample_rate ),
+			distance_mapping
+				);
+	renderer->SetEchoBands( intrinsics, p.azimuth_bands );
+	return renderer;
+}
+
+SimpleDepthRenderer * CreateBinaural( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	HrirSet hrirs( p.sample_rate );
+	if( p.hrir_file.empty() == false )
+		hrirs.Load( p.hrir_file );
+	return new BinauralDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency, p.freq_doubling_length,
+			save_loudness,
+			intrinsics,
+			p.binaural_azimuth_cells,
+			p.binaural_elevation_cells,
+			hrirs,
+			distance_mapping
+				);
+}
+
+SimpleDepthRenderer * CreateSweep( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	return new SweepDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency,
+			save_loudness,
+			intrinsics,
+			p.sweep_columns,
+			p.sweep_octaves,
+			distance_mapping
+				);
+}
+
+SimpleDepthRenderer * CreateSpectral( const RendererParameters & p, float base_frequency,
+		const CameraIntrinsics & intrinsics, bool save_loudness, DistanceMapping * distance_mapping )
+{
+	SimpleDepthRenderer * renderer = new SpectralDepthRenderer(
+			p.max_distance, p.step_distance,
+			p.speed_of_sound, base_frequency,
+			p.stereo_distance,
+			save_loudness,
+			p.spectral_frame_duration,
+			p.spectral_octaves,
+			p.spectral_coherent_phase,
+			p.spectral_frames,
+			distance_mapping
+				);
+	renderer->SetEchoBands( intrinsics, p.azimuth_bands );
+	return renderer;
+}
+
+} // end of anonymous namespace
+
+RendererRegistry & RendererRegistry::Instance()
+{
+	static RendererRegistry registry;
+	return registry;
+}
+
+RendererRegistry::RendererRegistry()
+{
+	Register( "simple", CreateSimple,
+			"distances between each ear and all points are calculated and converted to amplitudes" );
+	Register( "delay_is_angle", CreateDelayIsAngle,
+			"the delay between signals on L and R channels that a point in space produces\n"
+			"corresponds to the horizontal angle at which the point is seen by the camera." );
+	Register( "ball", CreateBall,
+			"as simple, but the points are positions that a ball thrown from the camera can reach,\n"
+			"so that the holes in fences and other thin objects are filled." );
+	Register( "floor", CreateFloor,
+			"the floor plane is detected and tracked, floor and obstacles are rendered\n"
+			"at different frequencies and amplitudes (the lower renderer is not used)." );
+	Register( "elevation", CreateElevation,
+			"the image is split into elevation bands, each band is rendered at its own frequency\n"
+			"(the lower renderer is not used)." );
+	Register( "convolution", CreateConvolution,
+			"as simple, but each distance echoes the pulse set by --renderer-echo-pulse instead of a tone,\n"
+			"like the echoes of a click (the lower renderer is not used)." );
+	Register( "binaural", CreateBinaural,
+			"the image is split into directions, the echoes of each direction are filtered with\n"
+			"the head related impulse responses of the direction (see --renderer-hrir)\n"
+			"instead of being heard by two ears (the stereo distance and the lower renderer are not used)." );
+	Register( "sweep", CreateSweep,
+			"the image is played column by column from left to right, the nearer a column,\n"
+			"the higher its pitch (see --renderer-sweep-columns, the stereo distance,\n"
+			"the frequency doubling and the lower renderer are not used)." );
+	Register( "spectral", CreateSpectral,
+			"all distances are rendered at once as a chord of a few tens of ms, the nearer a point,\n"
+			"the higher its frequency, instead of echoes that arrive after max distance / speed of sound\n"
+			"(see --renderer-spectral-frame, the frequency doubling and the lower renderer are not used)." );
+}
+
+void RendererRegistry::Register(
+	const std::string & name,
+	RendererConstructor constructor,
+	const std::string & description
+	)
+{
+	if( entries.count(name) == 0 )
+		names.push_back(name);
+	Entry & e = entries[name];
+	e.constructor = constructor;
+	e.description = description;
+}
+
+bool RendererRegistry::Has( const std::string & name )const
+{
+	return entries.count(name) > 0;
+}
+
+SimpleDepthRenderer * RendererRegistry::Create(
+	const std::string & name,
+	const RendererParameters & p,
+	float base_frequency,
+	const CameraIntrinsics & intrinsics,
+	bool save_loudness
+	)const
+{
+	std::map<std::string,Entry>::const_iterator it = entries.find(name);
+	if( it == entries.end() )
+	{
+		cerr << "Unknown depth rendering mode : " << name << endl;
+		return NULL;
+	}
+	DistanceMapping * distance_mapping = new DistanceMapping(
+		p.distance_mapping_type, p.max_distance, p.step_distance,
+		p.max_distance / p.speed_of_sound,
+		p.min_step_distance, p.distance_mapping_length,
+		p.distance_mapping_knot_distances, p.distance_mapping_knot_times,
+		p.sample_rate );
+	SimpleDepthRenderer * renderer = it->second.constructor( p, base_frequency, intrinsics, save_loudness, distance_mapping );
+	renderer->SetSmoothing( p.smoothing_sigma );
+	return renderer;
+}
+
+const std::string & RendererRegistry::get_description( const std::string & name )const
+{
+	static const std::string unknown;
+	std::map<std::string,Entry>::const_iterator it = entries.find(name);
+	return it != entries.end() ? it->second.description : unknown;
+}
@@ -0,0 +1,63 @@
+/*
+ * RendererRegistry.h
+ */
+
+#ifndef SRC_RENDERERREGISTRY_H_
+#define SRC_RENDERERREGISTRY_H_
+
+#include "SoundRenderer.h"
+#include "RendererParameters.h"
+#include "PointCloud.h"
+#include <map>
+#include <vector>
+#include <string>
+
+// Constructs a renderer, the renderer takes ownership of the distance mapping
+typedef SimpleDepthRenderer * (*RendererConstructor)(
+		const RendererParameters & parameters,
+		float base_frequency, //!< overrides parameters.base_frequency
+		const CameraIntrinsics & intrinsics,
+		bool save_loudness,
+		DistanceMapping * distance_mapping
+		);
+
+/* This class maps the names of depth rendering modes to renderer constructors.
+ * The built-in renderers are registered when the registry is first used,
+ * other renderers can be added with Register.
+ */
+class RendererRegistry
+{
+public:
+	// The registry with the built-in renderers
+	static RendererRegistry & Instance();
+	// Adds a renderer, a renderer with the same name is replaced
+	void Register(
+		const std::string & name,
+		RendererConstructor constructor,
+		const std::string & description //!< help text, one line per element
+		);
+	bool Has( const std::string & name )const;
+	// Constructs the named renderer with the distance mapping given by the parameters, NULL if the name is unknown
+	SimpleDepthRenderer * Create(
+		const std::string & name,
+		const RendererParameters & parameters,
+		float base_frequency,
+		const CameraIntrinsics & intrinsics,
+		bool save_loudness
+		)const;
+	// Names in the order of registration
+	const std::vector<std::string> & get_names()const
+	{ return names; }
+	const std::string & get_description( const std::string & name )const;
+private:
+	RendererRegistry();
+	struct Entry
+	{
+		RendererConstructor constructor;
+		std::string description;
+	};
+	std::map<std::string,Entry> entries;
+	std::vector<std::string> names;
+};
+
+#endif /* SRC_RENDERERREGISTRY_H_ */
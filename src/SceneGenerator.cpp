@@ -0,0 +1,295 @@
+/*
+ * SceneGenerator.cpp
+ */
+
+#include "SceneGenerator.h"
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+const float INF = 1e30; //!< no hit, also stands in for 1/0
+const char * scene_type_names[] = { "corridor", "room", "poles", "steps", "pedestrians" };
+const unsigned int n_scene_types = sizeof(scene_type_names)/sizeof(scene_type_names[0]);
+
+// Uniform in [a,b), from the raw generator output so that the scenes are the same with every standard library
+float Uniform( std::minstd_rand & rng, float a, float b )
+{
+	return a + (b-a) * (float)(rng() - rng.min()) / (float)(rng.max() - rng.min() + 1.);
+}
+}
+
+SceneGenerator::SceneGenerator(
+		SceneType type,
+		const CameraIntrinsics & intrinsics,
+		float camera_height,
+		unsigned int seed
+		)
+	:type(type),
+	 intrinsics(intrinsics),
+	 camera_height(camera_height),
+	 depth_units(0.001),
+	 max_range(10.),
+	 ray_x(intrinsics.width),
+	 inv_ray_x(intrinsics.width),
+	 ray_y(intrinsics.height),
+	 exact_depth(intrinsics.width*intrinsics.height, 0.f)
+{
+	for( int u=0; u<intrinsics.width; ++u )
+	{
+		ray_x[u] = (u - intrinsics.ppx) / intrinsics.fx;
+		inv_ray_x[u] = ray_x[u] != 0. ? 1./ray_x[u] : INF;
+	}
+	for( int v=0; v<intrinsics.height; ++v )
+		ray_y[v] = (v - intrinsics.ppy) / intrinsics.fy;
+
+	std::minstd_rand rng( seed );
+	const float h = camera_height;
+	switch( type )
+	{
+	case SceneCorridor:
+		AddCorridor( 1.0, 2.5, 8.0 );
+		break;
+	case SceneRoom:
+		AddCorridor( 2.5, 2.6, 4.0 );
+		AddBox( 1.4, h-1.9, 2.2, 2.5, h, 2.8 ); // cabinet
+		AddBox( -1.2, h-0.75, 1.5, -0.2, h-0.7, 2.3 ); // table top
+		for( int i=0; i<4; ++i ) // table legs
+			AddCylinder( i%2 ? -0.25 : -1.15, i/2 ? 2.25 : 1.55, 0., 0., 0., 0., 0.025, 0.7 );
+		break;
+	case ScenePoles:
+		AddFloor();
+		AddBox( -10., h-3., 6.0, 10., h, 6.1 ); // wall behind the poles
+		for( int i=0; i<8; ++i )
+		{
+			const float x = Uniform( rng, -2., 2. );
+			const float z = Uniform( rng, 1., 5. );
+			AddCylinder( x, z, x, z, 0., 0., Uniform( rng, 0.02, 0.08 ), 2.5 );
+		}
+		AddCylinder( -0.8, 1.5, 0.8, 1.5, 8., 0., 0.05, 2.5 ); // pole moving from side to side
+		break;
+	case SceneSteps:
+		AddCorridor( 1.0, 3.5, 8.0 );
+		for( int k=0; k<6; ++k )
+			AddBox( -1.0, h-0.17*(k+1), 2.0+0.3*k, 1.0, h, 5.8 );
+		break;
+	case ScenePedestrians:
+		AddCorridor( 1.5, 2.5, 10.0 );
+		for( int i=0; i<3; ++i )
+		{
+			const float x = Uniform( rng, -1., 1. );
+			AddCylinder( x, 1.0, x, 8.0, Uniform( rng, 8., 14. ), Uniform( rng, 0., 1. ), 0.25, 1.75 );
+		}
+		break;
+	}
+	cout << "Scene " << scene_type_names[type] << " with " << boxes.size() << " boxes and ";
+	cout << cylinders.size() << " cylinders, " << intrinsics.width << "x" << intrinsics.height << endl;
+}
+
+SceneType SceneGenerator::ParseType( const std::string & name, bool & ok )
+{
+	ok = true;
+	for( unsigned int i=0; i<n_scene_types; ++i )
+		if( name == scene_type_names[i] )
+			return (SceneType)i;
+	cerr << "Unknown scene : " << name << endl;
+	ok = false;
+	return SceneCorridor;
+}
+
+const char * SceneGenerator::get_type_names()
+{
+	return "corridor,room,poles,steps,pedestrians";
+}
+
+CameraIntrinsics SceneGenerator::MakeIntrinsics( int width, int height, float horizontal_fov )
+{
+	CameraIntrinsics c;
+	c.width = width;
+	c.height = height;
+	c.ppx = 0.5*width;
+	c.ppy = 0.5*height;
+	c.fx = 0.5*width / tan( 0.5*horizontal_fov );
+	c.fy = c.fx;
+	return c;
+}
+
+void SceneGenerator::AddBox( float x0, float y0, float z0, float x1, float y1, float z1 )
+{
+	Box b = { min(x0,x1), min(y0,y1), min(z0,z1), max(x0,x1), max(y0,y1), max(z0,z1) };
+	boxes.push_back( b );
+}
+
+void SceneGenerator::AddCylinder( float x0, float z0, float x1, float z1, float period, float phase,
+		float radius, float height )
+{
+	// a cylinder that stands still is given by its first point
+	Cylinder c = { x0, z0, period > 0. ? x1 : x0, period > 0. ? z1 : z0, period, phase,
+			radius, camera_height-height, camera_height };
+	cylinders.push_back( c );
+}
+
+void SceneGenerator::AddFloor()
+{
+	AddBox( -50., camera_height, 0.01, 50., camera_height+0.1, 50. );
+}
+
+void SceneGenerator::AddCorridor( float half_width, float height, float length )
+{
+	const float h = camera_height;
+	AddFloor();
+	AddBox( -half_width, h-height-0.1, 0.01, half_width, h-height, length ); // ceiling
+	AddBox( -half_width-0.1, h-height, 0.01, -half_width, h, length ); // walls
+	AddBox( half_width, h-height, 0.01, half_width+0.1, h, length );
+	AddBox( -half_width, h-height, length, half_width, h, length+0.1 ); // end wall
+}
+
+void SceneGenerator::RenderDepth( float time, uint16_t * depth )
+{
+	const int w = intrinsics.width;
+	const int h = intrinsics.height;
+	const unsigned int n_cylinders = cylinders.size();
+	std::vector<float> cx( n_cylinders ), cz( n_cylinders );
+	for( unsigned int i=0; i<n_cylinders; ++i )
+	{
+		const Cylinder & c = cylinders[i];
+		float s = 0.;
+		if( c.period > 0. )
+		{
+			s = time / c.period + c.phase;
+			s -= floor( s );
+			s = s < 0.5 ? 2*s : 2-2*s;
+		}
+		cx[i] = c.x0 + s*(c.x1 - c.x0);
+		cz[i] = c.z0 + s*(c.z1 - c.z0);
+	}
+
+#pragma omp parallel
+	{
+		std::vector<float> t_row( w );
+#pragma omp for
+		for( int v=0; v<h; ++v )
+		{
+			// the ray through pixel (u,v) is (ray_x[u],ry,1)*t, so t is the depth
+			float * t = &t_row[0];
+			const float * rx = &ray_x[0];
+			const float * irx = &inv_ray_x[0];
+			const float ry = ray_y[v];
+			const float iry = ry != 0. ? 1./ry : INF;
+#pragma omp simd
+			for( int u=0; u<w; ++u )
+				t[u] = INF;
+
+			// slab test, the y and z slabs are the same for the whole row
+			for( unsigned int i=0; i<boxes.size(); ++i )
+			{
+				const Box & b = boxes[i];
+				const float ty0 = b.y0*iry;
+				const float ty1 = b.y1*iry;
+				const float t_near_yz = max( min(ty0,ty1), b.z0 );
+				const float t_far_yz = min( max(ty0,ty1), b.z1 );
+#pragma omp simd
+				for( int u=0; u<w; ++u )
+				{
+					const float tx0 = b.x0*irx[u];
+					const float tx1 = b.x1*irx[u];
+					const float t_near = max( min(tx0,tx1), t_near_yz );
+					const float t_far = min( max(tx0,tx1), t_far_yz );
+					const bool hit = t_near <= t_far && t_near > 0.f && t_near < t[u];
+					t[u] = hit ? t_near : t[u];
+				}
+			}
+
+			// (t*rx - cx)^2 + (t - cz)^2 = radius^2, the nearer root
+			for( unsigned int i=0; i<n_cylinders; ++i )
+			{
+				const Cylinder & c = cylinders[i];
+				const float x = cx[i];
+				const float z = cz[i];
+				const float k = x*x + z*z - c.radius*c.radius;
+#pragma omp simd
+				for( int u=0; u<w; ++u )
+				{
+					const float a = rx[u]*rx[u] + 1.f;
+					const float b = rx[u]*x + z;
+					const float d = b*b - a*k;
+					const float tc = ( b - sqrt( max(d,0.f) ) ) / a;
+					const float y = tc*ry;
+					const bool hit = d >= 0.f && tc > 0.f && y >= c.y_top && y <= c.y_bottom && tc < t[u];
+					t[u] = hit ? tc : t[u];
+				}
+			}
+
+			uint16_t * depth_row = &depth[v*w];
+			float * exact_row = &exact_depth[v*w];
+			const float inv_depth_units = 1./depth_units;
+#pragma omp simd
+			for( int u=0; u<w; ++u )
+			{
+				const bool seen = t[u] < max_range;
+				exact_row[u] = seen ? t[u] : 0.f;
+				depth_row[u] = seen ? (uint16_t)( t[u]*inv_depth_units + 0.5f ) : 0;
+			}
+		}
+	}
+}
+
+void SceneGenerator::DeprojectDepth( const uint16_t * depth, Vertex * vertices )const
+{
+	const int w = intrinsics.width;
+	const int h = intrinsics.height;
+#pragma omp parallel for
+	for( int v=0; v<h; ++v )
+	{
+		const uint16_t * depth_row = &depth[v*w];
+		Vertex * out_row = &vertices[v*w];
+		const float ry = ray_y[v];
+		for( int u=0; u<w; ++u )
+		{
+			const float z = depth_row[u]*depth_units;
+			out_row[u].x = ray_x[u]*z;
+			out_row[u].y = ry*z;
+			out_row[u].z = z;
+		}
+	}
+}
+
+void SceneGenerator::GroundTruthCounts(
+		float x, float y, float z,
+		const DistanceMapping & mapping,
+		unsigned int * counts
+		)const
+{
+	const int w = intrinsics.width;
+	const int h = intrinsics.height;
+	const unsigned int n_bins = mapping.n_bins;
+	for( unsigned int i=0; i<n_bins; ++i )
+		counts[i] = 0;
+#pragma omp parallel
+	{
+		std::vector<unsigned int> my_counts( n_bins, 0 );
+#pragma omp for
+		for( int v=0; v<h; ++v )
+		{
+			for( int u=0; u<w; ++u )
+			{
+				const double t = exact_depth[v*w+u];
+				if( t <= 0. )
+					continue;
+				const double dx = ray_x[u]*t - x;
+				const double dy = ray_y[v]*t - y;
+				const double dz = t - z;
+				const unsigned int i_bin = mapping.BinOf( sqrt(dx*dx+dy*dy+dz*dz) );
+				if( i_bin < n_bins )
+					++my_counts[i_bin];
+			}
+		}
+#pragma omp critical
+		for( unsigned int i=0; i<n_bins; ++i )
+			counts[i] += my_counts[i];
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * SceneGenerator.h
+ */
+
+#ifndef SRC_SCENEGENERATOR_H_
+#define SRC_SCENEGENERATOR_H_
+
+#include "PointCloud.h"
+#include "DistanceMapping.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum SceneType {
+	SceneCorridor = 0, //!< floor, ceiling, side walls and an end wall
+	SceneRoom = 1, //!< walls around the camera and a cabinet
+	ScenePoles = 2, //!< thin poles scattered in front of the camera
+	SceneSteps = 3, //!< stairs going up in front of the camera
+	ScenePedestrians = 4 //!< corridor with people walking towards and away from the camera
+};
+
+/* This class generates depth images of parametric scenes without a camera,
+ * for load testing and for checking the renderers against known distances.
+ *
+ * The scenes are made of axis aligned boxes and vertical cylinders
+ * (poles and pedestrians, which can move back and forth along a line).
+ * Every pixel is ray cast against all primitives, rows are rendered in parallel
+ * and the primitives are tested against a whole row at once, without branches.
+ * Coordinates are those of the camera: x to the right, y down, z forward [m].
+ */
+class SceneGenerator
+{
+public:
+	SceneGenerator(
+			SceneType type,
+			const CameraIntrinsics & intrinsics,
+			float camera_height = 1.2, //!< [m] above the floor
+			unsigned int seed = 1 //!< placement of the poles and pedestrians
+			);
+	static SceneType ParseType( const std::string & name, bool & ok );
+	static const char * get_type_names(); //!< for the help text
+	// Intrinsics of an ideal pinhole camera with the principal point in the image center
+	static CameraIntrinsics MakeIntrinsics( int width, int height, float horizontal_fov );
+
+	// Ray casts the scene at time [s] into a Z16 depth image, 0 where nothing is hit within max_range
+	void RenderDepth( float time, uint16_t * depth );
+	// Converts the depth image to vertices, as the camera SDK does without lens distortion
+	void DeprojectDepth( const uint16_t * depth, Vertex * vertices )const;
+	/* Counts the exact (not quantized) distances of the points of the last RenderDepth
+	 * from the point (x,y,z) in the bins of the mapping, counts has mapping.n_bins elements.
+	 * This is the histogram that a renderer listening at (x,y,z) should find.
+	 */
+	void GroundTruthCounts(
+			float x, float y, float z,
+			const DistanceMapping & mapping,
+			unsigned int * counts
+			)const;
+
+	const SceneType type;
+	const CameraIntrinsics intrinsics;
+	const float camera_height;
+	const float depth_units; //!< [m] per Z16 unit
+	const float max_range; //!< [m], farther surfaces are not seen
+private:
+	struct Box
+	{
+		float x0, y0, z0; //!< near corner
+		float x1, y1, z1; //!< far corner
+	};
+	struct Cylinder
+	{
+		float x0, z0; //!< one end of the path of the axis
+		float x1, z1; //!< other end of the path
+		float period; //!< [s] of moving there and back, non-positive for standing still
+		float phase; //!< [fraction of period]
+		float radius;
+		float y_top;
+		float y_bottom;
+	};
+	void AddBox( float x0, float y0, float z0, float x1, float y1, float z1 );
+	void AddCylinder( float x0, float z0, float x1, float z1, float period, float phase,
+			float radius, float height );
+	void AddFloor();
+	void AddCorridor( float half_width, float height, float length );
+
+	std::vector<Box> boxes;
+	std::vector<Cylinder> cylinders;
+	std::vector<float> ray_x; //!< x/z of the ray through each column
+	std::vector<float> inv_ray_x; //!< z/x, large where x/z is zero
+	std::vector<float> ray_y; //!< y/z of the ray through each row
+	std::vector<float> exact_depth; //!< z of the last RenderDepth, 0 where nothing is hit
+};
+
+#endif /* SRC_SCENEGENERATOR_H_ */
@@ -1,4 +1,5 @@
 #include "SoundController.h"
+#include "StreamRenderer.h"
 #include "Defaults.h"
 
 #include "audio.h"
@@ -13,19 +14,63 @@ using namespace std;
 // TODO: make sound controller behave as a singleton
 
 SoundController::SoundController(
+		unsigned int sample_rate,
 		unsigned int max_start_sound_samples,
 		unsigned int max_render_sound_samples
 	)
-	:max_start_sound_samples(max_start_sound_samples),
-	 max_render_sound_samples(max_render_sound_samples)
+	:sample_rate(sample_rate),
+	 max_start_sound_samples(max_start_sound_samples),
+	 max_render_sound_samples(max_render_sound_samples),
+	 stream(NULL),
+	 stream_device(0)
 {
 	SDL_Init(SDL_INIT_AUDIO);
-	initAudio();
+	initAudioAtFrequency(sample_rate);
 	start_audio = AllocateMemoryForAudio(max_start_sound_samples);
 	render_audio = AllocateMemoryForAudio(max_render_sound_samples);
 }
 
+SoundController::SoundController(
+		unsigned int sample_rate,
+		StreamRenderer * stream,
+		unsigned int stream_block_n
+	)
+	:sample_rate(sample_rate),
+	 max_start_sound_samples(0),
+	 max_render_sound_samples(0),
+	 start_audio(NULL),
+	 render_audio(NULL),
+	 stream(stream),
+	 stream_device(0)
+{
+	SDL_Init(SDL_INIT_AUDIO);
+	SDL_AudioSpec want;
+	SDL_memset( &want, 0, sizeof(want) );
+	want.freq = sample_rate;
+	want.format = AUDIO_S16SYS;
+	want.channels = 2;
+	want.samples = stream_block_n;
+	want.callback = StreamCallback;
+	want.userdata = this;
+	// the stream renders exactly this format, SDL converts if the device differs
+	stream_device = SDL_OpenAudioDevice( NULL, 0, &want, NULL, 0 );
+	if( stream_device == 0 )
+	{
+		cerr << "Failed to open the audio device for streaming: " << SDL_GetError() << endl;
+		return;
+	}
+	cout << "Streaming in blocks of " << stream_block_n << " samples" << endl;
+	SDL_PauseAudioDevice( stream_device, 0 );
+}
+
 SoundController::~SoundController() {
+	if( stream != NULL )
+	{
+		if( stream_device != 0 )
+			SDL_CloseAudioDevice( stream_device );
+		SDL_Quit();
+		return;
+	}
 	delete [] start_audio->bufferTrue;
 	start_audio->bufferTrue = NULL;
 	delete [] render_audio->bufferTrue;
@@ -49,7 +94,7 @@ void SoundController::PlaySound(
 		std::chrono::duration_cast<std::chrono::microseconds>(
 			render_start - sound_start );
 	const unsigned int skip_samples = compensate_delay_from_start \
-		? SAMPLE_RATE * skip_microseconds.count() / 1000000ul \
+		? sample_rate * skip_microseconds.count() / 1000000ul \
 		: 0 ;
 
 	if( skip_samples < n_samples )
@@ -75,6 +120,12 @@ void SoundController::PlayStartNow(
 	playSoundFromMemory( start_audio, SDL_MIX_MAXVOLUME );
 }
 
+void SoundController::StreamCallback( void * userdata, uint8_t * buffer, int len )
+{
+	SoundController * sc = (SoundController *)userdata;
+	sc->stream->RenderBlock( (audio_t *)buffer, len / (2*sizeof(audio_t)) );
+}
+
 Audio * SoundController::AllocateMemoryForAudio( unsigned int max_samples ){
 	/*
 Audio (0x21c9ba0
@@ -101,7 +152,7 @@ Audio spec (0x21c9bc0)
 	Audio * a = new Audio;
 	SDL_AudioSpec & as = a->audio;
 	as.format = AUDIO_S16SYS;
-	as.freq = SAMPLE_RATE;
+	as.freq = sample_rate;
 	as.channels = 2;
 	as.silence = 0;
 	as.samples = 4096;
@@ -7,13 +7,23 @@
 #include "Defaults.h"
 #include "audio.h"
 
+class StreamRenderer;
+
 class SoundController
 {
 public:
 	SoundController(
+		unsigned int sample_rate = SAMPLE_RATE, //!< [Hz], the sounds must be rendered at this rate
 		unsigned int max_start_sound_samples = SAMPLE_RATE * 10,
 		unsigned int max_render_sound_samples = SAMPLE_RATE * 20
 			);
+	// Plays the continuous sound of a stream renderer, which renders the blocks in the audio callback,
+	// instead of the sounds given to PlaySound and PlayStartNow
+	SoundController(
+		unsigned int sample_rate,
+		StreamRenderer * stream, //!< not owned, outlives the controller
+		unsigned int stream_block_n //!< samples per channel of each block
+			);
 	~SoundController();
 	void PlaySound(
 		std::chrono::time_point<std::chrono::high_resolution_clock> frame_ts,
@@ -25,13 +35,17 @@ public:
 		unsigned int n_samples,
 		audio_t signal[]
 			);
+	const unsigned int sample_rate;
 	const unsigned int max_start_sound_samples;
 	const unsigned int max_render_sound_samples;
 private:
 	Audio * AllocateMemoryForAudio( unsigned int max_size );
+	static void StreamCallback( void * userdata, uint8_t * buffer, int len );
 	std::chrono::time_point<std::chrono::high_resolution_clock> sound_start;
 	Audio * start_audio;
 	Audio * render_audio;
+	StreamRenderer * stream;
+	SDL_AudioDeviceID stream_device;
 };
 
 
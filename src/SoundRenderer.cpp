@@ -3,6 +3,9 @@
  */
 
 #include "SoundRenderer.h"
+#include "SurfaceNormals.h"
+#include "FixedPoint.h"
+#include "RenderPlan.h"
 #include <cmath>
 #if defined _OPENMP
 #include <omp.h>
@@ -12,6 +15,8 @@
 #include <iomanip>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <vector>
 using namespace std;
 
 // equal loudness data for 60 phons
@@ -53,10 +58,283 @@ const float equal_loudness_data[equal_loudness_N][2] = {
 	{ 20000, 104.92 }
 };
 
+namespace
+{
+// Sine of one period in Q15, the first value is repeated at the end for the interpolation
+std::vector<int16_t> MakeSinTableQ15()
+{
+	const unsigned int n = 1 << q15_sin_bits;
+	std::vector<int16_t> table( n+1 );
+	for( unsigned int i=0; i<=n; ++i )
+		table[i] = (int16_t)floor( (q15_one-1) * sin( 2*M_PI*i/n ) + 0.5 );
+	return table;
+}
+
+// Amplitude (fraction of max amplitude) of a loudness in [0,1], in Q15
+std::vector<int16_t> MakeLoudnessToAmplitudeTableQ15()
+{
+	const unsigned int n = 1 << q15_loudness_bits;
+	const double kL = log(10.) / (2.*log(2.));
+	std::vector<int16_t> table( n+1 );
+	for( unsigned int i=0; i<=n; ++i )
+		table[i] = (int16_t)floor( (q15_one-1) * pow( (double)i/n, kL ) + 0.5 );
+	return table;
+}
+
+// Arguments of RenderAmplitudesToFrequencyWithTimeTable, passed on to its kernels
+struct StepSynthesis
+{
+	const unsigned int * loudness_values;
+	unsigned int loudness_n_steps;
+	unsigned int loudness_max_expected_value;
+	const float * loudness_scale;
+	const unsigned int * step_sample_edges;
+	audio_t * sound_values;
+	unsigned int sound_n_samples;
+	unsigned int sound_channel;
+	float base_frequency;
+	audio_t max_amplitude;
+	float frequency_doubling_time;
+	float background_amplitude;
+	float * amplitude_values;
+	unsigned int sample_rate;
+};
+
+// One kernel of RenderAmplitudesToFrequencyWithTimeTable for each combination of its flags,
+// so that the per-sample loops have neither branches nor indirect calls
+template< bool set_not_add, bool is_chirp, bool save_amplitudes, bool has_background >
+void SynthesizeSteps( const StepSynthesis & s )
+{
+	// phase [periods] of a chirp at time t is chirp_cycles * ( exp( chirp_rate * t ) - 1 )
+	const double chirp_rate = is_chirp ? log(2.) / s.frequency_doubling_time : 0.;
+	const double chirp_cycles = is_chirp ? s.base_frequency / chirp_rate : 0.;
+	const unsigned int channel = s.sound_channel;
+	audio_t * const sound_values = s.sound_values;
+
+	// Correction for exponential perception of loudness
+	// "A widely used "rule of thumb" for the loudness of a particular sound is
+	// that the sound must be increased in intensity by a factor of ten
+	// for the sound to be perceived as twice as loud."
+	// (http://hyperphysics.phy-astr.gsu.edu/hbase/Sound/loud.html#c2)
+	const float kL = log(10.) / (2.*log(2.));
+	const float kA0L0 = s.max_amplitude / pow(1.0,kL);
+
+#pragma omp parallel for default(shared)
+	for( unsigned int i=0; i<s.loudness_n_steps; i++ )
+	{
+		// find the time interval that we will set in the sample
+		const unsigned int sound_j0 = s.step_sample_edges[i];
+		const unsigned int sound_j1_from_amplitudes = s.step_sample_edges[i+1];
+		const unsigned int sound_j1 = sound_j1_from_amplitudes < s.sound_n_samples ? sound_j1_from_amplitudes : s.sound_n_samples;
+
+		// This factor corrects amplitudes to equalize loudness for changing frequencies
+		float correction_of_amplitudes_for_changing_frequency = 1.0;
+		if( is_chirp )
+		{
+			const float avg_t = 0.5 * (sound_j0 + sound_j1_from_amplitudes) / s.sample_rate;
+			correction_of_amplitudes_for_changing_frequency =
+					SoundRenderer::EqualLoudnessCorrection( s.base_frequency * exp( chirp_rate * avg_t ) );
+		}
+
+		// calculate this loudness (as a fraction in expected range 0 <---> L0=1.0)
+		const float loudness_scale_i = s.loudness_scale != NULL ? s.loudness_scale[i] : 1.0;
+		float this_loudness = loudness_scale_i * s.loudness_values[i] / s.loudness_max_expected_value;
+		if( has_background )
+			this_loudness += s.background_amplitude;
+
+		const float this_amplitude_f = correction_of_amplitudes_for_changing_frequency * kA0L0 * pow(this_loudness,kL);
+		const audio_t this_amplitude = this_amplitude_f < s.max_amplitude ? this_amplitude_f : s.max_amplitude;
+
+		if( save_amplitudes )
+			s.amplitude_values[2*i+channel] = ((float)this_amplitude) / s.max_amplitude;
+
+		// empty bins need no synthesis
+		if( this_amplitude == 0 )
+		{
+			if( set_not_add )
+			{
+				for( unsigned int j=sound_j0; j<sound_j1; j++ )
+					sound_values[2*j+channel] = 0;
+			}
+			continue;
+		}
+
+		for( unsigned int j=sound_j0; j<sound_j1; j++ )
+		{
+			const float t = j / (float)s.sample_rate;
+			const float phase = is_chirp ? chirp_cycles * ( exp( chirp_rate * t ) - 1. ) : s.base_frequency * t;
+			const double sample = this_amplitude * sin( 2*M_PI*phase );
+			if( set_not_add )
+				sound_values[2*j+channel] = sample;
+			else
+				sound_values[2*j+channel] = sample + sound_values[2*j+channel];
+		}
+	}
+}
+
+typedef void (*StepSynthesisKernel)( const StepSynthesis & s );
+
+// indexed by set_not_add + 2*is_chirp + 4*save_amplitudes + 8*has_background
+const StepSynthesisKernel step_synthesis_kernels[16] = {
+	SynthesizeSteps<false,false,false,false>, SynthesizeSteps<true,false,false,false>,
+	SynthesizeSteps<false,true,false,false>, SynthesizeSteps<true,true,false,false>,
+	SynthesizeSteps<false,false,true,false>, SynthesizeSteps<true,false,true,false>,
+	SynthesizeSteps<false,true,true,false>, SynthesizeSteps<true,true,true,false>,
+	SynthesizeSteps<false,false,false,true>, SynthesizeSteps<true,false,false,true>,
+	SynthesizeSteps<false,true,false,true>, SynthesizeSteps<true,true,false,true>,
+	SynthesizeSteps<false,false,true,true>, SynthesizeSteps<true,false,true,true>,
+	SynthesizeSteps<false,true,true,true>, SynthesizeSteps<true,true,true,true>
+};
+
+// Amplitude of a step of a plan, never above max_amplitude
+inline float PlanStepAmplitude(
+		const RenderPlan & plan,
+		const unsigned int i,
+		const unsigned int loudness_value,
+		const float inv_max_expected,
+		const float loudness_scale[],
+		const audio_t max_amplitude,
+		const float background_amplitude )
+{
+	const float loudness_scale_i = loudness_scale != NULL ? loudness_scale[i] : 1.0;
+	const float this_loudness = loudness_scale_i * loudness_value * inv_max_expected + background_amplitude;
+	const float this_amplitude_f = max_amplitude * plan.get_loudness_correction()[i] * RenderPlan::AmplitudeOfLoudness( this_loudness );
+	return this_amplitude_f < max_amplitude ? this_amplitude_f : max_amplitude;
+}
+
+// Kernel of RenderAmplitudesWithPlan for each combination of its flags.
+// Most bins are usually empty, so the amplitudes are computed first
+// and runs of silent bins are zeroed (or skipped when adding) without synthesis
+template< bool set_not_add, bool save_amplitudes >
+void SynthesizeStepsWithPlan(
+		const RenderPlan & plan,
+		const unsigned int loudness_values[],
+		const unsigned int loudness_max_expected_value,
+		const float loudness_scale[],
+		float sound_values[],
+		const unsigned int channel,
+		const audio_t max_amplitude,
+		const float background_amplitude,
+		float * amplitude_values )
+{
+	const unsigned int * sample_edges = plan.get_sample_edges();
+	const float * carrier = plan.get_carrier();
+	const float inv_max_expected = 1.f / loudness_max_expected_value;
+	const unsigned int n_bins = plan.n_bins;
+
+	// occupancy pass
+	float * amplitudes = plan.get_step_amplitudes();
+#pragma omp parallel for default(shared)
+	for( unsigned int i=0; i<n_bins; i++ )
+	{
+		amplitudes[i] = PlanStepAmplitude( plan, i, loudness_values[i], inv_max_expected, loudness_scale,
+				max_amplitude, background_amplitude );
+		if( save_amplitudes )
+			amplitude_values[2*i+channel] = amplitudes[i] / max_amplitude;
+	}
+
+	// spans are single occupied bins or runs of silent bins
+	unsigned int * span_starts = plan.get_span_starts();
+	int n_spans = 0;
+	for( unsigned int i=0; i<n_bins; i++ )
+		if( i == 0 || amplitudes[i] != 0.f || amplitudes[i-1] != 0.f )
+			span_starts[n_spans++] = i;
+	span_starts[n_spans] = n_bins;
+
+#pragma omp parallel for default(shared) schedule(dynamic,8)
+	for( int k=0; k<n_spans; k++ )
+	{
+		const unsigned int i = span_starts[k];
+		const float this_amplitude = amplitudes[i];
+		const unsigned int j0 = sample_edges[i];
+		const unsigned int j1 = sample_edges[span_starts[k+1]];
+		if( this_amplitude == 0.f )
+		{
+			if( set_not_add )
+				memset( &sound_values[j0], 0, (j1-j0)*sizeof(float) );
+			continue;
+		}
+		for( unsigned int j=j0; j<j1; j++ )
+		{
+			if( set_not_add )
+				sound_values[j] = this_amplitude * carrier[j];
+			else
+				sound_values[j] += this_amplitude * carrier[j];
+		}
+	}
+
+	// the sound after the last bin is silent
+	if( set_not_add )
+		memset( &sound_values[sample_edges[n_bins]], 0, (plan.sound_n_samples-sample_edges[n_bins])*sizeof(float) );
+}
+}
 
 namespace SoundRenderer
 {
 
+float EqualLoudnessCorrection( const float frequency )
+{
+	// sound pressure level of the frequency at the same loudness, interpolated in the equal loudness data
+	const float f = frequency < equal_loudness_data[0][0] ? equal_loudness_data[0][0] :
+			( frequency > equal_loudness_data[equal_loudness_N-1][0] ? equal_loudness_data[equal_loudness_N-1][0] : frequency );
+	unsigned int i_freq = 0;
+	while( (i_freq < equal_loudness_N-2) && (equal_loudness_data[i_freq+1][0] < f) )
+		i_freq++;
+	const float k = (f - equal_loudness_data[i_freq][0]) / (equal_loudness_data[i_freq+1][0] - equal_loudness_data[i_freq][0]);
+	const float level = equal_loudness_data[i_freq][1]*(1.f-k) + equal_loudness_data[i_freq+1][1]*k;
+	return pow( 10., (level - equal_loudness_nominal) / 20. );
+}
+
+void RenderAmplitudesWithPlan(
+		const RenderPlan & plan,
+		const unsigned int loudness_values[],
+		const unsigned int loudness_max_expected_value,
+		const float loudness_scale[],
+		float sound_values[],
+		const unsigned int sound_channel,
+		const audio_t max_amplitude,
+		bool set_not_add,
+		const float background_amplitude,
+		float * amplitude_values
+		)
+{
+	if( set_not_add )
+	{
+		if( amplitude_values != NULL )
+			SynthesizeStepsWithPlan<true,true>( plan, loudness_values, loudness_max_expected_value, loudness_scale,
+					sound_values, sound_channel, max_amplitude, background_amplitude, amplitude_values );
+		else
+			SynthesizeStepsWithPlan<true,false>( plan, loudness_values, loudness_max_expected_value, loudness_scale,
+					sound_values, sound_channel, max_amplitude, background_amplitude, amplitude_values );
+	}
+	else
+	{
+		if( amplitude_values != NULL )
+			SynthesizeStepsWithPlan<false,true>( plan, loudness_values, loudness_max_expected_value, loudness_scale,
+					sound_values, sound_channel, max_amplitude, background_amplitude, amplitude_values );
+		else
+			SynthesizeStepsWithPlan<false,false>( plan, loudness_values, loudness_max_expected_value, loudness_scale,
+					sound_values, sound_channel, max_amplitude, background_amplitude, amplitude_values );
+	}
+}
+
+void ComputeAmplitudesWithPlan(
+		const RenderPlan & plan,
+		const unsigned int loudness_values[],
+		const unsigned int loudness_max_expected_value,
+		const float loudness_scale[],
+		const unsigned int sound_channel,
+		const audio_t max_amplitude,
+		const float background_amplitude,
+		float * amplitude_values
+		)
+{
+	const float inv_max_expected = 1.f / loudness_max_expected_value;
+	for( unsigned int i=0; i<plan.n_bins; i++ )
+		amplitude_values[2*i+sound_channel] = PlanStepAmplitude( plan, i, loudness_values[i], inv_max_expected,
+				loudness_scale, max_amplitude, background_amplitude ) / max_amplitude;
+}
+
 void RenderAmplitudesToFrequency(
 		const float amplitude_times[],
 		const float amplitude_values[],
@@ -66,10 +344,11 @@ void RenderAmplitudesToFrequency(
 		const unsigned int sound_channel ,
 		const float base_frequency,
 		const audio_t base_amplitude,
-		bool set_not_add
+		bool set_not_add,
+		const unsigned int sample_rate
 	)
 {
-	const float dt = 1.0/SAMPLE_RATE;
+	const float dt = 1.0/sample_rate;
 #pragma omp parallel for default(shared)
 	for( int i=0; i<amplitude_n_steps-1; ++i )
 	{
@@ -84,8 +363,8 @@ void RenderAmplitudesToFrequency(
 		const float da = diff_a / diff_t * dt;
 		float a = a0;
 
-		const int sound_n0 = t0*SAMPLE_RATE;
-		const int sound_n1 = t1*SAMPLE_RATE;
+		const int sound_n0 = t0*sample_rate;
+		const int sound_n1 = t1*sample_rate;
 		const int sound_i0 = sound_n0 * 2 + sound_channel;
 		const int sound_i1 = sound_n1 > sound_n_samples ?
 				2*sound_n_samples : sound_n1 * 2 + sound_channel;
@@ -96,21 +375,22 @@ void RenderAmplitudesToFrequency(
 		if(set_not_add)
 		{
 			for( int j=sound_i0; j<sound_i1; j+=2, a+=da )
-				sound_values[j] = base_amplitude * a * sin( 2*M_PI*base_frequency*(j-sound_channel)/SAMPLE_RATE/2. );
+				sound_values[j] = base_amplitude * a * sin( 2*M_PI*base_frequency*(j-sound_channel)/sample_rate/2. );
 		}
 		else
 		{
 			for( int j=sound_i0; j<sound_i1; j+=2, a+=da )
-				sound_values[j] += base_amplitude * a * sin( 2*M_PI*base_frequency*(j-sound_channel)/SAMPLE_RATE/2. );
+				sound_values[j] += base_amplitude * a * sin( 2*M_PI*base_frequency*(j-sound_channel)/sample_rate/2. );
 		}
 	}
 }
 
-void RenderAmplitudesToFrequencyWithConstantTimeSteps(
+void RenderAmplitudesToFrequencyWithTimeTable(
 		const unsigned int loudness_values[],
 		const unsigned int loudness_n_steps, //!< length of amplitude_values
 		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
-		const double loudness_max_time, //!< end time
+		const float loudness_scale[], //!< loudness of each step is multiplied by this factor (if not NULL)
+		const unsigned int step_sample_edges[], //!< step i lasts from sample [i] to sample [i+1]
 		audio_t sound_values[], //!< 2*sound_n_samples in length
 		const unsigned int sound_n_samples,
 		const unsigned int sound_channel, //!< channel number 0-1
@@ -119,81 +399,174 @@ void RenderAmplitudesToFrequencyWithConstantTimeSteps(
 		bool set_not_add, //!< if set to true, the amplitudes will be set and not added to existing values
 		const float frequency_doubling_time, //!< how much frequency increases per unit of time
 		const float background_amplitude,
-		float * amplitude_values
+		float * amplitude_values,
+		const unsigned int sample_rate
 		)
 {
-	const unsigned int background_amp = audio_A * background_amplitude;
 	std::cout << "Freq. doubling time is : " << frequency_doubling_time << std::endl;
-	const audio_t k_add = set_not_add ? 0 : 1;
-
-	// TODO: test how much latency the function overhead creates on RPi and act accordingly (remove this TODO if ok, reimplement this function if not OK)
-	std::function< float(float) > f_phase;
-	if( frequency_doubling_time > 0. )
-		f_phase = [&base_frequency,&frequency_doubling_time](float t) -> float {
-		return base_frequency * frequency_doubling_time / log(2.) *
-			( exp( log(2.) * t / frequency_doubling_time) - 1. ); };
-	else
-		f_phase = [&base_frequency,&frequency_doubling_time](float t) -> float { return
-			base_frequency * t; };
 
-#pragma omp parallel default(shared)
-	{
-	unsigned int i_freq = 0;
-	// This factor corrects amplitudes to equalize loudness for changing frequencies
-	float correction_of_amplitudes_for_changing_frequency = 1.0;
-	float correction_convert_loudness_to_amplitude = 1.0;
-#pragma omp for
-	for( unsigned int i=0; i<loudness_n_steps; i++ )
-	{
-		// find the time interval that we will set in the sample
-		const unsigned int sound_j0 = i * SAMPLE_RATE * loudness_max_time / loudness_n_steps;
-		const unsigned int sound_j1_from_amplitudes = (i+1) * SAMPLE_RATE * loudness_max_time / loudness_n_steps;
-		const unsigned int sound_j1 = sound_j1_from_amplitudes < sound_n_samples ? sound_j1_from_amplitudes : sound_n_samples;
-
-		// correct for changing frequencies
-		if( frequency_doubling_time > 0. )
-		{
-			const float avg_t = (i+0.5) * loudness_max_time / loudness_n_steps;
-			const float avg_freq = base_frequency * exp( log(2.) * avg_t / frequency_doubling_time );
+	StepSynthesis s;
+	s.loudness_values = loudness_values;
+	s.loudness_n_steps = loudness_n_steps;
+	s.loudness_max_expected_value = loudness_max_expected_value;
+	s.loudness_scale = loudness_scale;
+	s.step_sample_edges = step_sample_edges;
+	s.sound_values = sound_values;
+	s.sound_n_samples = sound_n_samples;
+	s.sound_channel = sound_channel;
+	s.base_frequency = base_frequency;
+	s.max_amplitude = max_amplitude;
+	s.frequency_doubling_time = frequency_doubling_time;
+	s.background_amplitude = background_amplitude;
+	s.amplitude_values = amplitude_values;
+	s.sample_rate = sample_rate;
 
-			while( (i_freq < equal_loudness_N-1) && (equal_loudness_data[i_freq+1][0] < avg_freq) )
-				i_freq++;
-
-			const float d_freq = equal_loudness_data[i_freq+1][0]-equal_loudness_data[i_freq][0];
-			const float k_i = (avg_freq - equal_loudness_data[i_freq][0]) / d_freq;
-			const float k_ip1 = 1.0 - k_i;
-			const float avg_loudness = equal_loudness_data[i_freq][1]*k_i + equal_loudness_data[i_freq+1][1]*k_ip1;
+	// the kernel is selected once, its loops test none of the flags
+	const unsigned int i_kernel = (set_not_add ? 1 : 0) | (frequency_doubling_time > 0. ? 2 : 0) |
+			(amplitude_values != NULL ? 4 : 0) | (background_amplitude != 0.f ? 8 : 0);
+	step_synthesis_kernels[i_kernel]( s );
+}
 
-			correction_of_amplitudes_for_changing_frequency = exp(
-					(avg_loudness - equal_loudness_nominal) / 20. );
-		}
+void RenderAmplitudesToFrequencyWithTimeTableQ15(
+		const unsigned int loudness_values[],
+		const unsigned int loudness_n_steps,
+		const unsigned int loudness_max_expected_value,
+		const uint32_t loudness_scale_q15[],
+		const unsigned int step_sample_edges[],
+		audio_t sound_values[],
+		const unsigned int sound_n_samples,
+		const unsigned int sound_channel,
+		const float base_frequency,
+		const audio_t max_amplitude,
+		bool set_not_add,
+		const float frequency_doubling_time,
+		const float background_amplitude,
+		float * amplitude_values,
+		const unsigned int sample_rate
+		)
+{
+	// the tables are built by the first call
+	static const std::vector<int16_t> sin_table_data = MakeSinTableQ15();
+	static const std::vector<int16_t> amplitude_table_data = MakeLoudnessToAmplitudeTableQ15();
+	const int16_t * sin_table = &sin_table_data[0];
+	const int16_t * amplitude_table = &amplitude_table_data[0];
 
-		// calculate this loudness (as a fraction in expected range 0 <---> L0=1.0)
-		float this_loudness = ((float)loudness_values[i]) / loudness_max_expected_value + background_amplitude;
+	const int32_t background_q15 = ToQ15( background_amplitude );
+	const unsigned int max_expected = loudness_max_expected_value > 0 ? loudness_max_expected_value : 1;
+	const double phase_units = 4294967296.; // one period
+	const bool is_chirp = frequency_doubling_time > 0.;
+	// phase increment per sample at the base frequency
+	const uint32_t base_increment = (uint32_t)( (double)base_frequency / sample_rate * phase_units + 0.5 );
+	// a rising frequency grows by this fraction per sample, in units of 2^-32
+	const uint64_t increment_growth = is_chirp ?
+			(uint64_t)( ( exp( log(2.) / (frequency_doubling_time*sample_rate) ) - 1. ) * phase_units + 0.5 ) : 0;
 
-		// Correction for exponential perception of loudness
-		// "A widely used "rule of thumb" for the loudness of a particular sound is
-		// that the sound must be increased in intensity by a factor of ten
-		// for the sound to be perceived as twice as loud."
-		// (http://hyperphysics.phy-astr.gsu.edu/hbase/Sound/loud.html#c2)
+#pragma omp parallel for default(shared)
+	for( unsigned int i=0; i<loudness_n_steps; i++ )
+	{
+		const unsigned int sound_j0 = step_sample_edges[i];
+		const unsigned int sound_j1_from_amplitudes = step_sample_edges[i+1];
+		const unsigned int sound_j1 = sound_j1_from_amplitudes < sound_n_samples ? sound_j1_from_amplitudes : sound_n_samples;
 
-		const float kL = log(10.) / (2.*log(2.));
-		const float kA0L0 = max_amplitude / pow(1.0,kL);
-		const float this_amplitude_f = kA0L0 * pow(this_loudness,kL);
-		const audio_t this_amplitude = this_amplitude_f < max_amplitude ? this_amplitude_f : max_amplitude;
+		// loudness as a Q15 fraction of the expected range, amplitude from the loudness table
+		const uint64_t scaled_loudness = (uint64_t)loudness_values[i] *
+				( loudness_scale_q15 != NULL ? loudness_scale_q15[i] : (uint32_t)q15_one );
+		const int64_t loudness_q15 = (int64_t)( scaled_loudness / max_expected ) + background_q15;
+		const int32_t amplitude_q15 = loudness_q15 >= q15_one ? q15_one :
+				( loudness_q15 <= 0 ? 0 : LookupQ15( amplitude_table, (int32_t)loudness_q15 ) );
+		// equal loudness correction of the frequency in the middle of the step, once per step
+		const int64_t correction_q15 = is_chirp ? (int64_t)( q15_one * SoundRenderer::EqualLoudnessCorrection(
+				base_frequency * exp( log(2.) * 0.5 * (sound_j0 + sound_j1_from_amplitudes) / sample_rate / frequency_doubling_time ) ) )
+				: q15_one;
+		const int64_t corrected_amplitude = ( (int64_t)max_amplitude * amplitude_q15 * correction_q15 ) >> 30;
+		const int32_t this_amplitude = corrected_amplitude < max_amplitude ? (int32_t)corrected_amplitude : max_amplitude;
 
 		if( amplitude_values != NULL )
 			amplitude_values[2*i+sound_channel] = ((float)this_amplitude) / max_amplitude;
 
-		for( int j=2*sound_j0+sound_channel; j<2*sound_j1+sound_channel; j+=2 )
+		// phase and increment (in units of 2^-40 periods) at the first sample of the step
+		uint32_t phase;
+		uint64_t increment;
+		if( is_chirp )
+		{
+			const double t0 = (double)sound_j0 / sample_rate;
+			const double growth = exp( log(2.) * t0 / frequency_doubling_time );
+			const double cycles = base_frequency * frequency_doubling_time / log(2.) * ( growth - 1. );
+			phase = (uint32_t)( ( cycles - floor(cycles) ) * phase_units );
+			increment = (uint64_t)( base_frequency * growth / sample_rate * phase_units * 256. );
+		}
+		else
+		{
+			phase = (uint32_t)( (uint64_t)sound_j0 * base_increment );
+			increment = (uint64_t)base_increment << 8;
+		}
+
+		if( set_not_add )
+		{
+			for( unsigned int j=2*sound_j0+sound_channel; j<2*sound_j1+sound_channel; j+=2 )
+			{
+				sound_values[j] = (audio_t)( ( this_amplitude * SinQ15( sin_table, phase ) ) >> 15 );
+				phase += (uint32_t)( increment >> 8 );
+				increment += ( (increment >> 16) * increment_growth ) >> 16;
+			}
+		}
+		else
 		{
-			const float t = (j-sound_channel)/2/((float)SAMPLE_RATE);
-			const float phase = f_phase(t);
-			sound_values[j] = this_amplitude * sin( 2*M_PI*phase ) \
-				+ k_add * sound_values[j];
+			for( unsigned int j=2*sound_j0+sound_channel; j<2*sound_j1+sound_channel; j+=2 )
+			{
+				sound_values[j] = SaturateAudio( sound_values[j] +
+						( ( this_amplitude * SinQ15( sin_table, phase ) ) >> 15 ) );
+				phase += (uint32_t)( increment >> 8 );
+				increment += ( (increment >> 16) * increment_growth ) >> 16;
+			}
 		}
-	} // end of for loop
-	} // end of parallel region
+	}
+}
+
+void RenderAmplitudesToFrequencyWithConstantTimeSteps(
+		const unsigned int loudness_values[],
+		const unsigned int loudness_n_steps, //!< length of amplitude_values
+		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
+		const double loudness_max_time, //!< end time
+		audio_t sound_values[], //!< 2*sound_n_samples in length
+		const unsigned int sound_n_samples,
+		const unsigned int sound_channel, //!< channel number 0-1
+		const float base_frequency, //!< base frequency for the amplitude envelope
+		const audio_t max_amplitude, //!< amplitude conversion factor
+		bool set_not_add, //!< if set to true, the amplitudes will be set and not added to existing values
+		const float frequency_doubling_time, //!< how much frequency increases per unit of time
+		const float background_amplitude,
+		float * amplitude_values,
+		const unsigned int sample_rate
+		)
+{
+	std::vector<unsigned int> step_sample_edges( loudness_n_steps+1 );
+	for( unsigned int i=0; i<=loudness_n_steps; i++ )
+		step_sample_edges[i] = i * sample_rate * loudness_max_time / loudness_n_steps;
+	RenderAmplitudesToFrequencyWithTimeTable(
+		loudness_values, loudness_n_steps, loudness_max_expected_value, NULL,
+		&step_sample_edges[0],
+		sound_values, sound_n_samples, sound_channel, base_frequency, max_amplitude,
+		set_not_add, frequency_doubling_time, background_amplitude, amplitude_values, sample_rate );
+}
+
+void ConvertMixBusToSound(
+		const float left_values[],
+		const float right_values[],
+		audio_t sound_values[],
+		const unsigned int sound_n_samples
+		)
+{
+	const float audio_max = INT16_MAX;
+	const float audio_min = INT16_MIN;
+#pragma omp parallel for
+	for( unsigned int j=0; j<sound_n_samples; j++ )
+	{
+		const float left = left_values[j] < audio_max ? left_values[j] : audio_max;
+		const float right = right_values[j] < audio_max ? right_values[j] : audio_max;
+		sound_values[2*j] = (audio_t)( left > audio_min ? left : audio_min );
+		sound_values[2*j+1] = (audio_t)( right > audio_min ? right : audio_min );
+	}
 }
 
 void GenerateSmootingKernel(
@@ -251,6 +624,53 @@ void ApplyKernelSmoothingToAmplitudes(
 	}
 }
 
+void ApplyRecursiveGaussianSmoothing(
+		const unsigned int values_in[],
+		unsigned int values_out[],
+		const unsigned int n_steps,
+		const float sigma_in_steps,
+		double scratch[]
+		)
+{
+	if( sigma_in_steps < 0.5 || n_steps == 0 )
+	{
+		for( unsigned int i=0; i<n_steps; ++i )
+			values_out[i] = values_in[i];
+		return;
+	}
+	// I.T. Young, L.J. van Vliet, "Recursive implementation of the Gaussian filter",
+	// Signal Processing 44 (1995), coefficients of equations 11b and 8c
+	const double sigma = sigma_in_steps;
+	const double q = sigma >= 2.5 ? 0.98711*sigma - 0.96330 : 3.97156 - 4.14554*sqrt( 1. - 0.26891*sigma );
+	const double q2 = q*q, q3 = q2*q;
+	const double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+	const double b1 = ( 2.44413*q + 2.85619*q2 + 1.26661*q3 ) / b0;
+	const double b2 = -( 1.4281*q2 + 1.26661*q3 ) / b0;
+	const double b3 = 0.422205*q3 / b0;
+	const double B = 1. - ( b1 + b2 + b3 );
+
+	// causal pass, the values before the first step are equal to the first value
+	double * w = scratch;
+	double w1 = values_in[0], w2 = w1, w3 = w1;
+	for( unsigned int i=0; i<n_steps; ++i )
+	{
+		w[i] = B*values_in[i] + b1*w1 + b2*w2 + b3*w3;
+		w3 = w2;
+		w2 = w1;
+		w1 = w[i];
+	}
+	// anti-causal pass, the values after the last step are equal to the last value
+	double y1 = w[n_steps-1], y2 = y1, y3 = y1;
+	for( unsigned int i=n_steps; i-- > 0; )
+	{
+		const double y = B*w[i] + b1*y1 + b2*y2 + b3*y3;
+		values_out[i] = y > 0. ? (unsigned int)( y + 0.5 ) : 0;
+		y3 = y2;
+		y2 = y1;
+		y1 = y;
+	}
+}
+
 } // end of namespace SoundRenderer
 
 SimpleDepthRenderer::SimpleDepthRenderer(
@@ -265,7 +685,8 @@ SimpleDepthRenderer::SimpleDepthRenderer(
 	float lower_frequency,
 	float lower_frequency_doubling_length,
 	float lower_amplitude,
-	bool save_loudness
+	bool save_loudness,
+	DistanceMapping * distance_mapping
 	)
 	:max_distance(max_distance),
 	 step_distance(step_distance),
@@ -279,12 +700,20 @@ SimpleDepthRenderer::SimpleDepthRenderer(
 	 lower_freq_doubling_length(lower_frequency_doubling_length),
 	 lower_amplitude(lower_amplitude),
 	 save_loudness(save_loudness),
-	 max_counter(max_distance/step_distance),
+	 distance_mapping( distance_mapping != NULL ? distance_mapping :
+		new DistanceMapping( DistanceMappingLinear, max_distance, step_distance, max_distance / speed_of_sound ) ),
+	 max_counter(this->distance_mapping->n_bins),
 #if defined _OPENMP
 	 num_counters(omp_get_max_threads()),
 #else
 	 num_counters(1),
 #endif
+	 normal_estimator(NULL),
+	 weight_map(NULL),
+	 point_weights(NULL),
+	 echo_image(NULL),
+	 smoothing_sigma(0.),
+	 synthesize(true),
 	 loudness_n_per_channel(this->max_counter)
 {
 	counters = new unsigned int * [num_counters*2];
@@ -293,6 +722,8 @@ SimpleDepthRenderer::SimpleDepthRenderer(
 		counters[i] = &counters[0][max_counter*i];
 	loudness_data = new float [2*loudness_n_per_channel];
 	amplitudes_data = new float [2*loudness_n_per_channel];
+	smoothed_counts = new unsigned int [max_counter];
+	smoothing_scratch = new double [max_counter];
 }
 
 SimpleDepthRenderer::~SimpleDepthRenderer()
@@ -301,13 +732,264 @@ SimpleDepthRenderer::~SimpleDepthRenderer()
 	delete [] counters;
 	delete [] loudness_data;
 	delete [] amplitudes_data;
+	delete [] smoothed_counts;
+	delete [] smoothing_scratch;
+	delete echo_image;
+	for( unsigned int i=0; i<render_plans.size(); ++i )
+		delete render_plans[i];
+	delete distance_mapping;
+}
+
+void SimpleDepthRenderer::SetSurfaceNormalEstimator( SurfaceNormalEstimator * estimator )
+{
+	normal_estimator = estimator;
+	point_weights = NULL;
+}
+
+void SimpleDepthRenderer::SetWeightMap( const WeightMap * map )
+{
+	weight_map = map;
+	point_weights = NULL;
+}
+
+void SimpleDepthRenderer::SetEchoBands( const CameraIntrinsics & intrinsics, unsigned int num_bands )
+{
+	delete echo_image;
+	echo_image = NULL;
+	if( num_bands == 0 )
+		return;
+	echo_image = new EchoImage( *distance_mapping, intrinsics, num_bands );
+	MakeEchoBinMaps( *echo_image, echo_bin_maps );
+}
+
+void SimpleDepthRenderer::SetSmoothing( float sigma_in_bins )
+{
+	smoothing_sigma = sigma_in_bins;
+}
+
+void SimpleDepthRenderer::SetSynthesis( bool synthesize )
+{
+	this->synthesize = synthesize;
+}
+
+void SimpleDepthRenderer::UpdatePointWeights( const Vertex * vertices, const unsigned int n_vertices )
+{
+	point_weights = NULL;
+	if( normal_estimator != NULL && normal_estimator->Compute( vertices, n_vertices ) )
+		point_weights = normal_estimator->get_weights();
+	if( weight_map == NULL || weight_map->camera_w*weight_map->camera_h != n_vertices )
+		return;
+	if( point_weights == NULL )
+	{
+		point_weights = weight_map->get_weights();
+		return;
+	}
+	// only the weights of the pixels that are binned are combined
+	combined_weights.resize( n_vertices );
+	const uint16_t * map_weights = weight_map->get_weights();
+	const std::vector<PointSpan> & spans = weight_map->get_spans();
+#pragma omp parallel for
+	for( int s=0; s<(int)spans.size(); ++s )
+	{
+		for( unsigned int i=spans[s].begin; i<spans[s].end; ++i )
+			combined_weights[i] = ( (uint32_t)point_weights[i] * map_weights[i] ) / SurfaceNormalEstimator::weight_unit;
+	}
+	point_weights = &combined_weights[0];
+}
+
+const std::vector<PointSpan> & SimpleDepthRenderer::GetPointSpans( const unsigned int n_vertices )
+{
+	if( weight_map != NULL && weight_map->camera_w*weight_map->camera_h == n_vertices )
+		return weight_map->get_spans();
+	// blocks of points, so that the threads share the work as they do with the rows of a map
+	const unsigned int block_n = 4096;
+	if( all_points.empty() || all_points.back().end != n_vertices )
+	{
+		all_points.clear();
+		for( unsigned int i=0; i<n_vertices; i+=block_n )
+		{
+			const PointSpan span = { i, min( i+block_n, n_vertices ) };
+			all_points.push_back( span );
+		}
+	}
+	return all_points;
+}
+
+void SimpleDepthRenderer::ComputeEchoImage( EchoImage & image, const Vertex * vertices, const unsigned int n_vertices )
+{
+	image.Compute( vertices, point_weights, GetRowSpans( n_vertices, image.camera_w ) );
+}
+
+void SimpleDepthRenderer::MakeEchoBinMaps( const EchoImage & image, EchoBinMap bin_maps[2] )const
+{
+	// The ears are at -+stereo_distance/2 on the x axis, a point at distance d and azimuth a
+	// is at sqrt( d^2 +- stereo_distance*d*sin(a) + stereo_distance^2/4 ) from them (neglecting its elevation)
+	const float * bin_edges = distance_mapping->get_bin_edges();
+	for( unsigned int channel=0; channel<2; ++channel )
+	{
+		const float side = channel == 0 ? 1. : -1.;
+		for( unsigned int k=0; k<image.num_bands; ++k )
+		{
+			const float offset = side * stereo_distance * sin( image.get_band_azimuth(k) );
+			for( unsigned int i=0; i<max_counter; ++i )
+			{
+				const float d = 0.5 * (bin_edges[i] + bin_edges[i+1]);
+				const float ear_distance = sqrt( max( d*d + offset*d + stereo_distance*stereo_distance/4, 0.f ) );
+				image.SetDestination( bin_maps[channel], k, i, ear_distance );
+			}
+		}
+	}
+}
+
+void SimpleDepthRenderer::RenderEchoImageToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n,
+	audio_t max_amplitude
+	)
+{
+	ComputeEchoImage( *echo_image, vertices, n_vertices );
+	echo_image->Fold( echo_bin_maps[0], counters[0] );
+	echo_image->Fold( echo_bin_maps[1], counters[num_counters] );
+
+	// Re-normalize signals so that a sample in which 25% of the points are within 10cm distance
+	// reaches (max amplitude)/10. amp_div is the avg. num of samples per interval in the described configuration
+	// (weighted points add CountsPerPoint() counts for a surface facing the listener)
+	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
+	for( int channel=0; channel<2; ++channel )
+	{
+		RenderCountsToSound(
+				counters[channel*num_counters], amp_div,
+				sound_out, sound_n, channel, base_frequency,
+				max_amplitude,
+				true,
+				freq_doubling_length,
+				background_amplitude,
+				save_loudness ? amplitudes_data : NULL
+				);
+	}
+
+	if(save_loudness )
+	{
+#pragma omp parallel for
+		for( int i=0; i<loudness_n_per_channel; ++i )
+		{
+			loudness_data[2*i+0] = ((float)counters[0][i]/amp_div) ;
+			loudness_data[2*i+1] = ((float)counters[num_counters][i]/amp_div) ;
+		}
+	}
+}
+
+const std::vector<PointSpan> & SimpleDepthRenderer::GetRowSpans( const unsigned int n_vertices, const unsigned int camera_w )
+{
+	if( weight_map != NULL && weight_map->camera_w*weight_map->camera_h == n_vertices && weight_map->camera_w == camera_w )
+		return weight_map->get_spans();
+	if( all_rows.empty() || all_rows.back().end != n_vertices || all_rows[0].end != min( camera_w, n_vertices ) )
+	{
+		all_rows.clear();
+		for( unsigned int i=0; i<n_vertices; i+=camera_w )
+		{
+			const PointSpan span = { i, min( i+camera_w, n_vertices ) };
+			all_rows.push_back( span );
+		}
+	}
+	return all_rows;
+}
+
+unsigned int SimpleDepthRenderer::CountsPerPoint()const
+{
+	return point_weights != NULL ? SurfaceNormalEstimator::weight_unit : 1;
+}
+
+const RenderPlan & SimpleDepthRenderer::GetRenderPlan( float frequency, float frequency_doubling_time, unsigned int sound_n )
+{
+	for( unsigned int i=0; i<render_plans.size(); ++i )
+		if( render_plans[i]->Matches( frequency, frequency_doubling_time, sound_n ) )
+			return *render_plans[i];
+	render_plans.push_back( new RenderPlan( *distance_mapping, frequency, frequency_doubling_time, sound_n ) );
+	return *render_plans.back();
+}
+
+const unsigned int * SimpleDepthRenderer::SmoothCounts( const unsigned int counts[] )
+{
+	if( smoothing_sigma <= 0. )
+		return counts;
+	SoundRenderer::ApplyRecursiveGaussianSmoothing( counts, smoothed_counts, max_counter, smoothing_sigma, smoothing_scratch );
+	return smoothed_counts;
+}
+
+void SimpleDepthRenderer::RenderCountsToSound(
+	const unsigned int counts[],
+	const unsigned int amp_div,
+	audio_t sound_out[],
+	unsigned int sound_n,
+	int channel,
+	float frequency,
+	audio_t max_amplitude,
+	bool set_not_add,
+	float frequency_doubling_length,
+	float background_amplitude,
+	float * amplitude_values
+	)
+{
+	counts = SmoothCounts( counts );
+	if( synthesize == false )
+	{
+		if( amplitude_values != NULL )
+			SoundRenderer::ComputeAmplitudesWithPlan(
+					GetRenderPlan( frequency, frequency_doubling_length / speed_of_sound, sound_n ),
+					counts, amp_div, distance_mapping->get_loudness_scale(), channel,
+					max_amplitude, background_amplitude, amplitude_values );
+		return;
+	}
+
+#if FIXEDPOINT == 1
+	SoundRenderer::RenderAmplitudesToFrequencyWithTimeTableQ15(
+			counts, max_counter, amp_div,
+			distance_mapping->get_loudness_scale_q15(), distance_mapping->get_sample_edges(),
+			sound_out, sound_n, channel, frequency,
+			max_amplitude,
+			set_not_add,
+			frequency_doubling_length / speed_of_sound,
+			background_amplitude,
+			amplitude_values,
+			distance_mapping->sample_rate
+			);
+#else
+	if( mix_bus.size() != 2*sound_n )
+		mix_bus.assign( 2*sound_n, 0.f );
+	SoundRenderer::RenderAmplitudesWithPlan(
+			GetRenderPlan( frequency, frequency_doubling_length / speed_of_sound, sound_n ),
+			counts, amp_div,
+			distance_mapping->get_loudness_scale(),
+			&mix_bus[channel*sound_n], channel,
+			max_amplitude,
+			set_not_add,
+			background_amplitude,
+			amplitude_values
+			);
+#endif
+}
+
+void SimpleDepthRenderer::MixBusToSound( audio_t sound_out[], unsigned int sound_n )
+{
+#if FIXEDPOINT != 1
+	if( synthesize && mix_bus.size() == 2*sound_n )
+		SoundRenderer::ConvertMixBusToSound( &mix_bus[0], &mix_bus[sound_n], sound_out, sound_n );
+#endif
 }
 
 void SimpleDepthRenderer::RenderPointcloudToSound(
-	const rs2::vertex * vertices, const unsigned int n_vertices,
+	const Vertex * vertices, const unsigned int n_vertices,
 	audio_t sound_out[],
 	unsigned int sound_n )
 {
+	UpdatePointWeights( vertices, n_vertices );
+	if( echo_image != NULL && echo_image->Fits( n_vertices ) )
+		RenderEchoImageToSound( vertices, n_vertices, sound_out, sound_n,
+				lower_distance > 0. ? audio_A/2 : audio_A );
+	else
+	{
 	this->RenderDistanceToSound(
 		-stereo_distance/2, 0, 0,
 		vertices, n_vertices, 0,
@@ -326,6 +1008,7 @@ void SimpleDepthRenderer::RenderPointcloudToSound(
 		freq_doubling_length,
 		background_amplitude
 		);
+	}
 
 //	return;
 	if( lower_distance > 0. )
@@ -350,16 +1033,20 @@ void SimpleDepthRenderer::RenderPointcloudToSound(
 		lower_amplitude
 		);
 	}
+	MixBusToSound( sound_out, sound_n );
 }
 
 void SimpleDepthRenderer::RenderPointcloudToSoundDelayIsAngle(
-	const rs2::vertex * vertices, const unsigned int n_vertices,
+	const Vertex * vertices, const unsigned int n_vertices,
 	audio_t sound_out[],
 	unsigned int sound_n,
 	const unsigned int camera_w,
-	const float delay_distance_at_max_angle
+	const float column_delay[],
+	const float row_delay[]
 	)
 {
+	UpdatePointWeights( vertices, n_vertices );
+	const std::vector<PointSpan> & spans = GetRowSpans( n_vertices, camera_w );
 	int num_used_counters = 1;
 #pragma omp parallel default(shared)
 	{
@@ -383,24 +1070,29 @@ void SimpleDepthRenderer::RenderPointcloudToSoundDelayIsAngle(
 			my_counter_right[i] = 0;
 		}
 
+		// Row by row, the delays of the points of a row are read from the column table
 #pragma omp for
-		for( int i=0; i < n_vertices; ++i )
+		for( int s=0; s < (int)spans.size(); ++s )
 		{
-			const int i_width = i % camera_w;
-			const float delay_distance_fraction = 2.0*i_width/camera_w - 1.; // -1 <-> +1
-			const float this_delay_distance = delay_distance_at_max_angle * \
-					delay_distance_fraction;
-
-			rs2::vertex const & v = vertices[i];
-			if( v.z < 0.0001 )
-				continue;
-			const float dd = sqrt(v.x*v.x+v.y*v.y+v.z*v.z);
-			const unsigned int i_bin_left = ((unsigned int)((dd+this_delay_distance)/step_distance));
-			if(i_bin_left<max_counter)
-				my_counter_left[i_bin_left]++;
-			const unsigned int i_bin_right = ((unsigned int)((dd-this_delay_distance)/step_distance));
-			if(i_bin_right<max_counter)
-				my_counter_right[i_bin_right]++;
+			const unsigned int row = spans[s].begin / camera_w; // once per row
+			const unsigned int row_begin = row*camera_w;
+			const float row_delay_distance = row_delay != NULL ? row_delay[row] : 0.;
+			for( unsigned int i=spans[s].begin; i < spans[s].end; ++i )
+			{
+				Vertex const & v = vertices[i];
+				if( v.z < 0.0001 )
+					continue;
+				const float dd = sqrt(v.x*v.x+v.y*v.y+v.z*v.z) + row_delay_distance;
+				const unsigned int counts = point_weights != NULL ? point_weights[i] : 1;
+				const float dd_left = dd + column_delay[i-row_begin];
+				const float dd_right = dd - column_delay[i-row_begin];
+				const unsigned int i_bin_left = dd_left >= 0. ? distance_mapping->BinOf(dd_left) : max_counter;
+				if(i_bin_left<max_counter)
+					my_counter_left[i_bin_left] += counts;
+				const unsigned int i_bin_right = dd_right >= 0. ? distance_mapping->BinOf(dd_right) : max_counter;
+				if(i_bin_right<max_counter)
+					my_counter_right[i_bin_right] += counts;
+			}
 		}
 	} // end openMP parallel region
 
@@ -419,27 +1111,29 @@ void SimpleDepthRenderer::RenderPointcloudToSoundDelayIsAngle(
 
 	// Re-normalize signals so that a sample in which 25% of the points are within 10cm distance
 	// reaches (max amplitude)/10. amp_div is the avg. num of samples per interval in the described configuration
-	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10;
+	// (weighted points add CountsPerPoint() counts for a surface facing the listener)
+	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
 	// Effective max counts = audio_A * amplitude_divider / base_amplitude
 	// audio_A = amplitude_values[i] / amplitude_divider * base_amplitude + 0.5
-	SoundRenderer::RenderAmplitudesToFrequencyWithConstantTimeSteps(
-			counters[0], max_counter, amp_div, max_distance / speed_of_sound,
+	RenderCountsToSound(
+			counters[0], amp_div,
 			sound_out, sound_n, 0, base_frequency,
 			audio_A, // max amplitude
 			true,
-			freq_doubling_length / speed_of_sound,
+			freq_doubling_length,
 			background_amplitude,
 			save_loudness ? amplitudes_data : NULL
 			);
-	SoundRenderer::RenderAmplitudesToFrequencyWithConstantTimeSteps(
-			counters[0+num_counters], max_counter, amp_div, max_distance / speed_of_sound,
+	RenderCountsToSound(
+			counters[0+num_counters], amp_div,
 			sound_out, sound_n, 1, base_frequency,
 			audio_A, // max amplitude
 			true,
-			freq_doubling_length / speed_of_sound,
+			freq_doubling_length,
 			background_amplitude,
 			save_loudness ? amplitudes_data : NULL
 			);
+	MixBusToSound( sound_out, sound_n );
 
 	if(save_loudness )
 	{
@@ -452,9 +1146,92 @@ void SimpleDepthRenderer::RenderPointcloudToSoundDelayIsAngle(
 	}
 }
 
+DelayIsAngleDepthRenderer::DelayIsAngleDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float base_frequency_doubling_length,
+	float background_amplitude,
+	bool save_loudness,
+	const CameraIntrinsics & intrinsics,
+	float delay_distance_at_max_angle,
+	float elevation_delay_distance,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, base_frequency_doubling_length, background_amplitude,
+		0., // the delay replaces the stereo distance
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 delay_distance_at_max_angle(delay_distance_at_max_angle),
+	 elevation_delay_distance(elevation_delay_distance),
+	 column_delay(camera_w),
+	 row_delay(camera_h)
+{
+	// sines of the angles of the pixel centres to the optical axis, the rows are positive upwards
+	for( unsigned int u=0; u<camera_w; ++u )
+		column_delay[u] = sin( atan( (u - intrinsics.ppx) / intrinsics.fx ) );
+	for( unsigned int v=0; v<camera_h; ++v )
+		row_delay[v] = sin( atan( (intrinsics.ppy - v) / intrinsics.fy ) );
+	const float max_column = max( fabs( column_delay.front() ), fabs( column_delay.back() ) );
+	const float max_row = max( fabs( row_delay.front() ), fabs( row_delay.back() ) );
+	for( unsigned int u=0; u<camera_w; ++u )
+		column_delay[u] = max_column > 0. ? delay_distance_at_max_angle * column_delay[u] / max_column : 0.;
+	for( unsigned int v=0; v<camera_h; ++v )
+		row_delay[v] = max_row > 0. ? elevation_delay_distance * row_delay[v] / max_row : 0.;
+	cout << "Delay is angle : " << delay_distance_at_max_angle << " m at " <<
+			atan( (camera_w-1 - intrinsics.ppx) / intrinsics.fx ) * 180. / M_PI << " deg";
+	if( elevation_delay_distance != 0. )
+		cout << ", elevation " << elevation_delay_distance << " m";
+	cout << endl;
+}
+
+void DelayIsAngleDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	// the echo image has no rows, the elevation delay needs the points
+	if( echo_image != NULL && echo_image->Fits( n_vertices ) && elevation_delay_distance == 0. )
+	{
+		UpdatePointWeights( vertices, n_vertices );
+		RenderEchoImageToSound( vertices, n_vertices, sound_out, sound_n, audio_A );
+		MixBusToSound( sound_out, sound_n );
+		return;
+	}
+	const bool has_rows = n_vertices == camera_w*camera_h && elevation_delay_distance != 0.;
+	RenderPointcloudToSoundDelayIsAngle( vertices, n_vertices, sound_out, sound_n,
+			camera_w, &column_delay[0], has_rows ? &row_delay[0] : NULL );
+}
+
+void DelayIsAngleDepthRenderer::MakeEchoBinMaps( const EchoImage & image, EchoBinMap bin_maps[2] )const
+{
+	// the delay of a band is the mean delay of its columns
+	const float * bin_edges = distance_mapping->get_bin_edges();
+	unsigned int first_column = 0;
+	for( unsigned int k=0; k<image.num_bands; ++k )
+	{
+		float delay_distance = 0.;
+		for( unsigned int u=first_column; u<first_column+image.get_band_columns(k) && u<camera_w; ++u )
+			delay_distance += column_delay[u];
+		delay_distance /= image.get_band_columns(k);
+		first_column += image.get_band_columns(k);
+		for( unsigned int i=0; i<max_counter; ++i )
+		{
+			const float d = 0.5 * (bin_edges[i] + bin_edges[i+1]);
+			image.SetDestination( bin_maps[0], k, i, d + delay_distance );
+			image.SetDestination( bin_maps[1], k, i, d - delay_distance );
+		}
+	}
+}
+
 void SimpleDepthRenderer::RenderDistanceToSound(
 	float x, float y, float z,
-	const rs2::vertex * vertices, const unsigned int n_vertices,
+	const Vertex * vertices, const unsigned int n_vertices,
 	int channel,
 	audio_t sound_out[],
 	unsigned int sound_n,
@@ -464,6 +1241,7 @@ void SimpleDepthRenderer::RenderDistanceToSound(
 	float background_amplitude
 	)
 {
+	const std::vector<PointSpan> & spans = GetPointSpans( n_vertices );
 	int num_used_counters = 1;
 #pragma omp parallel default(shared)
 	{
@@ -484,18 +1262,21 @@ void SimpleDepthRenderer::RenderDistanceToSound(
 
 		float dx, dy, dz, dd;
 #pragma omp for
-		for( int i=0; i < n_vertices; ++i )
+		for( int s=0; s < (int)spans.size(); ++s )
 		{
-			rs2::vertex const & v = vertices[i];
-			if( v.z < 0.0001 )
-				continue;
-			dx = v.x - x;
-			dy = v.y - y;
-			dz = v.z - z;
-			dd = sqrt(dx*dx+dy*dy+dz*dz);
-			const unsigned int i_bin = ((unsigned int)(dd/step_distance));
-			if(i_bin<max_counter)
-				my_counter[i_bin]++;
+			for( unsigned int i=spans[s].begin; i < spans[s].end; ++i )
+			{
+				Vertex const & v = vertices[i];
+				if( v.z < 0.0001 )
+					continue;
+				dx = v.x - x;
+				dy = v.y - y;
+				dz = v.z - z;
+				dd = sqrt(dx*dx+dy*dy+dz*dz);
+				const unsigned int i_bin = distance_mapping->BinOf(dd);
+				if(i_bin<max_counter)
+					my_counter[i_bin] += point_weights != NULL ? point_weights[i] : 1;
+			}
 		}
 	} // end openMP parallel region
 
@@ -512,15 +1293,16 @@ void SimpleDepthRenderer::RenderDistanceToSound(
 
 	// Re-normalize signals so that a sample in which 25% of the points are within 10cm distance
 	// reaches (max amplitude)/10. amp_div is the avg. num of samples per interval in the described configuration
-	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10;
+	// (weighted points add CountsPerPoint() counts for a surface facing the listener)
+	const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
 	// Effective max counts = audio_A * amplitude_divider / base_amplitude
 	// audio_A = amplitude_values[i] / amplitude_divider * base_amplitude + 0.5
-	SoundRenderer::RenderAmplitudesToFrequencyWithConstantTimeSteps(
-			counters[0], max_counter, amp_div, max_distance / speed_of_sound,
+	RenderCountsToSound(
+			counters[0], amp_div,
 			sound_out, sound_n, channel, frequency,
 			lower_distance > 0. ? audio_A/2 : audio_A, // max amplitude
 			set_not_add,
-			frequency_doubling_length / speed_of_sound,
+			frequency_doubling_length,
 			background_amplitude,
 			(set_not_add && save_loudness) ? amplitudes_data : NULL
 			);
@@ -6,7 +6,14 @@
 #define SRC_SOUNDRENDERER_H_
 
 #include "Defaults.h"
-#include <librealsense2/rs.hpp>
+#include "DistanceMapping.h"
+#include "PointCloud.h"
+#include "WeightMap.h"
+#include "EchoImage.h"
+#include <vector>
+
+class SurfaceNormalEstimator;
+class RenderPlan;
 
 namespace SoundRenderer
 {
@@ -22,9 +29,32 @@ void RenderAmplitudesToFrequency(
 		const unsigned int sound_channel, //!< channel number 0-1
 		const float base_frequency, //!< base frequency for the amplitude envelope
 		const audio_t base_amplitude = audio_A, //!< amplitude conversion factor
-		bool set_not_add = false //!< if set to true, the amplitudes will be set and not added to existing values
+		bool set_not_add = false, //!< if set to true, the amplitudes will be set and not added to existing values
+		const unsigned int sample_rate = SAMPLE_RATE //!< [Hz]
 	);
 
+// Fixed point version of RenderAmplitudesToFrequencyWithTimeTable (see FixedPoint.h):
+// the loudness is normalized with integers, the amplitudes come from a lookup table
+// and the carrier from a Q15 sine table, so the per-sample loop uses only integer arithmetic
+void RenderAmplitudesToFrequencyWithTimeTableQ15(
+		const unsigned int loudness_values[],
+		const unsigned int loudness_n_steps, //!< length of amplitude_values
+		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
+		const uint32_t loudness_scale_q15[], //!< loudness of each step is multiplied by this Q15 factor (if not NULL)
+		const unsigned int step_sample_edges[], //!< step i lasts from sample [i] to sample [i+1], loudness_n_steps+1 long
+		audio_t sound_values[], //!< 2*sound_n_samples in length
+		const unsigned int sound_n_samples,
+		const unsigned int sound_channel, //!< channel number 0-1
+		const float base_frequency, //!< base frequency for the amplitude envelope
+		const audio_t max_amplitude = audio_A, //!< change amplitude that this renderer never exceeds
+		bool set_not_add = false, //!< if set to true, the amplitudes will be set and not added to existing values
+		const float frequency_increase_with_time = 0.0, //!< how much frequency increases per unit of time
+		const float background_amplitude = 0.0, //!< background signal amplitude (fraction)
+		float * amplitude_values = NULL, // if not null should be the same length as amplitude_values,
+		// stores amplitudes corresponding to loudness values
+		const unsigned int sample_rate = SAMPLE_RATE //!< [Hz], step_sample_edges must be at this rate
+		);
+
 // Adds the signal from the amplitude arrays to the sound array,
 // presuming equal time steps and keeping the amplitude in one interval constant
 void RenderAmplitudesToFrequencyWithConstantTimeSteps(
@@ -40,8 +70,70 @@ void RenderAmplitudesToFrequencyWithConstantTimeSteps(
 		bool set_not_add = false, //!< if set to true, the amplitudes will be set and not added to existing values
 		const float frequency_increase_with_time = 0.0, //!< how much frequency increases per unit of time
 		const float background_amplitude = 0.0, //!< background signal amplitude (fraction)
-		float * amplitude_values = NULL // if not null should be the same length as amplitude_values,
+		float * amplitude_values = NULL, // if not null should be the same length as amplitude_values,
+		// stores amplitudes corresponding to loudness values
+		const unsigned int sample_rate = SAMPLE_RATE //!< [Hz]
+		);
+
+// Adds the signal from the amplitude arrays to the sound array,
+// with variable length time steps given by a table of sample ranges
+// and keeping the amplitude in one interval constant
+void RenderAmplitudesToFrequencyWithTimeTable(
+		const unsigned int loudness_values[],
+		const unsigned int loudness_n_steps, //!< length of amplitude_values
+		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
+		const float loudness_scale[], //!< loudness of each step is multiplied by this factor (if not NULL)
+		const unsigned int step_sample_edges[], //!< step i lasts from sample [i] to sample [i+1], loudness_n_steps+1 long
+		audio_t sound_values[], //!< 2*sound_n_samples in length
+		const unsigned int sound_n_samples,
+		const unsigned int sound_channel, //!< channel number 0-1
+		const float base_frequency, //!< base frequency for the amplitude envelope
+		const audio_t max_amplitude = audio_A, //!< change amplitude that this renderer never exceeds
+		bool set_not_add = false, //!< if set to true, the amplitudes will be set and not added to existing values
+		const float frequency_increase_with_time = 0.0, //!< how much frequency increases per unit of time
+		const float background_amplitude = 0.0, //!< background signal amplitude (fraction)
+		float * amplitude_values = NULL, // if not null should be the same length as amplitude_values,
 		// stores amplitudes corresponding to loudness values
+		const unsigned int sample_rate = SAMPLE_RATE //!< [Hz], step_sample_edges must be at this rate
+		);
+
+// Amplitude factor that makes a tone of this frequency as loud as the nominal one (60 phons at 1 kHz)
+float EqualLoudnessCorrection( const float frequency );
+
+// Sets or adds the signal of the amplitude arrays with the precomputed sample ranges,
+// loudness corrections and carrier of a plan, the per-sample loop needs no math functions.
+// The signal goes to one channel of a float mix bus, which is not clipped
+void RenderAmplitudesWithPlan(
+		const RenderPlan & plan,
+		const unsigned int loudness_values[], //!< plan.n_bins long
+		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
+		const float loudness_scale[], //!< loudness of each step is multiplied by this factor (if not NULL)
+		float sound_values[], //!< plan.sound_n_samples in length, one channel
+		const unsigned int sound_channel, //!< channel number 0-1, for amplitude_values
+		const audio_t max_amplitude = audio_A, //!< change amplitude that this renderer never exceeds
+		bool set_not_add = false, //!< if set to true, the amplitudes will be set and not added to existing values
+		const float background_amplitude = 0.0, //!< background signal amplitude (fraction)
+		float * amplitude_values = NULL //!< if not null, stores the amplitude of each step
+		);
+
+// Computes the amplitudes that RenderAmplitudesWithPlan would render, without rendering them
+void ComputeAmplitudesWithPlan(
+		const RenderPlan & plan,
+		const unsigned int loudness_values[], //!< plan.n_bins long
+		const unsigned int loudness_max_expected_value, //!< amplitudes are divided by this number in order to normalize the output
+		const float loudness_scale[], //!< loudness of each step is multiplied by this factor (if not NULL)
+		const unsigned int sound_channel, //!< channel number 0-1
+		const audio_t max_amplitude, //!< change amplitude that this renderer never exceeds
+		const float background_amplitude, //!< background signal amplitude (fraction)
+		float * amplitude_values //!< amplitude of each step (fraction of max_amplitude), interleaved
+		);
+
+// Saturates the channels of a float mix bus and interleaves them into the sound array
+void ConvertMixBusToSound(
+		const float left_values[],
+		const float right_values[],
+		audio_t sound_values[], //!< 2*sound_n_samples in length
+		const unsigned int sound_n_samples
 		);
 
 void GenerateSmootingKernel(
@@ -57,6 +149,16 @@ void ApplyKernelSmoothingToAmplitudes(
 		const float kernel_values[],
 		const unsigned int kernel_n //!< must be an odd number
 		);
+
+// Gaussian smoothing with the recursive filter of Young and van Vliet,
+// the cost does not depend on sigma (values_in and values_out may be the same array)
+void ApplyRecursiveGaussianSmoothing(
+		const unsigned int values_in[],
+		unsigned int values_out[],
+		const unsigned int n_steps,
+		const float sigma_in_steps, //!< values are copied if sigma is below 0.5
+		double scratch[] //!< n_steps long, holds the causal pass
+		);
 }
 
 /* This class converts depth to a sound sample
@@ -65,8 +167,9 @@ void ApplyKernelSmoothingToAmplitudes(
 class DepthRenderer
 {
 public:
+	virtual ~DepthRenderer() {}
 	virtual void RenderPointcloudToSound(
-			const rs2::vertex * vertices, const unsigned int n_vertices,
+			const Vertex * vertices, const unsigned int n_vertices,
 			audio_t sound_out[],
 			unsigned int sound_n ) = 0;
 };
@@ -86,24 +189,85 @@ public:
 		float lower_frequency,
 		float lower_frequency_increase,
 		float lower_amplitude,
-		bool save_loudness
+		bool save_loudness,
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
 			);
-	~SimpleDepthRenderer();
+	virtual ~SimpleDepthRenderer();
 	virtual void RenderPointcloudToSound(
-			const rs2::vertex * vertices, const unsigned int n_vertices,
+			const Vertex * vertices, const unsigned int n_vertices,
 			audio_t sound_out[],
 			unsigned int sound_n );
+	// Renders the horizontal angle of the points as the delay between the L and R channels:
+	// the L channel hears a point at its distance plus the delay of its column, the R channel minus it,
+	// and both hear it later by the delay of its row (if row_delay is not NULL)
 	virtual void RenderPointcloudToSoundDelayIsAngle(
-			const rs2::vertex * vertices, const unsigned int n_vertices,
+			const Vertex * vertices, const unsigned int n_vertices,
 			audio_t sound_out[],
 			unsigned int sound_n,
 			const unsigned int camera_w,
-			const float delay_distance_at_max_angle
+			const float column_delay[], //!< delay distance of each column [m]
+			const float row_delay[] = NULL //!< delay distance of each row [m], n_vertices/camera_w long
 			);
-private:
+	// If set, the points are weighted by the estimator's scattering weights
+	// instead of being counted (the estimator is not owned by the renderer)
+	void SetSurfaceNormalEstimator( SurfaceNormalEstimator * estimator );
+	// If set, the points are weighted by the map (times the scattering weights)
+	// and the masked pixels are not binned (the map is not owned by the renderer)
+	void SetWeightMap( const WeightMap * map );
+	// If num_bands is positive, the pointclouds of the camera layout are binned once into an echo image
+	// of num_bands column bands, from which the histograms of both channels are derived
+	// (instead of binning the points for each channel)
+	void SetEchoBands( const CameraIntrinsics & intrinsics, unsigned int num_bands );
+	// If sigma is positive, the histograms are smoothed with a Gaussian of sigma bins before the synthesis
+	void SetSmoothing( float sigma_in_bins );
+	// If false, the pings only compute the loudness and the amplitudes (if save_loudness is set),
+	// without rendering the sound, e.g. for a StreamRenderer
+	void SetSynthesis( bool synthesize );
+protected:
+	// Computes the point weights, if a surface normal estimator or a weight map is set
+	void UpdatePointWeights( const Vertex * vertices, const unsigned int n_vertices );
+	// The points to bin: the spans of the weight map if it fits the pointcloud, else all points
+	const std::vector<PointSpan> & GetPointSpans( const unsigned int n_vertices );
+	// As GetPointSpans, but the spans do not cross the rows of camera_w points
+	const std::vector<PointSpan> & GetRowSpans( const unsigned int n_vertices, const unsigned int camera_w );
+	// Bins the points into the image, skipping the pixels masked by the weight map
+	void ComputeEchoImage( EchoImage & image, const Vertex * vertices, const unsigned int n_vertices );
+	// Maps the bins of each band of the image to the distances of the L and of the R channel:
+	// the distances of a band seen from each ear
+	virtual void MakeEchoBinMaps( const EchoImage & image, EchoBinMap bin_maps[2] )const;
+	// Bins the points into the echo image and renders the histograms of both channels it gives
+	void RenderEchoImageToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n,
+			audio_t max_amplitude
+			);
+	// Number of counts that corresponds to one point
+	unsigned int CountsPerPoint()const;
+	// Plan of the pings at this frequency, built by the first ping that needs it
+	const RenderPlan & GetRenderPlan( float frequency, float frequency_doubling_time, unsigned int sound_n );
+	// The counts smoothed as set by SetSmoothing (the counts themselves if there is no smoothing)
+	const unsigned int * SmoothCounts( const unsigned int counts[] );
+	// Renders a histogram of counts over the distance bins to one channel of the mix bus
+	// (directly to sound_out in the fixed point build)
+	virtual void RenderCountsToSound(
+			const unsigned int counts[],
+			const unsigned int amp_div, //!< counts are divided by this number to get loudness
+			audio_t sound_out[],
+			unsigned int sound_n,
+			int channel,
+			float frequency,
+			audio_t max_amplitude,
+			bool set_not_add,
+			float frequency_doubling_length,
+			float background_amplitude,
+			float * amplitude_values
+			);
+	// Saturates the mix bus into sound_out, once at the end of a ping
+	virtual void MixBusToSound( audio_t sound_out[], unsigned int sound_n );
 	void RenderDistanceToSound(
 			float x, float y, float z,
-			const rs2::vertex * vertices, const unsigned int n_vertices,
+			const Vertex * vertices, const unsigned int n_vertices,
 			int channel,
 			audio_t sound_out[],
 			unsigned int sound_n,
@@ -125,20 +289,80 @@ public:
 	const float lower_freq_doubling_length;
 	const float lower_amplitude;
 	const bool save_loudness;
+	const DistanceMapping * const distance_mapping; //!< owned by the renderer
 	const unsigned int max_counter; //!< counters go [0] to [max_counter-1]
 	const int num_counters;
-private:
+protected:
 	unsigned int **counters; //!< an array of counts for each omp thread
+	SurfaceNormalEstimator * normal_estimator;
+	const WeightMap * weight_map;
+	const uint16_t * point_weights; //!< NULL if points are not weighted
+	std::vector<uint16_t> combined_weights; //!< the scattering weights times the weight map
+	std::vector<PointSpan> all_points; //!< spans of the whole pointcloud, if there is no weight map
+	std::vector<PointSpan> all_rows; //!< spans of the rows of the whole pointcloud, if there is no weight map
+	EchoImage * echo_image; //!< NULL if the points are binned for each channel
+	EchoBinMap echo_bin_maps[2]; //!< see MakeEchoBinMaps
+	std::vector<RenderPlan *> render_plans; //!< one for each frequency the renderer uses
+	float smoothing_sigma; //!< [bins], no smoothing if not positive
+	unsigned int * smoothed_counts; //!< size max_counter
+	double * smoothing_scratch; //!< size max_counter, see ApplyRecursiveGaussianSmoothing
+	std::vector<float> mix_bus; //!< the pings are mixed in float, channel after channel, sound_n samples each
+	bool synthesize; //!< if false, the sound is not rendered
 public:
 	const unsigned int loudness_n_per_channel;
 	const float * get_loudness_data()const
 	{ return loudness_data; }
 	const float * get_amplitudes_data()const
 	{ return amplitudes_data; }
-private:
+protected:
 	float * loudness_data; //! size 2*loudness_n_per_channel, interleaved data
 	float * amplitudes_data; //! size 2*loudness_n_per_channel, interleaved data
 };
 
+/* This class renders the horizontal angle at which a point is seen by the camera
+ * as the delay between the L and R channels
+ * (see SimpleDepthRenderer::RenderPointcloudToSoundDelayIsAngle).
+ * The delay of each column is precomputed from the camera intrinsics,
+ * proportional to the sine of its azimuth like the path difference between two ears,
+ * the image edge farthest from the optical axis having the max delay.
+ * The elevation can be rendered too, as a delay of both channels
+ * proportional to the sine of the elevation of each row (the upper rows later).
+ */
+class DelayIsAngleDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	DelayIsAngleDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency,
+		float freq_doubling_length,
+		float background_amplitude,
+		bool save_loudness,
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		float delay_distance_at_max_angle, //!< delay of the points at the image edge [m]
+		float elevation_delay_distance = 0., //!< delay of the points at the top or bottom image edge [m], 0 for none
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const float delay_distance_at_max_angle;
+	const float elevation_delay_distance;
+	const float * get_column_delay()const //!< camera_w delay distances [m]
+	{ return &column_delay[0]; }
+	const float * get_row_delay()const //!< camera_h delay distances [m]
+	{ return &row_delay[0]; }
+protected:
+	// The bins of each band delayed for the L channel and advanced for the R channel
+	virtual void MakeEchoBinMaps( const EchoImage & image, EchoBinMap bin_maps[2] )const;
+private:
+	std::vector<float> column_delay; //!< L delay distance of each column, the R channel is advanced as much [m]
+	std::vector<float> row_delay; //!< delay distance of each row [m]
+};
+
 
 #endif /* SRC_SOUNDRENDERER_H_ */
@@ -0,0 +1,151 @@
+/*
+ * SpectralDepthRenderer.cpp
+ */
+
+#include "SpectralDepthRenderer.h"
+#include "RenderPlan.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+// Power of two nearest to the samples of a duration
+unsigned int FrameSize( float duration, unsigned int sample_rate )
+{
+	const unsigned int samples = max( (unsigned int)( duration * sample_rate ), 16u );
+	const unsigned int n = FFT::SizeFor( samples );
+	return n/2 * M_SQRT2 >= samples ? n/2 : n;
+}
+}
+
+SpectralDepthRenderer::SpectralDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	float stereo_distance,
+	bool save_loudness,
+	float frame_duration,
+	float octaves,
+	bool coherent_phase,
+	unsigned int n_frames,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, -1., 0., // neither chirped carrier nor background
+		stereo_distance,
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 fft( FrameSize( frame_duration, this->distance_mapping->sample_rate ) ),
+	 coherent_phase(coherent_phase),
+	 n_frames( max( n_frames, 1u ) ),
+	 frequency_bin( max_counter ),
+	 spectra( 2*(fft.n/2+1), 0.f ),
+	 window( fft.n ),
+	 frame( fft.n ),
+	 random_state(1)
+{
+	// nearer is higher, the frequencies stay below half of the sample rate
+	const unsigned int sample_rate = this->distance_mapping->sample_rate;
+	const float * bin_edges = this->distance_mapping->get_bin_edges();
+	for( unsigned int i=0; i<max_counter; ++i )
+	{
+		const float distance = 0.5 * (bin_edges[i] + bin_edges[i+1]);
+		const float frequency = base_frequency * pow( 2., octaves * (1. - min( distance / max_distance, 1.f )) );
+		frequency_bin[i] = min( max( (unsigned int)( frequency * fft.n / sample_rate + 0.5 ), 1u ), fft.n/2 - 1 );
+	}
+	for( unsigned int j=0; j<fft.n; ++j )
+		window[j] = 0.5 - 0.5*cos( 2*M_PI*j/fft.n );
+	cout << "Spectral frames : " << this->n_frames << " x " << fft.n << " samples, " <<
+			frequency_bin.back() << " - " << frequency_bin.front() << " of " << fft.n/2 << " frequency bins, " <<
+			(coherent_phase ? "coherent" : "random") << " phase" << endl;
+}
+
+void SpectralDepthRenderer::RenderCountsToSound(
+	const unsigned int counts[],
+	const unsigned int amp_div,
+	audio_t sound_out[],
+	unsigned int sound_n,
+	int channel,
+	float frequency,
+	audio_t max_amplitude,
+	bool set_not_add,
+	float frequency_doubling_length,
+	float background_amplitude,
+	float * amplitude_values
+	)
+{
+	counts = SmoothCounts( counts );
+	float * spectrum = &spectra[channel*(fft.n/2+1)];
+	if( set_not_add )
+		fill( spectrum, spectrum + fft.n/2+1, 0.f );
+
+	// the loudness of a bin is that of the sine renderers, without the equal loudness correction
+	const float * loudness_scale = distance_mapping->get_loudness_scale();
+	const float inv_max_expected = 1.f / amp_div;
+	for( unsigned int i=0; i<max_counter; ++i )
+	{
+		const float loudness = loudness_scale[i] * counts[i] * inv_max_expected;
+		const float amplitude = min( RenderPlan::AmplitudeOfLoudness( loudness ), 1.f ) * max_amplitude / audio_A;
+		if( amplitude_values != NULL )
+			amplitude_values[2*i+channel] = amplitude * audio_A / max_amplitude;
+		spectrum[frequency_bin[i]] += amplitude;
+	}
+}
+
+void SpectralDepthRenderer::MixBusToSound( audio_t sound_out[], unsigned int sound_n )
+{
+	if( synthesize == false )
+		return;
+	mix_bus.assign( 2*sound_n, 0.f );
+	float * left = &mix_bus[0];
+	float * right = &mix_bus[sound_n];
+	const unsigned int n = fft.n;
+	const float * spectrum_left = &spectra[0];
+	const float * spectrum_right = &spectra[n/2+1];
+	// Inverse scales by 1/n, a component of amplitude a has a coefficient of a*n/2 in bins k and n-k
+	const float scale = audio_A * n / 2.f;
+
+	for( unsigned int f=0; f<n_frames; ++f )
+	{
+		// Both ears share the phases, the L spectrum is the real part of the frame and the R spectrum the imaginary part
+		frame[0] = frame[n/2] = complex_t( 0.f, 0.f );
+		for( unsigned int k=1; k<n/2; ++k )
+		{
+			complex_t rotation;
+			if( coherent_phase )
+				rotation = complex_t( k % 2 == 0 ? 1.f : -1.f, 0.f ); // the components peak in the middle of the frame
+			else
+			{
+				random_state = random_state * 1664525u + 1013904223u;
+				const float phase = random_state * (2*M_PI / 4294967296.);
+				rotation = complex_t( cos( phase ), sin( phase ) );
+			}
+			const complex_t coefficient_left = scale * spectrum_left[k] * rotation;
+			const complex_t coefficient_right = scale * spectrum_right[k] * rotation;
+			frame[k] = coefficient_left + complex_t( 0.f, 1.f ) * coefficient_right;
+			frame[n-k] = conj( coefficient_left ) + complex_t( 0.f, 1.f ) * conj( coefficient_right );
+		}
+		fft.Inverse( &frame[0] );
+
+		// each frame is limited to the max amplitude
+		float peak = 0.f;
+		for( unsigned int j=0; j<n; ++j )
+			peak = max( peak, max( fabs( window[j]*frame[j].real() ), fabs( window[j]*frame[j].imag() ) ) );
+		const float gain = peak > audio_A ? audio_A / peak : 1.f;
+
+		const unsigned int start = f * n/2;
+		const unsigned int end = min( start + n, sound_n );
+		for( unsigned int j=start; j<end; ++j )
+		{
+			const float w = gain * window[j-start];
+			left[j] += w * frame[j-start].real();
+			right[j] += w * frame[j-start].imag();
+		}
+	}
+	SoundRenderer::ConvertMixBusToSound( left, right, sound_out, sound_n );
+}
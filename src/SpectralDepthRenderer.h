@@ -0,0 +1,66 @@
+/*
+ * SpectralDepthRenderer.h
+ */
+
+#ifndef SRC_SPECTRALDEPTHRENDERER_H_
+#define SRC_SPECTRALDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+#include "FFT.h"
+#include <vector>
+#include <stdint.h>
+
+/* This class renders all distances at once as a chord instead of echoes that arrive one after the other,
+ * so that far objects are heard as soon as near ones.
+ * Each distance bin is mapped to a frequency bin of an FFT frame of about frame_duration
+ * (nearer is higher, from the base frequency at max distance up by octaves),
+ * the spectra of both ears are synthesized by one inverse FFT with random or coherent phases,
+ * and the Hann windowed frames are overlap-added by half of a frame.
+ * The synthesis does not depend on the number of distance bins, only on the frame size.
+ */
+class SpectralDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	SpectralDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency, //!< frequency of max distance [Hz]
+		float stereo_distance,
+		bool save_loudness,
+		float frame_duration, //!< [s], rounded to the nearest FFT size
+		float octaves, //!< the frequency of the nearest distance is this many octaves above the base frequency
+		bool coherent_phase, //!< all components peak in the middle of a frame (a click) instead of random phases (a noise)
+		unsigned int n_frames, //!< frames of each ping
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+protected:
+	// Adds the amplitudes of the counts to the spectrum of one channel
+	virtual void RenderCountsToSound(
+			const unsigned int counts[],
+			const unsigned int amp_div,
+			audio_t sound_out[],
+			unsigned int sound_n,
+			int channel,
+			float frequency,
+			audio_t max_amplitude,
+			bool set_not_add,
+			float frequency_doubling_length,
+			float background_amplitude,
+			float * amplitude_values
+			);
+	// Synthesizes the frames of the spectra
+	virtual void MixBusToSound( audio_t sound_out[], unsigned int sound_n );
+public:
+	const FFT fft; //!< of one frame
+	const bool coherent_phase;
+	const unsigned int n_frames;
+private:
+	std::vector<unsigned int> frequency_bin; //!< FFT bin of each distance bin
+	std::vector<float> spectra; //!< amplitude of each FFT bin up to n/2, the L then the R spectrum
+	std::vector<float> window; //!< periodic Hann window, sums to 1 at a hop of n/2
+	std::vector<complex_t> frame;
+	uint32_t random_state; //!< of the random phases
+};
+
+#endif /* SRC_SPECTRALDEPTHRENDERER_H_ */
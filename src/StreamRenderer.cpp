@@ -0,0 +1,109 @@
+/*
+ * StreamRenderer.cpp
+ */
+
+#include "StreamRenderer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+StreamRenderer::StreamRenderer(
+	const DistanceMapping & mapping,
+	float base_frequency,
+	float frequency_doubling_time,
+	unsigned int period_n
+	)
+	:period_n( max( period_n, 1u ) ),
+	 n_bins(mapping.n_bins),
+	 plan( mapping, base_frequency, frequency_doubling_time, this->period_n ),
+	 back(0),
+	 middle(1),
+	 front(2),
+	 previous( 2*n_bins, 0.f ),
+	 has_frame(false),
+	 position(0),
+	 bin(0)
+{
+	for( unsigned int i=0; i<3; ++i )
+		frames[i].assign( 2*n_bins, 0.f );
+}
+
+bool StreamRenderer::Matches(
+	const DistanceMapping & mapping,
+	float base_frequency,
+	float frequency_doubling_time,
+	unsigned int period_n
+	)const
+{
+	period_n = max( period_n, 1u );
+	if( mapping.n_bins != n_bins || plan.Matches( base_frequency, frequency_doubling_time, period_n ) == false )
+		return false;
+	const unsigned int * mapping_edges = mapping.get_sample_edges();
+	const unsigned int * sample_edges = plan.get_sample_edges();
+	for( unsigned int i=0; i<=n_bins; ++i )
+		if( min( mapping_edges[i], period_n ) != sample_edges[i] )
+			return false;
+	return true;
+}
+
+bool StreamRenderer::Publish( const float amplitudes[], unsigned int n_bins )
+{
+	if( n_bins != this->n_bins )
+		return false;
+	memcpy( &frames[back][0], amplitudes, 2*n_bins*sizeof(float) );
+	back = middle.exchange( back | fresh ) & index_mask;
+	return true;
+}
+
+void StreamRenderer::RenderBlock( audio_t sound_out[], unsigned int n )
+{
+	bool fading = false;
+	if( middle.load() & fresh )
+	{
+		memcpy( &previous[0], &frames[front][0], 2*n_bins*sizeof(float) );
+		front = middle.exchange( front ) & index_mask;
+		fading = has_frame;
+		has_frame = true;
+	}
+	if( has_frame == false )
+	{
+		memset( sound_out, 0, 2*n*sizeof(audio_t) );
+		return;
+	}
+
+	const unsigned int * sample_edges = plan.get_sample_edges();
+	const float * carrier = plan.get_carrier();
+	const float * amplitudes = &frames[front][0];
+	const float fade_step = 1.f / n;
+	for( unsigned int j=0; j<n; ++j )
+	{
+		while( bin < n_bins && position >= sample_edges[bin+1] )
+			++bin;
+		if( bin < n_bins )
+		{
+			float amplitude_l = amplitudes[2*bin];
+			float amplitude_r = amplitudes[2*bin+1];
+			if( fading )
+			{
+				const float w = (j+1) * fade_step;
+				amplitude_l = previous[2*bin] + w * (amplitude_l - previous[2*bin]);
+				amplitude_r = previous[2*bin+1] + w * (amplitude_r - previous[2*bin+1]);
+			}
+			const float signal = audio_A * carrier[position];
+			sound_out[2*j] = (audio_t)( min( amplitude_l, 1.f ) * signal );
+			sound_out[2*j+1] = (audio_t)( min( amplitude_r, 1.f ) * signal );
+		}
+		else
+		{
+			// the carrier ends with the last bin, the rest of the period is silent
+			sound_out[2*j] = 0;
+			sound_out[2*j+1] = 0;
+		}
+		if( ++position == period_n )
+		{
+			position = 0;
+			bin = 0;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * StreamRenderer.h
+ */
+
+#ifndef SRC_STREAMRENDERER_H_
+#define SRC_STREAMRENDERER_H_
+
+#include "Defaults.h"
+#include "RenderPlan.h"
+#include <atomic>
+#include <vector>
+
+/* This class renders a continuous sound in the blocks that the audio device asks for,
+ * instead of one ping per frame played as a whole.
+ * The ping repeats every period_n samples with the carrier of a RenderPlan,
+ * its amplitudes are the most recent ones published by the rendering thread
+ * (the amplitudes saved by a SimpleDepthRenderer, see SimpleDepthRenderer::SetSynthesis),
+ * and a new frame is crossfaded in over one block.
+ * The frames are exchanged through three preallocated buffers and an atomic index,
+ * so that neither Publish nor RenderBlock ever waits for the other or allocates memory.
+ */
+class StreamRenderer
+{
+public:
+	StreamRenderer(
+		const DistanceMapping & mapping,
+		float base_frequency, //!< [Hz]
+		float frequency_doubling_time, //!< [s], constant frequency if not positive
+		unsigned int period_n //!< samples per channel between the starts of two pings
+			);
+	// True if the stream plays the ping that a stream of these parameters would play,
+	// so that the amplitudes of a renderer with them can be published
+	bool Matches(
+			const DistanceMapping & mapping,
+			float base_frequency,
+			float frequency_doubling_time,
+			unsigned int period_n
+			)const;
+	// Called by the rendering thread: the amplitudes of the bins (fractions of audio_A),
+	// L and R interleaved, n_bins values per channel. Returns false if there is another number of bins
+	bool Publish( const float amplitudes[], unsigned int n_bins );
+	// Called by the audio thread: renders n interleaved stereo samples
+	void RenderBlock( audio_t sound_out[], unsigned int n );
+
+	const unsigned int period_n;
+	const unsigned int n_bins;
+private:
+	static const unsigned int fresh = 4; //!< flag of the middle buffer index, set when published
+	static const unsigned int index_mask = 3;
+
+	RenderPlan plan; //!< over the whole period, the carrier repeats with the ping
+	std::vector<float> frames[3]; //!< 2*n_bins amplitudes, the back, middle and front buffers in turn
+	unsigned int back; //!< written by Publish
+	std::atomic<unsigned int> middle; //!< index and fresh flag of the last published frame
+	unsigned int front; //!< read by RenderBlock
+	std::vector<float> previous; //!< the frame faded out
+	bool has_frame; //!< silence until the first frame was published
+	unsigned int position; //!< sample of the ping
+	unsigned int bin; //!< bin of the position
+};
+
+#endif /* SRC_STREAMRENDERER_H_ */
@@ -0,0 +1,90 @@
+/*
+ * SurfaceNormals.cpp
+ */
+
+#include "SurfaceNormals.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+SurfaceNormalEstimator::SurfaceNormalEstimator(
+	unsigned int camera_w,
+	unsigned int camera_h,
+	float vertical_gain,
+	float horizontal_gain
+	)
+	:camera_w(camera_w),
+	 camera_h(camera_h),
+	 vertical_gain(vertical_gain),
+	 horizontal_gain(horizontal_gain)
+{
+	weights = new uint16_t [camera_w*camera_h];
+	surface_classes = new uint8_t [camera_w*camera_h];
+	for( unsigned int i=0; i<camera_w*camera_h; ++i )
+	{
+		weights[i] = weight_unit;
+		surface_classes[i] = SurfaceUnknown;
+	}
+}
+
+SurfaceNormalEstimator::~SurfaceNormalEstimator()
+{
+	delete [] weights;
+	delete [] surface_classes;
+}
+
+bool SurfaceNormalEstimator::Compute( const Vertex * vertices, const unsigned int n_vertices )
+{
+	if( n_vertices != camera_w*camera_h )
+	{
+		cerr << "Surface normals expect " << camera_w*camera_h << " vertices, got " << n_vertices << endl;
+		return false;
+	}
+	const int w = camera_w;
+	const int h = camera_h;
+	const float k_vertical = vertical_gain * weight_unit;
+	const float k_horizontal = horizontal_gain * weight_unit;
+
+	// Border rows and columns have no neighbours and keep the neutral weight set in the constructor.
+	// Normal is the cross product of the central differences along the image rows and columns,
+	// the inner loop is free of branches so that it can be vectorized.
+#pragma omp parallel for
+	for( int y=1; y<h-1; ++y )
+	{
+		const Vertex * row = &vertices[y*w];
+		const Vertex * row_up = &vertices[(y-1)*w];
+		const Vertex * row_down = &vertices[(y+1)*w];
+		uint16_t * weights_row = &weights[y*w];
+		uint8_t * classes_row = &surface_classes[y*w];
+#pragma omp simd
+		for( int x=1; x<w-1; ++x )
+		{
+			const float ux = row[x+1].x - row[x-1].x;
+			const float uy = row[x+1].y - row[x-1].y;
+			const float uz = row[x+1].z - row[x-1].z;
+			const float vx = row_down[x].x - row_up[x].x;
+			const float vy = row_down[x].y - row_up[x].y;
+			const float vz = row_down[x].z - row_up[x].z;
+			const float nx = uy*vz - uz*vy;
+			const float ny = uz*vx - ux*vz;
+			const float nz = ux*vy - uy*vx;
+			const float nn = nx*nx + ny*ny + nz*nz;
+			const Vertex & p = row[x];
+			const float pp = p.x*p.x + p.y*p.y + p.z*p.z;
+			const float np = nx*p.x + ny*p.y + nz*p.z;
+
+			const bool valid = (row[x-1].z > 0.0001f) & (row[x+1].z > 0.0001f) &
+					(row_up[x].z > 0.0001f) & (row_down[x].z > 0.0001f) &
+					(p.z > 0.0001f) & (nn > 0.f);
+			// camera y axis points down, so floor normals have large y components (more than 45 deg)
+			const bool horizontal = ny*ny > 0.5f*nn;
+			const float cos_angle = sqrt( (np*np) / (valid ? nn*pp : 1.f) );
+			const float weight_f = cos_angle * (horizontal ? k_horizontal : k_vertical);
+			const float weight = weight_f < weight_max ? weight_f : weight_max;
+			weights_row[x] = valid ? (uint16_t)(weight + 0.5f) : (uint16_t)weight_unit;
+			classes_row[x] = valid ? (horizontal ? SurfaceHorizontal : SurfaceVertical) : SurfaceUnknown;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * SurfaceNormals.h
+ */
+
+#ifndef SRC_SURFACENORMALS_H_
+#define SRC_SURFACENORMALS_H_
+
+#include <stdint.h>
+#include "PointCloud.h"
+
+enum SurfaceClass { SurfaceUnknown = 0, SurfaceVertical = 1, SurfaceHorizontal = 2 };
+
+/* This class estimates the surface normals of an organized pointcloud
+ * (vertices in camera_w x camera_h image layout) and converts them to
+ * per-point scattering weights: surfaces facing the listener echo louder
+ * than tilted surfaces (cosine of the angle between the normal and the
+ * direction to the listener).
+ * Surfaces are also classified as vertical (walls) or horizontal (floor),
+ * and each class has its own gain.
+ */
+class SurfaceNormalEstimator
+{
+public:
+	SurfaceNormalEstimator(
+		unsigned int camera_w,
+		unsigned int camera_h,
+		float vertical_gain, //!< gain for vertical surfaces (walls, obstacles)
+		float horizontal_gain //!< gain for horizontal surfaces (floor, ceiling, table)
+			);
+	~SurfaceNormalEstimator();
+	// Computes the weights and surface classes, returns false if the pointcloud has an unexpected size
+	bool Compute( const Vertex * vertices, const unsigned int n_vertices );
+	const uint16_t * get_weights()const
+	{ return weights; }
+	const uint8_t * get_surface_classes()const
+	{ return surface_classes; }
+
+	static const unsigned int weight_unit = 256; //!< weight of a point that counts as a single unweighted point
+	static const unsigned int weight_max = 16*weight_unit;
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const float vertical_gain;
+	const float horizontal_gain;
+private:
+	uint16_t * weights; //!< size camera_w*camera_h
+	uint8_t * surface_classes; //!< SurfaceClass of each point, size camera_w*camera_h
+};
+
+#endif /* SRC_SURFACENORMALS_H_ */
@@ -0,0 +1,201 @@
+/*
+ * SweepDepthRenderer.cpp
+ */
+
+#include "SweepDepthRenderer.h"
+#include "RenderPlan.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+
+using namespace std;
+
+namespace
+{
+const unsigned int sin_bits = 10; //!< the sine table has 2^sin_bits entries per period
+
+std::vector<float> MakeSinTable()
+{
+	const unsigned int n = 1 << sin_bits;
+	std::vector<float> table( n+1 );
+	for( unsigned int i=0; i<=n; ++i )
+		table[i] = sin( 2*M_PI*i/n );
+	return table;
+}
+
+// Sine of a phase given as an unsigned 32 bit fraction of a period, interpolated linearly
+inline float SinOfPhase( const float * sin_table, uint32_t phase )
+{
+	const uint32_t i = phase >> (32 - sin_bits);
+	const float frac = (phase & ((1u << (32 - sin_bits)) - 1)) * (1.f / (1u << (32 - sin_bits)));
+	return sin_table[i] + frac * (sin_table[i+1] - sin_table[i]);
+}
+}
+
+const float SweepDepthRenderer::near_fraction = 0.05;
+
+SweepDepthRenderer::SweepDepthRenderer(
+	float max_distance,
+	float step_distance,
+	float speed_of_sound,
+	float base_frequency,
+	bool save_loudness,
+	const CameraIntrinsics & intrinsics,
+	unsigned int num_bands,
+	float octaves,
+	DistanceMapping * distance_mapping
+	)
+	:SimpleDepthRenderer(
+		max_distance, step_distance, speed_of_sound,
+		base_frequency, -1., 0., // the pitch is set by the distance
+		0., // the sweep pans
+		-1., 0., -1., 0., // no lower renderer
+		save_loudness, distance_mapping ),
+	 camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 num_bands( max( 1u, min( num_bands, (unsigned int)intrinsics.width ) ) ),
+	 octaves(octaves),
+	 band_image( *this->distance_mapping, intrinsics, this->num_bands )
+{
+	// near bins are high, max distance is the base frequency
+	const float * bin_edges = this->distance_mapping->get_bin_edges();
+	bin_frequency = new float [max_counter];
+	for( unsigned int i=0; i<max_counter; ++i )
+	{
+		const float distance = 0.5 * (bin_edges[i] + bin_edges[i+1]);
+		bin_frequency[i] = base_frequency * pow( 2., octaves * (1. - min( distance / max_distance, 1.f )) );
+	}
+	cout << "Sweep : " << this->num_bands << " column bands, " << base_frequency << " - " <<
+			base_frequency * pow( 2., octaves ) << " Hz" << endl;
+
+	band_frequency = new float [this->num_bands];
+	band_amplitude = new float [this->num_bands];
+}
+
+SweepDepthRenderer::~SweepDepthRenderer()
+{
+	delete [] bin_frequency;
+	delete [] band_frequency;
+	delete [] band_amplitude;
+}
+
+void SweepDepthRenderer::RenderPointcloudToSound(
+	const Vertex * vertices, const unsigned int n_vertices,
+	audio_t sound_out[],
+	unsigned int sound_n )
+{
+	if( n_vertices != camera_w*camera_h )
+	{
+		cerr << "Sweep renderer expects " << camera_w*camera_h << " vertices, got " << n_vertices;
+		cerr << ", rendering without the sweep" << endl;
+		SimpleDepthRenderer::RenderPointcloudToSound( vertices, n_vertices, sound_out, sound_n );
+		return;
+	}
+	UpdatePointWeights( vertices, n_vertices );
+
+	// One pass over the rows: all column bands are binned at once
+	ComputeEchoImage( band_image, vertices, n_vertices );
+
+	// The pitch of a band is the bin where the prefix sum of its histogram reaches near_fraction of the band,
+	// the loudness is the part of the band within max distance
+	if( save_loudness )
+	{
+		for( int i=0; i<2*loudness_n_per_channel; ++i )
+			amplitudes_data[i] = 0.;
+	}
+	for( unsigned int k=0; k<num_bands; ++k )
+	{
+		const unsigned int * counts = SmoothCounts( band_image.get_band_counts(k) );
+		const float band_counts = (float)band_image.get_band_columns(k) * camera_h * CountsPerPoint();
+		const float near_counts = max( near_fraction * band_counts, 1.f );
+		unsigned int prefix = 0;
+		unsigned int near_bin = max_counter;
+		for( unsigned int i=0; i<max_counter; ++i )
+		{
+			prefix += counts[i];
+			if( near_bin == max_counter && prefix >= near_counts )
+				near_bin = i;
+		}
+		if( near_bin == max_counter )
+		{
+			band_frequency[k] = base_frequency;
+			band_amplitude[k] = 0.;
+			continue;
+		}
+		band_frequency[k] = bin_frequency[near_bin];
+		band_amplitude[k] = min( RenderPlan::AmplitudeOfLoudness( prefix / band_counts ), 1.f );
+		if( save_loudness && near_bin < (unsigned int)loudness_n_per_channel )
+		{
+			// the amplitude of the band at the bin of its pitch
+			const float pan = num_bands > 1 ? (float)k / (num_bands-1) : 0.5;
+			amplitudes_data[2*near_bin] += band_amplitude[k] * cos( pan * M_PI/2 );
+			amplitudes_data[2*near_bin+1] += band_amplitude[k] * sin( pan * M_PI/2 );
+		}
+	}
+
+	if( synthesize )
+		Synthesize( sound_out, sound_n );
+
+	if( save_loudness )
+	{
+		// the loudness of all bands together, the same for both ears
+		const unsigned int amp_div = (n_vertices / 25.0) / (0.1/step_distance) * 10 * CountsPerPoint();
+#pragma omp parallel for
+		for( int i=0; i<loudness_n_per_channel; ++i )
+		{
+			unsigned int counts = 0;
+			for( unsigned int k=0; k<num_bands; ++k )
+				counts += band_image.get_band_counts(k)[i];
+			loudness_data[2*i] = loudness_data[2*i+1] = ((float)counts) / amp_div;
+		}
+	}
+}
+
+void SweepDepthRenderer::Synthesize( audio_t sound_out[], unsigned int sound_n )
+{
+	// the tables are built by the first call
+	static const std::vector<float> sin_table_data = MakeSinTable();
+	const float * sin_table = &sin_table_data[0];
+
+	if( mix_bus.size() != 2*sound_n )
+		mix_bus.resize( 2*sound_n );
+	float * left = &mix_bus[0];
+	float * right = &mix_bus[sound_n];
+	const unsigned int sample_rate = distance_mapping->sample_rate;
+	// the sweep lasts as long as the echoes of the other modes
+	const unsigned int sweep_n = min( distance_mapping->get_sample_edges()[distance_mapping->n_bins], sound_n );
+	const unsigned int slot_n = max( sweep_n / num_bands, 1u );
+	// the amplitudes glide from band to band over 5 ms, so that the slots do not click
+	const unsigned int ramp_n = max( min( slot_n, sample_rate / 200 ), 1u );
+
+	uint32_t phase = 0;
+	uint32_t phase_step = 0;
+	float previous_left = 0., previous_right = 0.;
+	// the slot after the last band fades the sweep out
+	for( unsigned int k=0; k<=num_bands; ++k )
+	{
+		const unsigned int start = min( k*slot_n, sound_n );
+		const unsigned int end = k < num_bands ? min( start + slot_n, sound_n ) : sound_n;
+		float target_left = 0., target_right = 0.;
+		if( k < num_bands )
+		{
+			const float pan = num_bands > 1 ? (float)k / (num_bands-1) : 0.5;
+			target_left = audio_A * band_amplitude[k] * cos( pan * M_PI/2 );
+			target_right = audio_A * band_amplitude[k] * sin( pan * M_PI/2 );
+			phase_step = (uint32_t)( band_frequency[k] / sample_rate * 4294967296. );
+		}
+		const float ramp_step = 1.f / ramp_n;
+		for( unsigned int j=start; j<end; ++j )
+		{
+			const float w = j-start < ramp_n ? (j-start+1) * ramp_step : 1.f;
+			const float s = SinOfPhase( sin_table, phase );
+			phase += phase_step;
+			left[j] = (previous_left + w * (target_left - previous_left)) * s;
+			right[j] = (previous_right + w * (target_right - previous_right)) * s;
+		}
+		previous_left = target_left;
+		previous_right = target_right;
+	}
+	SoundRenderer::ConvertMixBusToSound( left, right, sound_out, sound_n );
+}
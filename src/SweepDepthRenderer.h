@@ -0,0 +1,57 @@
+/*
+ * SweepDepthRenderer.h
+ */
+
+#ifndef SRC_SWEEPDEPTHRENDERER_H_
+#define SRC_SWEEPDEPTHRENDERER_H_
+
+#include "SoundRenderer.h"
+
+/* This class scans the image from left to right over the duration of the ping,
+ * like the vOICe, instead of rendering the distances as echo delays.
+ * The image columns are split into bands, and the points are binned into
+ * the distance histograms of the column bands by an echo image.
+ * Each band is then rendered as a tone in its own time slot, panned from left to right:
+ * the pitch of the tone rises with the nearness of the band
+ * (the distance within which near_fraction of the band is seen, read from the prefix sums of its histogram),
+ * and its loudness with the part of the band seen within max distance.
+ */
+class SweepDepthRenderer: public SimpleDepthRenderer
+{
+public:
+	SweepDepthRenderer(
+		float max_distance,
+		float step_distance,
+		float speed_of_sound,
+		float base_frequency, //!< pitch of max distance [Hz]
+		bool save_loudness,
+		const CameraIntrinsics & intrinsics, //!< depth camera intrinsics, vertices are presumed to be in the same layout
+		unsigned int num_bands, //!< number of column bands
+		float octaves, //!< the pitch of the nearest distance is this many octaves above the base frequency
+		DistanceMapping * distance_mapping = NULL //!< renderer takes ownership, NULL for linear mapping
+			);
+	virtual ~SweepDepthRenderer();
+	virtual void RenderPointcloudToSound(
+			const Vertex * vertices, const unsigned int n_vertices,
+			audio_t sound_out[],
+			unsigned int sound_n );
+	float get_band_frequency( unsigned int band )const
+	{ return band_frequency[band]; }
+	float get_band_amplitude( unsigned int band )const //!< fraction of audio_A
+	{ return band_amplitude[band]; }
+public:
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+	const unsigned int num_bands;
+	const float octaves;
+	static const float near_fraction; //!< part of a band that sets its pitch
+private:
+	void Synthesize( audio_t sound_out[], unsigned int sound_n );
+
+	EchoImage band_image; //!< distance histogram of each band
+	float * bin_frequency; //!< pitch of each distance bin
+	float * band_frequency; //!< pitch of each band in the last ping
+	float * band_amplitude; //!< amplitude of each band in the last ping
+};
+
+#endif /* SRC_SWEEPDEPTHRENDERER_H_ */
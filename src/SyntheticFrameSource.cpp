@@ -0,0 +1,54 @@
+/*
+ * SyntheticFrameSource.cpp
+ */
+
+#include "SyntheticFrameSource.h"
+#include <thread>
+#include <iostream>
+
+using namespace std;
+
+SyntheticFrameSource::SyntheticFrameSource(
+		int camera_w,
+		int camera_h,
+		int fps,
+		SceneType scene_type,
+		float horizontal_fov
+		)
+	:fps(fps),
+	 scene( scene_type, SceneGenerator::MakeIntrinsics( camera_w, camera_h, horizontal_fov ) ),
+	 depth( camera_w*camera_h ),
+	 frame_number(0),
+	 time_start( std::chrono::steady_clock::now() )
+{
+	cout << "Synthetic frames " << camera_w << "x" << camera_h << " at " << fps << " fps" << endl;
+}
+
+bool SyntheticFrameSource::WaitForFrame( Frame & frame )
+{
+	// frames come at the frame rate, late frames are not caught up with
+	const std::chrono::steady_clock::time_point time_frame = time_start +
+			std::chrono::microseconds( (long long)(frame_number * 1000000ull / fps) );
+	const std::chrono::steady_clock::time_point time_now = std::chrono::steady_clock::now();
+	if( time_now < time_frame )
+		std::this_thread::sleep_until( time_frame );
+	else
+		frame_number = (unsigned long long)(
+				std::chrono::duration_cast<std::chrono::microseconds>(time_now - time_start).count() * fps / 1000000ull );
+
+	const unsigned int n = depth.size();
+	// a buffer still held by a previous frame is left to it
+	if( !buffer || buffer.use_count() > 1 )
+		buffer = std::make_shared<std::vector<Vertex> >( n );
+	frame.time_of_arrival = Now();
+	scene.RenderDepth( (float)frame_number / fps, &depth[0] );
+	scene.DeprojectDepth( &depth[0], &(*buffer)[0] );
+	frame.vertices = &(*buffer)[0];
+	frame.n_vertices = n;
+	frame.frame_number = frame_number;
+	frame.color.data = NULL;
+	frame.aligned_color.data = NULL;
+	frame.owner = buffer;
+	++frame_number;
+	return true;
+}
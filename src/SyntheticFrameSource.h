@@ -0,0 +1,46 @@
+/*
+ * SyntheticFrameSource.h
+ */
+
+#ifndef SRC_SYNTHETICFRAMESOURCE_H_
+#define SRC_SYNTHETICFRAMESOURCE_H_
+
+#include "FrameSource.h"
+#include "SceneGenerator.h"
+#include <chrono>
+#include <vector>
+
+/* This class generates depth frames without a camera, for running the whole
+ * rendering loop on machines without one.
+ * The frames are ray cast by a SceneGenerator into Z16 depth images, which are
+ * deprojected like camera frames, so the depth is quantized as from the camera.
+ * Frames are delivered in real time at the given frame rate, like from a camera.
+ */
+class SyntheticFrameSource: public FrameSource
+{
+public:
+	SyntheticFrameSource(
+			int camera_w,
+			int camera_h,
+			int fps,
+			SceneType scene_type,
+			float horizontal_fov = 1.5 //!< [rad], about as wide as the depth camera
+			);
+	virtual bool WaitForFrame( Frame & frame );
+	virtual bool is_live()const
+	{ return true; }
+	virtual CameraIntrinsics get_intrinsics()const
+	{ return scene.intrinsics; }
+	const SceneGenerator & get_scene()const
+	{ return scene; }
+
+	const int fps;
+private:
+	SceneGenerator scene;
+	std::vector<uint16_t> depth;
+	unsigned long long frame_number;
+	std::chrono::steady_clock::time_point time_start;
+	std::shared_ptr<std::vector<Vertex> > buffer; //!< reused when no frame holds it any more
+};
+
+#endif /* SRC_SYNTHETICFRAMESOURCE_H_ */
@@ -0,0 +1,115 @@
+/*
+ * WeightMap.cpp
+ */
+
+#include "WeightMap.h"
+#include "SurfaceNormals.h"
+#include <cmath>
+#include <sstream>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+// Weight of a term at a pixel, 0 to 1
+float TermWeight( const WeightTerm & term, unsigned int v, unsigned int camera_h, float cos_angle )
+{
+	switch( term.type )
+	{
+	case WeightCone:
+	{
+		const float angle = acos( cos_angle ) * 180. / M_PI;
+		if( angle <= term.angle )
+			return 1.;
+		if( term.edge <= 0. || angle >= term.angle + term.edge )
+			return 0.;
+		return 0.5 + 0.5*cos( M_PI * (angle - term.angle) / term.edge );
+	}
+	case WeightTop:
+		return v < (camera_h+1)/2 ? 1. : 0.;
+	case WeightBottom:
+		return v < (camera_h+1)/2 ? 0. : 1.;
+	case WeightRows:
+	{
+		const unsigned int row_begin = min( (unsigned int)( max( term.row_top, 0.f ) * camera_h + 0.5 ), camera_h );
+		const unsigned int row_end = min( (unsigned int)( max( term.row_bottom, 0.f ) * camera_h + 0.5 ), camera_h );
+		return v >= row_begin && v < row_end ? 1. : 0.;
+	}
+	case WeightSolidAngle:
+		// a pixel sees a solid angle proportional to the cube of the cosine of its angle to the optical axis
+		return cos_angle * cos_angle * cos_angle;
+	}
+	return 1.;
+}
+}
+
+WeightMap::WeightMap(
+	const std::vector<WeightTerm> & terms,
+	const CameraIntrinsics & intrinsics
+	)
+	:camera_w(intrinsics.width),
+	 camera_h(intrinsics.height),
+	 weights( camera_w*camera_h ),
+	 n_weighted(0)
+{
+	for( unsigned int v=0; v<camera_h; ++v )
+	{
+		PointSpan span = { (v+1)*camera_w, 0 };
+		for( unsigned int u=0; u<camera_w; ++u )
+		{
+			const float x = (u - intrinsics.ppx) / intrinsics.fx;
+			const float y = (v - intrinsics.ppy) / intrinsics.fy;
+			const float cos_angle = 1. / sqrt( 1. + x*x + y*y );
+			float weight = 1.;
+			for( unsigned int i=0; i<terms.size(); ++i )
+				weight *= TermWeight( terms[i], v, camera_h, cos_angle );
+			const unsigned int i = v*camera_w + u;
+			weights[i] = (uint16_t)( weight * SurfaceNormalEstimator::weight_unit + 0.5 );
+			if( weights[i] > 0 )
+			{
+				span.begin = min( span.begin, i );
+				span.end = i+1;
+			}
+		}
+		if( span.end > span.begin )
+		{
+			spans.push_back( span );
+			n_weighted += span.end - span.begin;
+		}
+	}
+	cout << "Weight map : " << spans.size() << " of " << camera_h << " rows, " <<
+			100. * n_weighted / (camera_w*camera_h) << " % of the pixels are rendered" << endl;
+}
+
+bool WeightMap::ParseTerms( const std::string & spec, std::vector<WeightTerm> & terms )
+{
+	terms.clear();
+	std::stringstream ss(spec);
+	std::string name;
+	while( std::getline( ss, name, '+' ) )
+	{
+		WeightTerm term = { WeightCone, 0., 0. };
+		if( name == "top" )
+			term.type = WeightTop;
+		else if( name == "bottom" )
+			term.type = WeightBottom;
+		else if( name == "solid-angle" )
+			term.type = WeightSolidAngle;
+		else
+		{
+			char separator;
+			std::stringstream ss_term(name);
+			std::string type;
+			if( !std::getline( ss_term, type, ':' ) || type != "cone" || !( ss_term >> term.angle ) ||
+					term.angle <= 0. ||
+					( ss_term >> separator && ( separator != ':' || !( ss_term >> term.edge ) || term.edge < 0. ) ) )
+			{
+				cerr << "Could not parse weight map term \"" << name << "\"" << endl;
+				return false;
+			}
+		}
+		terms.push_back(term);
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * WeightMap.h
+ */
+
+#ifndef SRC_WEIGHTMAP_H_
+#define SRC_WEIGHTMAP_H_
+
+#include "PointCloud.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum WeightTermType { WeightCone, WeightTop, WeightBottom, WeightSolidAngle, WeightRows };
+
+struct WeightTerm
+{
+	WeightTermType type;
+	float angle; //!< half angle of a cone [deg]
+	float edge; //!< the cone fades out over this angle beyond the half angle [deg]
+	float row_top; //!< first row of a row range (fraction of image height)
+	float row_bottom; //!< end of the rows of a row range (fraction of image height)
+};
+
+// Points [begin, end) of a pointcloud
+struct PointSpan
+{
+	unsigned int begin;
+	unsigned int end;
+};
+
+/* This class holds a weight for each pixel of a camera resolution,
+ * the product of its terms, precomputed when the map is constructed:
+ * a focus cone around the optical axis, the top or bottom half of the image, a range of rows
+ * and the solid angle of the pixel (so that the edges of the image do not count more than the centre).
+ * The weights are in the units of the surface normal weights (SurfaceNormalEstimator::weight_unit),
+ * the spans hold the weighted pixels of each row, fully masked rows have no span,
+ * so that the renderers skip the masked pixels instead of binning them at zero weight.
+ */
+class WeightMap
+{
+public:
+	WeightMap(
+		const std::vector<WeightTerm> & terms,
+		const CameraIntrinsics & intrinsics
+			);
+	// Parses terms given as "<term>+<term>+...", a term is
+	// "cone:<half angle>[:<edge>]" [deg], "top", "bottom" or "solid-angle"
+	static bool ParseTerms( const std::string & spec, std::vector<WeightTerm> & terms );
+
+	const uint16_t * get_weights()const //!< camera_w*camera_h
+	{ return &weights[0]; }
+	const std::vector<PointSpan> & get_spans()const //!< weighted pixels of each row that has some
+	{ return spans; }
+	unsigned int get_n_weighted()const //!< number of pixels in the spans
+	{ return n_weighted; }
+
+	const unsigned int camera_w;
+	const unsigned int camera_h;
+private:
+	std::vector<uint16_t> weights;
+	std::vector<PointSpan> spans;
+	unsigned int n_weighted;
+};
+
+#endif /* SRC_WEIGHTMAP_H_ */
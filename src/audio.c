@@ -135,6 +135,11 @@ void playMusicFromMemory(Audio * audio, int volume)
 }
 
 void initAudio(void)
+{
+    initAudioAtFrequency(AUDIO_FREQUENCY);
+}
+
+void initAudioAtFrequency(int frequency)
 {
     Audio * global;
     gDevice = calloc(1, sizeof(PrivateAudioDevice));
@@ -156,7 +161,7 @@ void initAudio(void)
 
     SDL_memset(&(gDevice->want), 0, sizeof(gDevice->want));
 
-    (gDevice->want).freq = AUDIO_FREQUENCY;
+    (gDevice->want).freq = frequency;
     (gDevice->want).format = AUDIO_FORMAT;
     (gDevice->want).channels = AUDIO_CHANNELS;
     (gDevice->want).samples = AUDIO_SAMPLES;
@@ -124,6 +124,12 @@ void endAudio(void);
  */
 void initAudio(void);
 
+/*
+ * Initialize Audio Variable, with the device opened at the specified sample rate
+ *
+ */
+void initAudioAtFrequency(int frequency);
+
 /*
  * Pause audio from playing
  *
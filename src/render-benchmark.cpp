@@ -0,0 +1,218 @@
+/*
+ * render-benchmark.cpp
+ *
+ * Renders generated scenes with each depth rendering mode,
+ * measures the rendering times and compares the distance histograms
+ * of the renderers with the exact histograms of the scene.
+ * Needs no camera and no sound device.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include "argh.h"
+
+#include "SoundRenderer.h"
+#include "RenderPlan.h"
+#include "FixedPoint.h"
+#include "SurfaceNormals.h"
+#include "SceneGenerator.h"
+#include "RendererParameters.h"
+#include "RendererRegistry.h"
+
+using namespace std;
+
+namespace
+{
+double ms_since( std::chrono::high_resolution_clock::time_point t0 )
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::high_resolution_clock::now() - t0 ).count() / 1000.;
+}
+
+// Half of the L1 distance of the normalized histograms, the fraction of the echo in wrong bins
+double HistogramDifference( const float * loudness, unsigned int channel,
+		const unsigned int * counts, unsigned int n )
+{
+	double sum_loudness = 0., sum_counts = 0.;
+	for( unsigned int i=0; i<n; ++i )
+	{
+		sum_loudness += loudness[2*i+channel];
+		sum_counts += counts[i];
+	}
+	if( sum_loudness <= 0. || sum_counts <= 0. )
+		return sum_loudness == sum_counts ? 0. : 1.;
+	double difference = 0.;
+	for( unsigned int i=0; i<n; ++i )
+		difference += fabs( loudness[2*i+channel]/sum_loudness - counts[i]/sum_counts );
+	return difference / 2.;
+}
+}
+
+void PrintHelp()
+{
+	cout << "Possible parameters:" << endl;
+	cout << "--scene={" << SceneGenerator::get_type_names() << "} : " << endl;
+	cout << "\t scene to render (default corridor)" << endl;
+	cout << "--camera-width=<width=1280> : " << endl;
+	cout << "--camera-height=<height=720> : " << endl;
+	cout << "\t size of the generated depth images" << endl;
+	cout << "--camera-fps=<fps=15> : " << endl;
+	cout << "\t frame rate at which the scene moves" << endl;
+	cout << "--frames=<frames=20> : " << endl;
+	cout << "\t number of frames rendered with each mode" << endl;
+	cout << "--seed=<seed=1> : " << endl;
+	cout << "\t placement of the poles and pedestrians" << endl;
+	cout << "The renderer parameters are those of render-to-sound," << endl;
+	cout << "all registered modes are benchmarked if --depth-rendering-mode is not set." << endl;
+	PrintRendererParametersHelp();
+}
+
+int main( int argc, char * argv[] )
+{
+	int i_tmp;
+	// without modes, every registered mode is benchmarked
+	const std::string modes_parameter = "--depth-rendering-mode";
+	std::vector<std::string> args( argv, argv+argc );
+	bool has_modes = false;
+	for( unsigned int i=1; i<args.size(); ++i )
+		has_modes = has_modes || args[i].compare( 0, modes_parameter.length(), modes_parameter ) == 0;
+	if( has_modes == false )
+	{
+		const std::vector<std::string> & names = RendererRegistry::Instance().get_names();
+		std::string modes = modes_parameter + "=";
+		for( unsigned int i=0; i<names.size(); ++i )
+			modes += (i > 0 ? "," : "") + names[i];
+		args.push_back( modes );
+	}
+	std::vector<const char *> arg_pointers;
+	for( unsigned int i=0; i<args.size(); ++i )
+		arg_pointers.push_back( args[i].c_str() );
+
+	argh::parser cmdl;
+	cmdl.add_params( { "--scene", "--camera-width", "--camera-height", "--camera-fps", "--frames", "--seed" } );
+	AddRendererParameters( cmdl );
+	cmdl.parse( arg_pointers.size(), &arg_pointers[0] );
+	RendererParameters p;
+	const bool renderer_parameters_ok = ParseRendererParameters( cmdl, p );
+
+	bool scene_ok;
+	const SceneType scene_type = SceneGenerator::ParseType( cmdl("--scene","corridor").str(), scene_ok );
+	cmdl("--camera-width", 1280 ) >> i_tmp;
+	const int camera_width = i_tmp;
+	cmdl("--camera-height", 720 ) >> i_tmp;
+	const int camera_height = i_tmp;
+	cmdl("--camera-fps", 15 ) >> i_tmp;
+	const int camera_fps = i_tmp;
+	cmdl("--frames", 20 ) >> i_tmp;
+	const int n_frames = i_tmp;
+	cmdl("--seed", 1 ) >> i_tmp;
+	const unsigned int seed = i_tmp;
+
+	if( cmdl[{"-h","--help"}] || renderer_parameters_ok == false || scene_ok == false ||
+			camera_width <= 0 || camera_height <= 0 || camera_fps <= 0 || n_frames <= 0 )
+	{
+		PrintHelp();
+		return 0;
+	}
+
+	SceneGenerator scene( scene_type, SceneGenerator::MakeIntrinsics( camera_width, camera_height, 1.5 ), 1.2, seed );
+	const unsigned int n = camera_width*camera_height;
+	std::vector<uint16_t> depth( n );
+	std::vector<Vertex> vertices( n );
+	const unsigned int sound_n = p.sample_rate * p.interval_total_time * 2.;
+	std::vector<audio_t> sound( 2*sound_n );
+	std::vector<float> mix_bus( 2*sound_n );
+	std::vector<audio_t> sound_plan( 2*sound_n );
+	std::vector<audio_t> sound_q15( 2*sound_n );
+	SurfaceNormalEstimator * normal_estimator = p.scattering ? new SurfaceNormalEstimator(
+			camera_width, camera_height, p.scattering_vertical_gain, p.scattering_horizontal_gain ) : NULL;
+	WeightMap * weight_map = p.weight_terms.empty() == false ? new WeightMap( p.weight_terms, scene.intrinsics ) : NULL;
+
+	cout << setw(16) << "mode" << setw(12) << "scene [ms]" << setw(12) << "render [ms]";
+	cout << setw(12) << "synth [ms]" << setw(12) << "plan [ms]" << setw(12) << "diff L" << setw(12) << "diff R";
+	cout << setw(12) << "Q15 [ms]" << setw(12) << "Q15 [LSB]" << endl;
+	for( unsigned int i_mode=0; i_mode<p.depth_rendering_modes.size(); ++i_mode )
+	{
+		SimpleDepthRenderer * sdr = RendererRegistry::Instance().Create(
+				p.depth_rendering_modes[i_mode], p, p.base_frequency, scene.intrinsics, true );
+		if( normal_estimator != NULL )
+			sdr->SetSurfaceNormalEstimator( normal_estimator );
+		if( weight_map != NULL )
+			sdr->SetWeightMap( weight_map );
+		const DistanceMapping & mapping = *sdr->distance_mapping;
+		std::vector<unsigned int> counts[2];
+		counts[0].resize( mapping.n_bins );
+		counts[1].resize( mapping.n_bins );
+		// same normalization as the renderer
+		const unsigned int amp_div = (n / 25.0) / (0.1/p.step_distance) * 10;
+		// the plan is built once per renderer, like in the renderers
+		const RenderPlan plan( mapping, p.base_frequency, p.freq_doubling_length / p.speed_of_sound, sound_n );
+		double time_scene = 0., time_render = 0., time_synthesis = 0., time_synthesis_plan = 0., time_synthesis_q15 = 0.;
+		int max_error_q15 = 0;
+		double difference[2] = { 0., 0. };
+		for( int i_frame=0; i_frame<n_frames; ++i_frame )
+		{
+			auto t0 = std::chrono::high_resolution_clock::now();
+			scene.RenderDepth( (float)i_frame / camera_fps, &depth[0] );
+			scene.DeprojectDepth( &depth[0], &vertices[0] );
+			time_scene += ms_since( t0 );
+
+			t0 = std::chrono::high_resolution_clock::now();
+			sdr->RenderPointcloudToSound( &vertices[0], n, &sound[0], sound_n );
+			time_render += ms_since( t0 );
+
+			for( int channel=0; channel<2; ++channel )
+			{
+				scene.GroundTruthCounts( (channel == 0 ? -0.5 : 0.5) * p.stereo_distance, 0., 0.,
+						mapping, &counts[channel][0] );
+				difference[channel] += HistogramDifference( sdr->get_loudness_data(), channel,
+						&counts[channel][0], min( mapping.n_bins, sdr->loudness_n_per_channel ) );
+			}
+
+			// synthesis alone, from the exact histograms
+			t0 = std::chrono::high_resolution_clock::now();
+			for( int channel=0; channel<2; ++channel )
+				SoundRenderer::RenderAmplitudesToFrequencyWithTimeTable(
+						&counts[channel][0], mapping.n_bins, amp_div,
+						mapping.get_loudness_scale(), mapping.get_sample_edges(),
+						&sound[0], sound_n, channel, p.base_frequency, audio_A, true,
+						p.freq_doubling_length / p.speed_of_sound, p.base_amplitude, NULL, p.sample_rate );
+			time_synthesis += ms_since( t0 );
+
+			t0 = std::chrono::high_resolution_clock::now();
+			for( int channel=0; channel<2; ++channel )
+				SoundRenderer::RenderAmplitudesWithPlan( plan,
+						&counts[channel][0], amp_div, mapping.get_loudness_scale(),
+						&mix_bus[channel*sound_n], channel, audio_A, true, p.base_amplitude );
+			SoundRenderer::ConvertMixBusToSound( &mix_bus[0], &mix_bus[sound_n], &sound_plan[0], sound_n );
+			time_synthesis_plan += ms_since( t0 );
+
+			// the fixed point synthesis has to stay within q15_max_error of the floating point one
+			t0 = std::chrono::high_resolution_clock::now();
+			for( int channel=0; channel<2; ++channel )
+				SoundRenderer::RenderAmplitudesToFrequencyWithTimeTableQ15(
+						&counts[channel][0], mapping.n_bins, amp_div,
+						mapping.get_loudness_scale_q15(), mapping.get_sample_edges(),
+						&sound_q15[0], sound_n, channel, p.base_frequency, audio_A, true,
+						p.freq_doubling_length / p.speed_of_sound, p.base_amplitude, NULL, p.sample_rate );
+			time_synthesis_q15 += ms_since( t0 );
+			const unsigned int n_rendered = 2*mapping.get_sample_edges()[mapping.n_bins];
+			for( unsigned int j=0; j<n_rendered && j<2*sound_n; ++j )
+				max_error_q15 = max( max_error_q15, abs( (int)sound_q15[j] - (int)sound[j] ) );
+		}
+		cout << setw(16) << p.depth_rendering_modes[i_mode];
+		cout << setw(12) << time_scene/n_frames << setw(12) << time_render/n_frames;
+		cout << setw(12) << time_synthesis/n_frames << setw(12) << time_synthesis_plan/n_frames;
+		cout << setw(12) << difference[0]/n_frames << setw(12) << difference[1]/n_frames;
+		cout << setw(12) << time_synthesis_q15/n_frames << setw(12) << max_error_q15;
+		cout << ( max_error_q15 > q15_max_error ? " (over tolerance)" : "" ) << endl;
+		delete sdr;
+	}
+	delete normal_estimator;
+	delete weight_map;
+	return 0;
+}
@@ -13,6 +13,9 @@
 #include <atomic>
 #include <chrono>
 #include <iomanip>
+#include <vector>
+#include <memory>
+#include <cstdlib>
 
 #include <librealsense2/rs.hpp>
 
@@ -24,6 +27,15 @@
 
 #include "SoundController.h"
 #include "SoundRenderer.h"
+#include "StreamRenderer.h"
+#include "SurfaceNormals.h"
+#include "RendererParameters.h"
+#include "RendererRegistry.h"
+#include "RealSenseFrameSource.h"
+#include "ArchiveFrameSource.h"
+#include "SyntheticFrameSource.h"
+#include "PingScheduler.h"
+#include "ControlSocket.h"
 
 #include <signal.h>
 
@@ -31,14 +43,6 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-template<typename T>
-T get_value( argh::parser & cmdl, std::string parameter, T default_value )
-{
-	T t_tmp;
-	cmdl( parameter, default_value ) >> t_tmp;
-	return t_tmp;
-}
-
 std::atomic_bool CONTINUE_RUNNING(true);
 
 void stop_on_signal( int signum )
@@ -46,17 +50,9 @@ void stop_on_signal( int signum )
 	CONTINUE_RUNNING = false;
 }
 
-enum DepthRenderingMode { DepthRenderingUnknown = 0, DepthRenderingSimple = 1, DepthRenderingDelayIsAngle = 2 };
-
-
-int main(int argc, char * argv[]) try
+// Registers the parameters that take a value
+void AddParameters( argh::parser & cmdl )
 {
-	signal( SIGINT, stop_on_signal );
-
-	int i_tmp;
-	float f_tmp;
-	std::stringstream ss_tmp;
-	argh::parser cmdl;
 	cmdl.add_params(
 			{
 				"--signal-pid",
@@ -65,117 +61,264 @@ int main(int argc, char * argv[]) try
 				"--camera-height",
 				"--camera-fps",
 				"--save-depth-to",
-				"--renderer-max-distance",
-				"--renderer-step-distance",
-				"--renderer-speed-of-sound",
-				"--renderer-stereo-distance",
-				"--renderer-base-frequency",
-				"--renderer-freq-doubling-length",
-				"--renderer-base-amplitude",
-				"--renderer-start-frequency",
-				"--renderer-start-duration",
-				"--renderer-start-amplitude",
-				"--renderer-interval-extra-time",
-				"--renderer-lower-distance",
-				"--renderer-lower-frequency",
-				"--renderer-lower-frequency-doubling-length",
-				"--renderer-lower-amplitude",
-				"--depth-rendering-mode",
-				"--record", "--replay"
+				"--control-socket",
+				"--stream-block",
+				"--record", "--replay", "--replay-archive", "--synthetic-scene"
 			});
+	AddRendererParameters( cmdl );
+}
+
+void PrintHelp()
+{
+	using namespace std;
+	cout << "Possible parameters:" << endl;
+
+	cout << "[external communication]" << endl;
+	cout << "--signal-pid=<pid> : " << endl;
+	cout << "\t pid of the process that is sent SIGUSR1," << endl;
+	cout << "\t after pointcloud is sved in the specified file" << endl;
+	cout << "--signal-depth-filename=<filename> : " << endl;
+	cout << "\t filename to save depth to before signaling to an external process" << endl;
+	cout << "--control-socket=<path> : " << endl;
+	cout << "\t listen for parameter changes on a UNIX domain datagram socket at this path," << endl;
+	cout << "\t a message is a list of parameters, the renderers are set up as if started with these parameters," << endl;
+	cout << "\t the renderers are rebuilt in the background and swapped in between pings" << endl;
+	cout << "\t (camera and data archiving parameters can not be changed)" << endl;
+
+	cout << "[sound output]" << endl;
+	cout << "--stream : " << endl;
+	cout << "\t play a continuous sound instead of one ping per rendered frame," << endl;
+	cout << "\t the ping repeats every interval with the amplitudes of the latest frame," << endl;
+	cout << "\t which are crossfaded in by the audio callback (the sound start is not played)" << endl;
+	cout << "--stream-block=<samples=512> : " << endl;
+	cout << "\t samples per channel that the audio callback renders at once with --stream" << endl;
+
+	cout << "[camera]" << endl;
+	cout << "Caution: some parameter combinations are not supported by the camera," << endl;
+	cout << "and over an USB2 connection the selection of available parameters is even smaller" << endl;
+	cout << "--camera-width=<width=1280> : " << endl;
+	cout << "\t depth camera width in pixels" << endl;
+	cout << "--camera-height=<height=720> : " << endl;
+	cout << "\t depth camera height in pixels" << endl;
+	cout << "--camera-fps=<fps=15> : " << endl;
+	cout << "\t depth camera frame rate" << endl;
+
+	cout << "[data archiving]" << endl;
+	cout << "--save-depth-to=<filename-template> : " << endl;
+	cout << "\t pointclouds and generated waveforms are saved to " << endl;
+	cout << "\t <filename-template>__<timestamp>.{dat|waveform}" << endl;
+
+	PrintRendererParametersHelp();
+
+	cout << "[camera recordings]" << endl;
+	cout << "--record=<filename> : " << endl;
+	cout << "\t Record the camera frames to a bag file with specified filename." << endl;
+	cout << "--replay=<filename> : " << endl;
+	cout << "\t Play the recorded camera frames from the specified bag." << endl;
+	cout << "--replay-archive=<directory> : " << endl;
+	cout << "\t Play the pointclouds saved with --save-depth-to in the specified directory," << endl;
+	cout << "\t --camera-width and --camera-height have to match the saved pointclouds." << endl;
+	cout << "--synthetic : " << endl;
+	cout << "\t Render generated frames of a test scene instead of camera frames," << endl;
+	cout << "\t at the --camera-width, --camera-height and --camera-fps." << endl;
+	cout << "--synthetic-scene={" << SceneGenerator::get_type_names() << "} : " << endl;
+	cout << "\t the test scene of --synthetic (default pedestrians)" << endl;
+}
+
+/* Everything that the sound rendering needs between two pings.
+ * The state is built from the renderer parameters while the camera keeps running
+ * and swapped in between pings.
+ */
+struct RenderingState
+{
+	RenderingState(
+		const RendererParameters & parameters,
+		const CameraIntrinsics & depth_intrinsics,
+		bool save_loudness,
+		bool synthesize //!< false if the renderers only compute the amplitudes for a StreamRenderer
+			);
+	~RenderingState();
+	const RendererParameters parameters;
+	SurfaceNormalEstimator * normal_estimator;
+	WeightMap * weight_map;
+	PingScheduler scheduler;
+	unsigned int sound_start_n;
+	std::vector<audio_t> sound_start_data;
+	unsigned int sound_render_n;
+	std::vector<audio_t> sound_render_data;
+};
+
+RenderingState::RenderingState(
+	const RendererParameters & p,
+	const CameraIntrinsics & depth_intrinsics,
+	bool save_loudness,
+	bool synthesize
+	)
+	:parameters(p),
+	 normal_estimator(NULL),
+	 weight_map(NULL),
+	 scheduler( depth_intrinsics, p.weight_terms )
+{
+	std::cout << "Freq. doubling length = " << p.freq_doubling_length << std::endl;
+	std::cout << "Rendering max time = " << p.interval_max_render_time << std::endl;
+	std::cout << "Lower distance is = " << p.lower_distance << " | " << std::isnan(p.lower_distance) << std::endl;
+
+	if( p.scattering )
+	{
+		normal_estimator = new SurfaceNormalEstimator(
+			depth_intrinsics.width, depth_intrinsics.height,
+			p.scattering_vertical_gain, p.scattering_horizontal_gain );
+	}
+	if( p.weight_terms.empty() == false )
+		weight_map = new WeightMap( p.weight_terms, depth_intrinsics );
+	// All renderers of the rotation are constructed before the session starts
+	for( unsigned int i_mode=0; i_mode<p.depth_rendering_modes.size(); ++i_mode )
+	{
+		const float base_frequency = p.schedule_frequencies[i_mode] > 0. ?
+				p.schedule_frequencies[i_mode] : p.base_frequency;
+		SimpleDepthRenderer * sdr = RendererRegistry::Instance().Create(
+				p.depth_rendering_modes[i_mode], p, base_frequency, depth_intrinsics, save_loudness );
+		if( normal_estimator != NULL )
+			sdr->SetSurfaceNormalEstimator( normal_estimator );
+		if( weight_map != NULL )
+			sdr->SetWeightMap( weight_map );
+		sdr->SetSynthesis( synthesize );
+		scheduler.AddRenderer( sdr,
+				p.schedule_roi_top[i_mode], p.schedule_roi_bottom[i_mode] );
+	}
+	sound_start_n =
+			p.start_duration > 0 ? p.start_duration * p.sample_rate : 0;
+	sound_start_data.resize( sound_start_n*2 );
+	sound_render_n = p.sample_rate *
+			p.interval_total_time * 2.; // 2. to remove beeps when we are late
+	sound_render_data.assign( sound_render_n*2, 0 );
+	for( int i=0; (i<2) && (sound_start_n > 0); ++i )
+	{
+		std::cout << "Preparing start sound" << std::endl;
+		const float amplitude_times[2] = { 0.0, 2.0*p.start_duration };
+		const float amplitude_values[2] = { p.start_amplitude, p.start_amplitude };
+		SoundRenderer::RenderAmplitudesToFrequency(
+			amplitude_times, amplitude_values, 2,
+			&sound_start_data[0], sound_start_n, i,
+			p.start_frequency, audio_A, true, p.sample_rate
+			);
+	}
+	std::cout << "Start duration = " << p.start_duration << "; n = " << sound_start_n << std::endl;
+	std::cout << "Start amplitude = " << p.start_amplitude << std::endl;
+}
+
+RenderingState::~RenderingState()
+{
+	delete normal_estimator;
+	delete weight_map;
+}
+
+// The stream keeps the distance mapping and the frequencies of the first renderer
+StreamRenderer * NewStreamRenderer( const RenderingState & state )
+{
+	const SimpleDepthRenderer * sdr = state.scheduler.get_current_renderer();
+	return new StreamRenderer( *sdr->distance_mapping, sdr->base_frequency,
+			sdr->freq_doubling_length / sdr->speed_of_sound,
+			state.parameters.interval_total_time * state.parameters.sample_rate );
+}
+
+// True if the stream can play the amplitudes of the first renderer of the state
+bool StreamPlaysState( const StreamRenderer & stream, const RenderingState & state )
+{
+	const SimpleDepthRenderer * sdr = state.scheduler.get_current_renderer();
+	return stream.Matches( *sdr->distance_mapping, sdr->base_frequency,
+			sdr->freq_doubling_length / sdr->speed_of_sound,
+			state.parameters.interval_total_time * state.parameters.sample_rate );
+}
+
+// Receives parameter changes on the control socket and builds the new rendering states,
+// the renderers are built as if the program was started with the parameters of the message
+void ReceiveControlMessages(
+	ControlSocket * control_socket,
+	const char * program_name,
+	const CameraIntrinsics depth_intrinsics,
+	bool save_loudness,
+	bool synthesize,
+	unsigned int sample_rate,
+	const StreamRenderer * stream, //!< NULL if not streaming
+	std::atomic<RenderingState*> * next_state
+	)
+{
+	std::string message;
+	while( CONTINUE_RUNNING )
+	{
+		if( control_socket->Receive( message, 200 ) == false )
+			continue;
+		std::cout << "Control message : " << message << std::endl;
+		const std::vector<std::string> message_parameters = ControlSocket::SplitMessage( message );
+		std::vector<const char *> args;
+		args.push_back( program_name );
+		for( unsigned int i=0; i<message_parameters.size(); ++i )
+			args.push_back( message_parameters[i].c_str() );
+		argh::parser cmdl;
+		AddParameters( cmdl );
+		cmdl.parse( args.size(), &args[0] );
+		RendererParameters parameters;
+		if( ParseRendererParameters( cmdl, parameters ) == false )
+		{
+			std::cerr << "Invalid parameters in control message, keeping the current parameters" << std::endl;
+			continue;
+		}
+		// the sound device keeps the sample rate it was opened at
+		if( parameters.sample_rate != sample_rate )
+		{
+			std::cerr << "The sample rate can not change while playing, keeping the current parameters" << std::endl;
+			continue;
+		}
+		auto t0 = std::chrono::high_resolution_clock::now();
+		RenderingState * state = new RenderingState( parameters, depth_intrinsics, save_loudness, synthesize );
+		auto t1 = std::chrono::high_resolution_clock::now();
+		std::cout << "Rebuilding the renderers took " <<
+			std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count()/1000. << " ms" << std::endl;
+		// the audio callback keeps playing the ping the stream was built for
+		if( stream != NULL && StreamPlaysState( *stream, *state ) == false )
+		{
+			std::cerr << "The distance bins, the frequencies and the interval can not change while streaming, "
+					"keeping the current parameters" << std::endl;
+			delete state;
+			continue;
+		}
+		// a state that was not swapped in yet is replaced by the newer one
+		delete next_state->exchange( state );
+	}
+}
+
+int main(int argc, char * argv[]) try
+{
+	signal( SIGINT, stop_on_signal );
+
+	int i_tmp;
+	std::stringstream ss_tmp;
+	argh::parser cmdl;
+	AddParameters( cmdl );
 	cmdl.parse(argc,argv);
 
-	const DepthRenderingMode depth_rendering_mode =
-			( ( cmdl("--depth-rendering-mode").str() ) == "simple" ) ? DepthRenderingSimple :
-			( ( cmdl("--depth-rendering-mode").str() ) == "delay_is_angle" ) ? DepthRenderingDelayIsAngle :
-			DepthRenderingUnknown ;
+	RendererParameters renderer_parameters;
+	const bool renderer_parameters_ok = ParseRendererParameters( cmdl, renderer_parameters );
 
-	const std::string filename_record = get_value<std::string>( cmdl, "--record", "" );
-	const std::string filename_replay = get_value<std::string>( cmdl, "--replay", "" );
+	const std::string filename_record = cmdl("--record","").str();
+	const std::string filename_replay = cmdl("--replay","").str();
 	const bool is_recording = filename_record.length() > 0;
+	const std::string archive_replay = cmdl("--replay-archive","").str();
 	const bool is_replaying = filename_replay.length() > 0;
+	const bool is_synthetic = cmdl["--synthetic"];
+	bool synthetic_scene_ok;
+	const SceneType synthetic_scene = SceneGenerator::ParseType(
+			cmdl("--synthetic-scene","pedestrians").str(), synthetic_scene_ok );
+	const int n_frame_sources = (int)is_replaying + (int)(archive_replay.length() > 0) + (int)is_synthetic;
 
 	if( cmdl[{"-h","--help"}]
-			 || (depth_rendering_mode == DepthRenderingUnknown)
-			 || (is_recording && is_replaying) )
+			 || (renderer_parameters_ok == false)
+			 || (synthetic_scene_ok == false)
+			 || (n_frame_sources > 1)
+			 || (is_recording && n_frame_sources > 0) )
 	{
-		using namespace std;
-		cout << "Possible parameters:" << endl;
-
-		cout << "[external communication]" << endl;
-		cout << "--signal-pid=<pid> : " << endl;
-		cout << "\t pid of the process that is sent SIGUSR1," << endl;
-		cout << "\t after pointcloud is sved in the specified file" << endl;
-		cout << "--signal-depth-filename=<filename> : " << endl;
-		cout << "\t filename to save depth to before signaling to an external process" << endl;
-
-		cout << "[camera]" << endl;
-		cout << "Caution: some parameter combinations are not supported by the camera," << endl;
-		cout << "and over an USB2 connection the selection of available parameters is even smaller" << endl;
-		cout << "--camera-width=<width=1280> : " << endl;
-		cout << "\t depth camera width in pixels" << endl;
-		cout << "--camera-height=<height=720> : " << endl;
-		cout << "\t depth camera height in pixels" << endl;
-		cout << "--camera-fps=<fps=15> : " << endl;
-		cout << "\t depth camera frame rate" << endl;
-
-		cout << "[data archiving]" << endl;
-		cout << "--save-depth-to=<filename-template> : " << endl;
-		cout << "\t pointclouds and generated waveforms are saved to " << endl;
-		cout << "\t <filename-template>__<timestamp>.{dat|waveform}" << endl;
-
-		cout << "[depth rendering]" << endl;
-		cout << "--renderer-max-distance=<max distance=4.0> : " << endl;
-		cout << "\t max distance for depth renderer" << endl;
-		cout << "--renderer-step-distance=<step distance=0.005> : " << endl;
-		cout << "\t step in distance for depth renderer (depth resolution)" << endl;
-		cout << "--renderer-speed-of-sound=<speed of sound=1.0> : " << endl;
-		cout << "\t speed of sound for depth renderer [m/s]" << endl;
-		cout << "--renderer-stereo-distance=<stereo distance=0.2> : " << endl;
-		cout << "\t distance between the depth renderer's \"ears\" [m]" << endl;
-		cout << "--renderer-base-frequency=<frequency=1000.0> : " << endl;
-		cout << "\t base frequency for depth renderer [Hz=1/s]" << endl;
-		cout << "--renderer-freq-doubling-length=<frequency doubling=-1.> : " << endl;
-		cout << "\t length at which the frequency doubles [m]" << endl;
-		cout << "\t (if left unset, the frequency remains constant)" << endl;
-		cout << "--renderer-base-amplitude=<amplitude=0.0> : " << endl;
-		cout << "\t base amplitude (added to signal) [%]" << endl;
-		cout << "--renderer-start-frequency=<frequency=1000.0> : " << endl;
-		cout << "\t start signal frequency for depth renderer [Hz=1/s]" << endl;
-		cout << "--renderer-start-duration=<duration=-1.> : " << endl;
-		cout << "\t start signal duration [s]" << endl;
-		cout << "\t (if left unset, the start signal is not played)" << endl;
-		cout << "--renderer-start-amplitude=<amplitude=50.0> : " << endl;
-		cout << "\t start signal amplitude [% of max]" << endl;
-		cout << "--renderer-interval-extra-time=<extre time=0.1> : " << endl;
-		cout << "\t extra time to wait between sound renders [s]" << endl;
-		cout << "\t (time between renders is this time + <max distance> / <speed of sound>" << endl;
-
-		cout << "--renderer-lower-distance=<lower distance=-1.> : " << endl;
-		cout << "\t the lower renderer is this far below the main renderer [m]" << endl;
-		cout << "\t if left unset, a negative value is set to signal that the lower channel should not be used" << endl;
-		cout << "--renderer-lower-frequency=<lower frequency=500> : " << endl;
-		cout << "\t base frequency of the lower renderer [Hz]" << endl;
-		cout << "--renderer-lower-frequency-doubling-length=<lower freq. doubling=-1.> : " << endl;
-		cout << "\t length at which the lower signal's frequency doubles [m]" << endl;
-		cout << "\t (if left unset, the frequency remains constant)" << endl;
-		cout << "--renderer-lower-amplitude=<amplitude=0.0> : " << endl;
-		cout << "\t lower signal base amplitude (added to signal) [%]" << endl;
-
-		cout << "--depth-rendering-mode={simple,delay_is_angle} : " << endl;
-		cout << "\t Depth rendering mode or the way that the depth is converted into amplitudes. " << endl;
-		cout << "\t The following modes are possible: " << endl;
-		cout << "\t simple : " << endl;
-		cout << "\t \t distances between each ear and all points are calculated and converted to amplitudes" << endl;
-		cout << "\t delay_is_angle: " << endl;
-		cout << "\t \t the delay between signals on L and R channels that a point in space produces" << endl;
-		cout << "\t \t corresponds to the horizontal angle at which the point is seen by the camera." << endl;
-
-		cout << "--record=<filename> : " << endl;
-		cout << "\t Record the camera frames to a bag file with specified filename." << endl;
-		cout << "--replay=<filename> : " << endl;
-		cout << "\t Play the recorded camera frames from the specified bag." << endl;
-
+		PrintHelp();
 		return 0;
 	}
 
@@ -190,52 +333,22 @@ int main(int argc, char * argv[]) try
 	const int camera_width = i_tmp;
 	cmdl("--camera-height", 720 ) >> i_tmp;
 	const int camera_height = i_tmp;
-	const int camera_fps = get_value(cmdl, "--camera-fps", 15 );
+	cmdl("--camera-fps", 15 ) >> i_tmp;
+	const int camera_fps = i_tmp;
 
 	const std::string depth_path = cmdl("--save-depth-to","").str();
 	const bool save_depth = depth_path.length() > 0;
-
-    cmdl("--renderer-max-distance", 4.0) >> f_tmp;
-    const float param_max_distance = f_tmp;
-    const float renderer_step_distance = get_value(cmdl, "--renderer-step-distance", 0.005);
-    cmdl("--renderer-speed-of-sound", 1.0) >> f_tmp;
-    const float param_speed_of_sound = f_tmp;
-    cmdl("--renderer-stereo-distance", 0.2) >> f_tmp;
-    const float param_stereo_distance = f_tmp;
-	const float param_base_frequency = get_value(cmdl,"--renderer-base-frequency",1000.0);
-	const float renderer_freq_doubling_length = get_value(cmdl,"--renderer-freq-doubling-length",
-			-1.0 );
-	const float renderer_base_amplitude = get_value(cmdl,"--renderer-base-amplitude",0.0) / 100.0;
-
-	const float renderer_start_frequency = get_value(cmdl,"--renderer-start-frequency",1000.0);
-	const float renderer_start_duration = get_value(cmdl,"--renderer-start-duration",
-			-1.0 );
-	const float renderer_start_amplitude = get_value(cmdl,"--renderer-start-amplitude", 50.0 ) / 100.0;
-	const float renderer_interval_extra_time = get_value(cmdl,"--renderer-interval-extra-time",0.1);
-
-	const float renderer_lower_distance = get_value(cmdl,"--renderer-lower-distance",
-			-1.0 );
-	const float renderer_lower_frequency = get_value(cmdl,"--renderer-lower-frequency",500.);
-	const float renderer_lower_frequency_doubling_length = get_value(cmdl,
-		"--renderer-lower-frequency-doubling-length",
-		-1.0 );
-	const float renderer_lower_background_amplitude = get_value(cmdl,
-		"--renderer-lower-amplitude",0.0)/100.;
-
-	const float renderer_interval_max_render_time = param_max_distance / param_speed_of_sound;
-	const float renderer_interval_total_time = renderer_interval_extra_time +
-			renderer_interval_max_render_time;
-
-	std::cout << "Freq. doubling length = " << renderer_freq_doubling_length << std::endl;
-	std::cout << "Rendering max time = " << renderer_interval_max_render_time << std::endl;
-	std::cout << "Lower distance is = " << renderer_lower_distance << " | " << std::isnan(renderer_lower_distance) << std::endl;
+	const std::string control_socket_path = cmdl("--control-socket","").str();
+	const bool is_streaming = cmdl["--stream"];
+	cmdl("--stream-block", 512 ) >> i_tmp;
+	const unsigned int stream_block_n = i_tmp > 0 ? i_tmp : 512;
 
 	if(save_depth)
 		std::cout << "Saving depth to : " << depth_path << std::endl;
 
 #if DEBUGOMP == 1
 	const unsigned int debug_vertices_n = camera_width*camera_height;
-	rs2::vertex * debug_vertices_data = new rs2::vertex[debug_vertices_n];
+	Vertex * debug_vertices_data = new Vertex[debug_vertices_n];
 	if( debug_vertices_data == NULL )
 	{
 		std::cerr << "Error allocating data for debug vertices" << std::endl;
@@ -250,37 +363,26 @@ int main(int argc, char * argv[]) try
 			return 1;
 		}
 		std::cout << "Reading data" << std::endl;
-		f.read( (char *)debug_vertices_data, debug_vertices_n * sizeof(rs2::vertex) );
+		f.read( (char *)debug_vertices_data, debug_vertices_n * sizeof(Vertex) );
 	}
 #endif
 
 
-	rs2::pointcloud pc;
-	rs2::points points;
-
-	// Create a pipeline and start it
-	rs2::pipeline pipe;
-	rs2::config cfg;
-	std::cout << "Configuring camera stream with parameters w,h = " << camera_width << "," << camera_height;
-	std::cout << "     streaming at " << camera_fps << " frames per second" << std::endl;
-    if( is_replaying )
-    	cfg.enable_device_from_file( filename_replay, false );
-    else
-    {
-    cfg.enable_stream(RS2_STREAM_DEPTH, camera_width, camera_height, RS2_FORMAT_Z16, camera_fps);
-    if( save_depth || is_recording )
-		cfg.enable_stream( RS2_STREAM_COLOR, camera_width, camera_height, RS2_FORMAT_RGB8, camera_fps );
-    if( is_recording )
-    	cfg.enable_record_to_file(filename_record);
-    }
-
-    rs2::pipeline_profile profile = pipe.start(cfg);
-    if(is_replaying) // Pause the replay when the code is executing in order to deterministically get the same frames on every run
-		pipe.get_active_profile().get_device().as<rs2::playback>().pause();
-
-    rs2::align align( RS2_STREAM_DEPTH );
-
-    // TODO: possibly migrate realsense code to a "Asynchronous method"
+    // If we stream at 6 fps and the replay sound lasts 1.5s, then we expect to hit every 9th frame
+    const int expected_frame_multiplier = (int)( 0.1 + camera_fps * renderer_parameters.interval_max_render_time );
+	const std::chrono::nanoseconds expected_time_between_frames = std::chrono::milliseconds(
+			(long int)(1000 * renderer_parameters.interval_max_render_time / camera_fps ) );
+	std::unique_ptr<FrameSource> source;
+	if( is_replaying ) // when replaying from device, we render every multiplier frame to make things deterministic
+		source.reset( new RealSenseBagSource( filename_replay,
+				expected_frame_multiplier, expected_time_between_frames, save_depth ) );
+	else if( archive_replay.length() > 0 )
+		source.reset( new ArchiveFrameSource( archive_replay, camera_width, camera_height ) );
+	else if( is_synthetic )
+		source.reset( new SyntheticFrameSource( camera_width, camera_height, camera_fps, synthetic_scene ) );
+	else
+		source.reset( new RealSenseCameraSource( camera_width, camera_height, camera_fps,
+				save_depth || is_recording, save_depth, filename_record ) );
 
     /*
      * Main application loop:
@@ -289,154 +391,126 @@ int main(int argc, char * argv[]) try
      * (for now: export the points data and signal to python app)
      */
 
-    SoundController sc;
-    SimpleDepthRenderer sdr(
-    	param_max_distance, renderer_step_distance,
-		param_speed_of_sound, param_base_frequency, renderer_freq_doubling_length,
-		renderer_base_amplitude,
-		param_stereo_distance,
-		renderer_lower_distance,
-		renderer_lower_frequency,
-		renderer_lower_frequency_doubling_length,
-		renderer_lower_background_amplitude,
-		save_depth
-    		);
-    const unsigned int sound_start_n =
-    		renderer_start_duration > 0 ? renderer_start_duration * SAMPLE_RATE : 0;
-    audio_t sound_start_data[sound_start_n*2];
-    const unsigned int sound_render_n = SAMPLE_RATE *
-    		renderer_interval_total_time * 2.; // 2. to remove beeps when we are late
-    audio_t sound_render_data[sound_render_n*2];
-    for(int i=0; i<sound_render_n*2; ++i )
-    	sound_render_data[i] = 0;
-    for( int i=0; (i<2) && (sound_start_n > 0); ++i )
+	const CameraIntrinsics depth_intrinsics = source->get_intrinsics();
+	// a streaming renderer needs the amplitudes that the renderers save with the loudness
+	const bool save_loudness = save_depth || is_streaming;
+    RenderingState * state = new RenderingState( renderer_parameters, depth_intrinsics, save_loudness, is_streaming == false );
+    std::unique_ptr<StreamRenderer> stream;
+    std::unique_ptr<SoundController> sc;
+    if( is_streaming )
     {
-    	std::cout << "Preparing start sound" << std::endl;
-    	const float amplitude_times[2] = { 0.0, 2.0*renderer_start_duration };
-    	const float amplitude_values[2] = { renderer_start_amplitude, renderer_start_amplitude };
-		SoundRenderer::RenderAmplitudesToFrequency(
-			amplitude_times, amplitude_values, 2,
-			sound_start_data, sound_start_n, i,
-			renderer_start_frequency, audio_A, true
-    		);
+    	stream.reset( NewStreamRenderer( *state ) );
+    	sc.reset( new SoundController( renderer_parameters.sample_rate, stream.get(), stream_block_n ) );
     }
-    std::cout << "Start duration = " << renderer_start_duration << "; n = " << sound_start_n << std::endl;
-    std::cout << "Start amplitude = " << renderer_start_amplitude << std::endl;
+    else
+    	sc.reset( new SoundController( renderer_parameters.sample_rate ) );
+    // Renderers rebuilt from control messages are swapped in between pings
+    std::atomic<RenderingState*> next_state(NULL);
+    ControlSocket * control_socket = NULL;
+    std::thread control_thread;
+    if( control_socket_path.length() > 0 )
+    {
+    	control_socket = new ControlSocket( control_socket_path );
+    	if( control_socket->is_open() )
+    		control_thread = std::thread( ReceiveControlMessages,
+    				control_socket, argv[0], depth_intrinsics, save_loudness, is_streaming == false,
+    				renderer_parameters.sample_rate, stream.get(), &next_state );
+    }
+    // stops the control thread on every way out of main
+    struct ControlThreadJoiner
+    {
+    	std::thread & thread;
+    	~ControlThreadJoiner()
+    	{
+    		CONTINUE_RUNNING = false;
+    		if( thread.joinable() )
+    			thread.join();
+    	}
+    } control_thread_joiner = { control_thread };
 
     auto time_last_sound = std::chrono::high_resolution_clock::now();
     const std::chrono::milliseconds scan_interval(10);
-    const std::chrono::milliseconds sound_interval((long int)(renderer_interval_total_time*1000));
-    rs2_error *e = NULL;
     int count_frame = 0;
-    // If we stream at 6 fps and the replay sound lasts 1.5s, then we expect to hit every 9th frame
-    const int expected_frame_multiplier = (int)( 0.1 + camera_fps * param_max_distance / param_speed_of_sound );
-    // when replaying from device, we render every multiplier frame to make things deterministic
-	const std::chrono::nanoseconds recording_duration = is_replaying ?
-			pipe.get_active_profile().get_device().as<rs2::playback>().get_duration() :
-			std::chrono::nanoseconds(0);
-	const std::chrono::nanoseconds expected_time_between_frames = std::chrono::milliseconds(
-			(long int)(1000 * param_max_distance / param_speed_of_sound / camera_fps ) );
+    bool source_failed = false; //!< the source stopped on an error, not at the end of a replay
 
     while(CONTINUE_RUNNING)
     {
-		if( is_replaying ) // resume playback
-			pipe.get_active_profile().get_device().as<rs2::playback>().resume();
-
-		rs2::frameset data = pipe.wait_for_frames();
-		if( is_replaying )
+		RenderingState * rebuilt_state = next_state.exchange( NULL );
+		if( rebuilt_state != NULL )
 		{
-			std::chrono::nanoseconds current_recording_time =
-					std::chrono::nanoseconds( pipe.get_active_profile().get_device().as<rs2::playback>().get_position() );
-
-			if( recording_duration - current_recording_time < expected_time_between_frames )
-				CONTINUE_RUNNING = false;
-
-			const long int frame_num = data.get_depth_frame().get_frame_number();
-            // use get_duration and get_position to check if there will be no more frames, and exit if this is the case
-			if( (frame_num == 0) || (frame_num % expected_frame_multiplier != 0) )
-				continue;
-			// pause playback in order not to skip any frames
-			pipe.get_active_profile().get_device().as<rs2::playback>().pause();
+			delete state;
+			state = rebuilt_state;
+			std::cout << "Switched to the renderer parameters from the control message" << std::endl;
 		}
+		const RendererParameters & parameters = state->parameters;
+		const std::chrono::milliseconds sound_interval((long int)(parameters.interval_total_time*1000));
+
         auto time_now = std::chrono::high_resolution_clock::now();
-        if ( (is_replaying==false) && (time_now - time_last_sound < sound_interval) )
+        // a stream renders every frame, the audio callback keeps the ping rate
+        if ( source->is_live() && is_streaming == false && (time_now - time_last_sound < sound_interval) )
         {
+        	source->DiscardFrames();
     		std::this_thread::sleep_for(scan_interval);
     		continue;
         }
+		Frame frame;
+		if( source->WaitForFrame( frame ) == false )
+		{
+			source_failed = source->has_failed();
+			break;
+		}
 		std::cout << "Processing depth frame # ";
-		std::cout << std::setw(10) << data.get_depth_frame().get_frame_number() << std::endl;
-
-		rs2::frame depth_frame = data.get_depth_frame();
-		if( !depth_frame )
-			return EXIT_FAILURE; // This should not happen, as we have to get depth frames in all cases
-		// Apply any spatial filters here and swap the depth_frame for the processed depth frame
+		std::cout << std::setw(10) << frame.frame_number << std::endl;
 
         {
-        	// TODO: make openMP parallelization of
-        	// librealsense/src/proc/pointcloud.cpp deproject_depth
-        	// Even better: parse the depth frame directly, as the deprojection seems to be nothing more than
-        	// some linear multiplication (TODO as part of optimizations and speedups, if necessary)
-        	// See librealsense/include/librealsense2/rsutil.h deproject_pixel_to_point
         	// OR MAKE AN OPENCL implementation of pointcloud calculation based on depth scale (see rs-align example)
         	// (RPi's GPU is much faster than its CPU so GPU calculations make a lot of sense)
 
 //        	sc.PlayStartNow( sound_start_n, sound_start_data ); / THIS is the desired location of this call, provided that the rendering can be done fast enough
 
-			points = pc.calculate(depth_frame);
         	std::cout << "Ping !" << std::endl;
-        	std::cout << "max distance = " << param_max_distance << std::endl;
-        	std::cout << "interval = " << renderer_interval_total_time << std::endl;
-        	std::cout << "speed of sound = " << param_speed_of_sound << std::endl;
-        	std::cout << "stereo distance = " << param_stereo_distance << std::endl;
+        	std::cout << "max distance = " << parameters.max_distance << std::endl;
+        	std::cout << "interval = " << parameters.interval_total_time << std::endl;
+        	std::cout << "speed of sound = " << parameters.speed_of_sound << std::endl;
+        	std::cout << "stereo distance = " << parameters.stereo_distance << std::endl;
         	time_last_sound = time_now;
-        	std::cout << "Point size: " << points.size() << std::endl;
+        	std::cout << "Point size: " << frame.n_vertices << std::endl;
         	{ // Render the sound and play it
-				if( depth_rendering_mode == DepthRenderingSimple )
-				{
-					sdr.RenderPointcloudToSound(
+				state->scheduler.RenderPointcloudToSound(
 #if DEBUGOMP==1
-        				debug_vertices_data, debug_vertices_n,
+        			debug_vertices_data, debug_vertices_n,
 #else
-        				points.get_vertices(), points.size(),
+        			frame.vertices, frame.n_vertices,
 #endif
-						sound_render_data, sound_render_n );
+					&state->sound_render_data[0], state->sound_render_n );
+				if( is_streaming )
+				{
+					const SimpleDepthRenderer * sdr = state->scheduler.get_current_renderer();
+					if( stream->Publish( sdr->get_amplitudes_data(), sdr->loudness_n_per_channel ) == false )
+						std::cerr << "The stream plays " << stream->n_bins << " distance bins, the renderer has " <<
+								sdr->loudness_n_per_channel << ", keeping the last frame" << std::endl;
 				}
 				else
 				{
-					sdr.RenderPointcloudToSoundDelayIsAngle(
-#if DEBUGOMP==1
-        				debug_vertices_data, debug_vertices_n,
-#else
-        				points.get_vertices(), points.size(),
-#endif
-						sound_render_data, sound_render_n,
-						camera_width, 0.3 // Max delay must be less than 40cm = 2*20cm (twice the camera minimal range)
+					// latency is measured from the time the frame was released from the driver, in ms
+					const double frame_timestamp = frame.time_of_arrival;
+					const double time_at_rendering = FrameSource::Now();
+					std::cout << "Time (frame generation) = " << frame_timestamp << std::endl;
+					std::cout << "Time (now)              = " << time_at_rendering << std::endl;
+					sc->PlayStartNow( state->sound_start_n, &state->sound_start_data[0] ); // MOVED from previous location due to too long computation times
+					auto time_chrono_at_rendering = std::chrono::high_resolution_clock::now();
+					sc->PlaySound(
+						time_chrono_at_rendering + std::chrono::milliseconds(
+								(long int)(frame_timestamp - time_at_rendering)),
+						state->sound_render_n, &state->sound_render_data[0],
+						(parameters.start_duration > 0)
 						);
 				}
-
-        		// Time examples : line 195 of librealsense/wrappers/opencv/latency-tool/latency-detector.h
-        		// rs2_time_t is miliseconds in double
-        		// This should be correct, but it doesn't seem to be (that is device clock that can not be related to CPU clock)
-//				rs2_time_t frame_timestamp = rs2_get_frame_timestamp(f.get(),&e);
-        		// so instead we measure latency from the time the frame was released from the driver
-				rs2_time_t frame_timestamp = depth_frame.get_frame_metadata(RS2_FRAME_METADATA_TIME_OF_ARRIVAL);
-        		rs2_time_t time_rs2_at_rendering = rs2_get_time(NULL); // Gets current time
-        		std::cout << "Time (frame generation) = " << frame_timestamp << std::endl;
-        		std::cout << "Time (now)              = " << time_rs2_at_rendering << std::endl;
-				sc.PlayStartNow( sound_start_n, sound_start_data ); // MOVED from previous location due to too long computation times
-				auto time_chrono_at_rendering = std::chrono::high_resolution_clock::now();
-        		sc.PlaySound(
-					time_chrono_at_rendering + std::chrono::milliseconds(
-							(long int)(frame_timestamp - time_rs2_at_rendering)),
-					sound_render_n, sound_render_data,
-					(renderer_start_duration > 0)
-					);
         	}
         	if( (process_to_signal > 0) && (signal_depth_filename.length() > 0)  )
         	{
 				std::ofstream of(signal_depth_filename.c_str(),std::ios_base::binary);
-				of.write( (const char *)points.get_data(), points.size() * sizeof(rs2::vertex) );
+				of.write( (const char *)frame.vertices, frame.n_vertices * sizeof(Vertex) );
 				of.close();
         		std::cout << "Signaling process " << process_to_signal << std::endl;
         		const int rk = kill(process_to_signal,SIGUSR1);
@@ -450,6 +524,7 @@ int main(int argc, char * argv[]) try
         	}
 			if(save_depth)
 			{
+				const SimpleDepthRenderer * sdr = state->scheduler.get_current_renderer();
 				auto now = std::chrono::system_clock::now();
 				auto now_c = std::chrono::system_clock::to_time_t(now);
 				// save pointcloud
@@ -460,7 +535,7 @@ int main(int argc, char * argv[]) try
 							".dat";
 					std::cout << "Depth filename is : " << ss_tmp.str() << std::endl;
 					std::ofstream of( ss_tmp.str(),std::ios_base::binary);
-					of.write( (const char *)points.get_data(), points.size() * sizeof(rs2::vertex) );
+					of.write( (const char *)frame.vertices, frame.n_vertices * sizeof(Vertex) );
 					of.close();
 				}
 				// Save sound
@@ -471,33 +546,31 @@ int main(int argc, char * argv[]) try
 							".waveform";
 					std::cout << "Waveform filename is : " << ss_tmp.str() << std::endl;
 					std::ofstream of( ss_tmp.str(), std::ios_base::binary );
-					of.write( (const char *) sound_render_data, 2*sound_render_n*sizeof(audio_t) );
+					of.write( (const char *) &state->sound_render_data[0], 2*state->sound_render_n*sizeof(audio_t) );
 					of.close();
 				}
 
-				// Align the color frame to depth frame
-				auto processed = align.process(data);
-				rs2::video_frame vf = processed.get_color_frame();
-				if( vf )
+				const ColorImage * vf = &frame.aligned_color;
+				if( vf->data != NULL )
 				{
 					ss_tmp.str("");
 					ss_tmp << depth_path << "__" <<
 							std::put_time( std::localtime(&now_c), "%F__%H_%M_%S") <<
 							"_aligned.png";
 					std::cout << "Color (aligned) filename is : " << ss_tmp.str() << std::endl;
-					stbi_write_png(ss_tmp.str().c_str(), vf.get_width(), vf.get_height(),
-								   vf.get_bytes_per_pixel(), vf.get_data(), vf.get_stride_in_bytes());
+					stbi_write_png(ss_tmp.str().c_str(), vf->width, vf->height,
+								   vf->bytes_per_pixel, vf->data, vf->stride_in_bytes);
 				}
-				vf = data.get_color_frame();
-				if( vf )
+				vf = &frame.color;
+				if( vf->data != NULL )
 				{
 					ss_tmp.str("");
 					ss_tmp << depth_path << "__" <<
 							std::put_time( std::localtime(&now_c), "%F__%H_%M_%S") <<
 							"_raw.png";
 					std::cout << "Color (raw) filename is : " << ss_tmp.str() << std::endl;
-					stbi_write_png(ss_tmp.str().c_str(), vf.get_width(), vf.get_height(),
-								   vf.get_bytes_per_pixel(), vf.get_data(), vf.get_stride_in_bytes());
+					stbi_write_png(ss_tmp.str().c_str(), vf->width, vf->height,
+								   vf->bytes_per_pixel, vf->data, vf->stride_in_bytes);
 				}
 				// Save loudness
 				{
@@ -507,8 +580,8 @@ int main(int argc, char * argv[]) try
 							".loudness";
 					std::cout << "Loudness filename is : " << ss_tmp.str() << std::endl;
 					std::ofstream of( ss_tmp.str(), std::ios_base::binary );
-					of.write( (const char *) sdr.get_loudness_data(),
-							2*sdr.loudness_n_per_channel*sizeof(sdr.get_loudness_data()[0]) );
+					of.write( (const char *) sdr->get_loudness_data(),
+							2*sdr->loudness_n_per_channel*sizeof(sdr->get_loudness_data()[0]) );
 					of.close();
 				}
 				// Save amplitudes
@@ -519,8 +592,8 @@ int main(int argc, char * argv[]) try
 							".amp";
 					std::cout << "Amplitudes filename is : " << ss_tmp.str() << std::endl;
 					std::ofstream of( ss_tmp.str(), std::ios_base::binary );
-					of.write( (const char *) sdr.get_amplitudes_data(),
-							2*sdr.loudness_n_per_channel*sizeof(sdr.get_amplitudes_data()[0]) );
+					of.write( (const char *) sdr->get_amplitudes_data(),
+							2*sdr->loudness_n_per_channel*sizeof(sdr->get_amplitudes_data()[0]) );
 					of.close();
 				}
 				// Save the parameters and cli arguments
@@ -540,8 +613,8 @@ int main(int argc, char * argv[]) try
 					}
 					of << "\n";
 					of << "Parameters:\n";
-					of << "max_distance = " << sdr.max_distance << "\n";
-					of << "step_distance = " << sdr.step_distance << "\n";
+					of << "max_distance = " << sdr->max_distance << "\n";
+					of << "step_distance = " << sdr->step_distance << "\n";
 					of.close();
 				}
 			}
@@ -550,11 +623,17 @@ int main(int argc, char * argv[]) try
         }
     }
 
-    if( is_replaying ) // Allow for the sound to be played to the end before exiting
+    if( source->is_live() == false ) // Allow for the sound to be played to the end before exiting
 		std::this_thread::sleep_for( std::chrono::seconds( 2 ) );
-    pipe.stop();
-
-    return EXIT_SUCCESS;
+    source.reset();
+    CONTINUE_RUNNING = false; // the loop also ends when the source runs out of frames
+    if( control_thread.joinable() )
+    	control_thread.join();
+    delete control_socket;
+    delete next_state.exchange( NULL );
+    delete state;
+
+    return source_failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 catch (const rs2::error & e)
 {